@@ -0,0 +1,86 @@
+#!/bin/sh
+# Gera um repositório de dotfiles sintético e a config correspondente.
+#
+# Uso: gen_workload.sh <sandbox> [link|collect]
+#
+#   link     arquivos ficam no repositório e o HOME começa vazio (install/status/uninstall)
+#   collect  arquivos ficam no HOME e o repositório começa vazio (collect)
+#
+# Tamanho controlado por variáveis de ambiente:
+#   BENCH_ENTRIES    número de entradas na config        (default 200)
+#   BENCH_DEPTH      profundidade dos caminhos           (default 2)
+#   BENCH_FILE_SIZE  bytes por arquivo                   (default 4096)
+#   BENCH_FANOUT     arquivos por nível em entradas dir  (default 8)
+#   BENCH_DIR_PCT    % de entradas que são diretórios    (default 10)
+set -eu
+
+SANDBOX=${1:?"uso: $0 <sandbox> [link|collect]"}
+LAYOUT=${2:-link}
+ENTRIES=${BENCH_ENTRIES:-200}
+DEPTH=${BENCH_DEPTH:-2}
+FILE_SIZE=${BENCH_FILE_SIZE:-4096}
+FANOUT=${BENCH_FANOUT:-8}
+DIR_PCT=${BENCH_DIR_PCT:-10}
+
+case "$LAYOUT" in
+    link | collect) ;;
+    *)
+        echo "layout inválido: $LAYOUT" >&2
+        exit 2
+        ;;
+esac
+
+rm -rf "$SANDBOX"
+mkdir -p "$SANDBOX/repo" "$SANDBOX/home" "$SANDBOX/state"
+
+# Conteúdo base gerado uma única vez; cada arquivo é uma cópia dele.
+SEED="$SANDBOX/seed"
+head -c "$FILE_SIZE" /dev/zero | tr '\0' 'x' > "$SEED"
+
+if [ "$LAYOUT" = link ]; then
+    BASE="$SANDBOX/repo"
+else
+    BASE="$SANDBOX/home/.bench"
+fi
+
+nested() {
+    path=""
+    level=1
+    while [ "$level" -le "$DEPTH" ]; do
+        path="${path}l${level}_$(( $1 % FANOUT ))/"
+        level=$(( level + 1 ))
+    done
+    printf '%s' "$path"
+}
+
+fill_dir() {
+    dir=$1
+    level=0
+    while [ "$level" -le "$DEPTH" ]; do
+        mkdir -p "$dir"
+        f=0
+        while [ "$f" -lt "$FANOUT" ]; do
+            cp "$SEED" "$dir/f$f"
+            f=$(( f + 1 ))
+        done
+        dir="$dir/sub"
+        level=$(( level + 1 ))
+    done
+}
+
+CONF="$SANDBOX/bench.conf"
+: > "$CONF"
+i=0
+while [ "$i" -lt "$ENTRIES" ]; do
+    rel="$(nested "$i")e$i"
+    if [ $(( i % 100 )) -lt "$DIR_PCT" ]; then
+        fill_dir "$BASE/$rel"
+        echo "$rel/ -> ~/.bench/$rel/" >> "$CONF"
+    else
+        mkdir -p "$(dirname "$BASE/$rel")"
+        cp "$SEED" "$BASE/$rel"
+        echo "$rel -> ~/.bench/$rel" >> "$CONF"
+    fi
+    i=$(( i + 1 ))
+done
+rm -f "$SEED"
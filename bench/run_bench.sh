@@ -0,0 +1,102 @@
+#!/bin/sh
+# Mede install/status/uninstall/collect sobre workloads sintéticos.
+#
+# Uso: run_bench.sh <binário dotmgr>
+#
+# Cada rodada gera um sandbox novo (em /dev/shm quando disponível) com HOME
+# e diretório de estado falsos. "cold" é a primeira execução do comando sobre
+# o estado recém-gerado; "warm" são as repetições sobre o estado resultante.
+#
+# Variáveis: BENCH_RUNS (default 3), BENCH_WARM (default 3), BENCH_OUT
+# (default bench_output.txt), BENCH_DIR e as de gen_workload.sh.
+#
+# Saída TSV: command phase run entries ns rc
+set -eu
+
+DOTMGR=${1:?"uso: $0 <binário dotmgr>"}
+case "$DOTMGR" in
+    /*) ;;
+    *) DOTMGR="$(pwd)/$DOTMGR" ;;
+esac
+HERE=$(cd "$(dirname "$0")" && pwd)
+RUNS=${BENCH_RUNS:-3}
+WARM=${BENCH_WARM:-3}
+OUT=${BENCH_OUT:-bench_output.txt}
+ENTRIES=${BENCH_ENTRIES:-200}
+
+if [ -z "${BENCH_DIR:-}" ]; then
+    if [ -d /dev/shm ] && [ -w /dev/shm ]; then
+        BENCH_DIR=/dev/shm
+    else
+        BENCH_DIR=${TMPDIR:-/tmp}
+    fi
+fi
+SANDBOX=$(mktemp -d "$BENCH_DIR/dotmgr-bench.XXXXXX")
+trap 'rm -rf "$SANDBOX"' EXIT INT TERM
+WORK="$SANDBOX/work"
+
+now_ns() {
+    t=$(date +%s%N)
+    case "$t" in
+        *N) echo $(( $(date +%s) * 1000000000 )) ;;
+        *) echo "$t" ;;
+    esac
+}
+
+measure() {
+    cmd=$1
+    phase=$2
+    run=$3
+    start=$(now_ns)
+    rc=0
+    HOME="$WORK/home" XDG_STATE_HOME="$WORK/state" "$DOTMGR" "$cmd" \
+        --config "$WORK/bench.conf" --repo "$WORK/repo" \
+        --state-dir "$WORK/state" > /dev/null 2>&1 || rc=$?
+    end=$(now_ns)
+    printf '%s\t%s\t%s\t%s\t%s\t%s\n' "$cmd" "$phase" "$run" "$ENTRIES" $(( end - start )) "$rc" >> "$OUT"
+}
+
+series() {
+    cmd=$1
+    run=$2
+    measure "$cmd" cold "$run"
+    w=0
+    while [ "$w" -lt "$WARM" ]; do
+        measure "$cmd" warm "$run"
+        w=$(( w + 1 ))
+    done
+}
+
+{
+    echo "# dotmgr bench v1"
+    echo "# sandbox=$BENCH_DIR entries=$ENTRIES depth=${BENCH_DEPTH:-2} file_size=${BENCH_FILE_SIZE:-4096} fanout=${BENCH_FANOUT:-8} dir_pct=${BENCH_DIR_PCT:-10} runs=$RUNS warm=$WARM"
+    printf 'command\tphase\trun\tentries\tns\trc\n'
+} > "$OUT"
+
+run=1
+while [ "$run" -le "$RUNS" ]; do
+    sh "$HERE/gen_workload.sh" "$WORK" link
+    series install "$run"
+    series status "$run"
+    series uninstall "$run"
+    sh "$HERE/gen_workload.sh" "$WORK" collect
+    series collect "$run"
+    run=$(( run + 1 ))
+done
+
+# Resumo legível: mediana por comando/fase.
+printf '%-10s %-5s %12s\n' command phase median_ms >&2
+awk -F '\t' '
+    /^#/ || $1 == "command" { next }
+    { key = $1 "\t" $2; n[key]++; v[key, n[key]] = $5; if ($6 != 0) failed[key]++ }
+    END {
+        for (key in n) {
+            c = n[key]
+            for (i = 1; i <= c; i++) s[i] = v[key, i]
+            for (i = 2; i <= c; i++) { x = s[i]; j = i - 1; while (j > 0 && s[j] > x) { s[j + 1] = s[j]; j-- } s[j + 1] = x }
+            m = (c % 2) ? s[(c + 1) / 2] : (s[c / 2] + s[c / 2 + 1]) / 2
+            split(key, k, "\t")
+            printf "%-10s %-5s %12.2f %s\n", k[1], k[2], m / 1e6, failed[key] ? "(falhas: " failed[key] ")" : ""
+        }
+    }' "$OUT" | sort >&2
+echo "Resultados em $OUT" >&2
@@ -0,0 +1,16 @@
+#ifndef DOTMGR_BACKUP_CATALOG_H
+#define DOTMGR_BACKUP_CATALOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dotmgr.h"
+
+bool backup_catalog_record(const AppOptions *opts, const char *target, const char *backup);
+bool backup_catalog_lookup(const AppOptions *opts, const char *target, char *backup, size_t len);
+bool backup_catalog_restore(const AppOptions *opts, const char *target);
+bool backup_catalog_restore_from(const AppOptions *opts, const char *target, const char *backup);
+bool backup_catalog_compact(const AppOptions *opts);
+bool backup_catalog_flush(const AppOptions *opts);
+
+#endif
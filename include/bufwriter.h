@@ -0,0 +1,28 @@
+#ifndef DOTMGR_BUFWRITER_H
+#define DOTMGR_BUFWRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define BUFWRITER_DEFAULT_CAPACITY (64 * 1024)
+
+typedef struct {
+    FILE *fp;
+    bool owns_fp;
+    char *data;
+    size_t len;
+    size_t capacity;
+    bool failed;
+} BufWriter;
+
+bool bufwriter_open(BufWriter *writer, const char *path, size_t capacity);
+bool bufwriter_attach(BufWriter *writer, FILE *fp, size_t capacity);
+void bufwriter_write(BufWriter *writer, const char *data, size_t len);
+void bufwriter_puts(BufWriter *writer, const char *text);
+void bufwriter_printf(BufWriter *writer, const char *fmt, ...);
+void bufwriter_json_string(BufWriter *writer, const char *text);
+bool bufwriter_flush(BufWriter *writer);
+bool bufwriter_close(BufWriter *writer);
+
+#endif
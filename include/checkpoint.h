@@ -0,0 +1,23 @@
+#ifndef DOTMGR_CHECKPOINT_H
+#define DOTMGR_CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dotmgr.h"
+
+/* Progresso de install/collect em <state-dir>/checkpoint-<comando>-<chave>.tsv, um por config/repo/máquina:
+ * entradas concluídas e o offset de cópias grandes em andamento. Removido ao fim de uma execução sem
+ * falhas; --resume retoma a partir dele. */
+
+#define CHECKPOINT_PREFIX "checkpoint"
+
+bool checkpoint_begin(const AppOptions *opts);
+void checkpoint_end(bool complete);
+bool checkpoint_active(void);
+bool checkpoint_done(const char *target);
+void checkpoint_mark_done(const char *target);
+bool checkpoint_partial(const char *dst, long long size, long long mtime_ns, long long *offset);
+void checkpoint_save_partial(const char *dst, long long offset, long long size, long long mtime_ns);
+
+#endif
@@ -3,6 +3,13 @@
 
 #include "dotmgr.h"
 
+/* Arquivo de trabalho das cópias grandes retomáveis, ao lado do destino no repositório. */
+#define COLLECT_PARTIAL_SUFFIX ".dotmgr-partial"
+
 bool collect_entry(const AppOptions *opts, const DotfileEntry *entry);
+bool collect_copy_tree(const AppOptions *opts, const char *src, const char *dst);
+bool collect_sync(const AppOptions *opts);
+/* Torna a cópia no repositório durável antes que o destino original seja substituído por ela. */
+bool collect_sync_entry(const AppOptions *opts);
 
 #endif
@@ -0,0 +1,22 @@
+#ifndef DOTMGR_CONFIG_INDEX_H
+#define DOTMGR_CONFIG_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dotmgr.h"
+
+/* Índice montado no parse: entradas por tag e entradas ordenadas por destino. Um filtro
+ * --only/--except custa proporcional às entradas selecionadas, não ao arquivo inteiro. */
+
+typedef struct ConfigIndex ConfigIndex;
+
+ConfigIndex *config_index_create(void);
+bool config_index_tag(ConfigIndex *index, const char *tag, size_t entry);
+bool config_index_finish(ConfigIndex *index, const DotfileConfig *config);
+void config_index_free(ConfigIndex *index);
+bool config_has_filter(const AppOptions *opts);
+bool config_select(const AppOptions *opts, const DotfileConfig *config, DotfileConfig *view, size_t **origin);
+void config_view_free(DotfileConfig *view);
+
+#endif
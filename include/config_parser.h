@@ -2,8 +2,13 @@
 #define DOTMGR_CONFIG_PARSER_H
 
 #include "dotmgr.h"
+#include "path_expand.h"
+
+/* Recebe as entradas na ordem do arquivo; false interrompe a leitura. */
+typedef bool (*ConfigEntrySink)(const DotfileEntry *entry, size_t line_number, void *user);
 
 bool load_config(const AppOptions *opts, DotfileConfig *config);
+bool config_stream(const AppOptions *opts, PathVars *vars, ConfigEntrySink sink, void *user);
 void free_config(DotfileConfig *config);
 
 #endif
@@ -0,0 +1,14 @@
+#ifndef DOTMGR_CONFLICT_BATCH_H
+#define DOTMGR_CONFLICT_BATCH_H
+
+#include <stdbool.h>
+
+#include "dotmgr.h"
+#include "runner.h"
+
+bool run_batch(const AppOptions *opts, const DotfileConfig *config, RunSummary *summary);
+/* Padrão de uma regra de decisão: terminado em '/' casa o diretório e o que está dentro; sem '/' é um
+ * glob ('*', '?') sobre o nome do arquivo; com '/' é um glob sobre o caminho inteiro. */
+bool conflict_pattern_matches(const char *pattern, const char *target);
+
+#endif
@@ -9,6 +9,10 @@ typedef enum {
     CONFLICT_ERROR
 } ConflictOutcome;
 
-ConflictOutcome resolve_conflict(const AppOptions *opts, const char *target_path);
+ConflictOutcome resolve_conflict(const AppOptions *opts, const char *target_path, const char *source_path);
+bool conflict_same_content(const char *target_path, const char *source_path);
+bool conflict_needs_decision(const char *target_path, const char *source_path);
+bool conflict_backup(const AppOptions *opts, const char *path);
+bool conflict_remove(const AppOptions *opts, const char *path);
 
 #endif
@@ -0,0 +1,13 @@
+#ifndef DOTMGR_DEPLOY_COPY_H
+#define DOTMGR_DEPLOY_COPY_H
+
+#include "dotmgr.h"
+
+bool deploy_install_entry(const AppOptions *opts, const DotfileEntry *entry);
+bool deploy_uninstall_entry(const AppOptions *opts, const DotfileEntry *entry);
+bool deploy_status_entry(const AppOptions *opts, const DotfileEntry *entry);
+EntryStatus deploy_inspect_status(const AppOptions *opts, const DotfileEntry *entry);
+bool deploy_entry_conflicts(const AppOptions *opts, const DotfileEntry *entry);
+bool deploy_collect_entry(const AppOptions *opts, const DotfileEntry *entry);
+
+#endif
@@ -4,6 +4,7 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
@@ -13,24 +14,66 @@ typedef enum {
     CMD_INSTALL,
     CMD_UNINSTALL,
     CMD_STATUS,
-    CMD_COLLECT
+    CMD_COLLECT,
+    CMD_PLAN,
+    CMD_APPLY,
+    CMD_BATCH,
+    CMD_RECONCILE,
+    CMD_GC
 } CommandType;
 
 typedef enum {
     CONFLICT_BACKUP,
     CONFLICT_INTERACTIVE,
-    CONFLICT_FORCE
+    CONFLICT_FORCE,
+    CONFLICT_BATCH
 } ConflictMode;
 
+typedef enum {
+    DEPLOY_LINK,
+    DEPLOY_RENDER,
+    DEPLOY_COPY,
+    DEPLOY_HARDLINK
+} DeployMode;
+
+/* Ordenado por gravidade: o pior estado define o código de saída do status estruturado. */
+typedef enum {
+    STATUS_OK,
+    STATUS_STALE,
+    STATUS_MISSING,
+    STATUS_DIVERGENT,
+    STATUS_CONFLICT,
+    STATUS_ERROR,
+    STATUS_STATE_COUNT
+} EntryStatus;
+
+typedef enum {
+    STATUS_FORMAT_TEXT,
+    STATUS_FORMAT_JSON,
+    STATUS_FORMAT_TSV
+} StatusFormat;
+
+typedef enum {
+    ROOT_FAILURE_CONTINUE,
+    ROOT_FAILURE_ABORT
+} RootFailurePolicy;
+
 typedef struct {
     char source_path[PATH_MAX];
     char target_path[PATH_MAX];
     bool is_directory;
+    DeployMode mode;
 } DotfileEntry;
 
+struct PathVars;
+struct ConfigIndex;
+
 typedef struct {
     DotfileEntry *entries;
     size_t count;
+    uint64_t vars_fingerprint;
+    struct PathVars *vars;
+    struct ConfigIndex *index;
 } DotfileConfig;
 
 typedef struct {
@@ -45,6 +88,26 @@ typedef struct {
     char git_message[256];
     bool config_explicit;
     CommandType command;
+    CommandType plan_command;
+    char plan_path[PATH_MAX];
+    int jobs;
+    char state_dir[PATH_MAX];
+    bool restore_backups;
+    RootFailurePolicy root_failure_policy;
+    bool profile;
+    char trace_path[PATH_MAX];
+    StatusFormat status_format;
+    char prom_path[PATH_MAX];
+    char only_filter[PATH_MAX];
+    char except_filter[PATH_MAX];
+    char gc_skip[PATH_MAX];
+    bool gc_delete;
+    long long collect_max_size;
+    bool resume;
+    double io_rate;
+    int iops;
+    double max_load;
+    bool stream;
 } AppOptions;
 
 #endif
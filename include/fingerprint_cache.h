@@ -0,0 +1,24 @@
+#ifndef DOTMGR_FINGERPRINT_CACHE_H
+#define DOTMGR_FINGERPRINT_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dotmgr.h"
+
+typedef struct {
+    uint64_t input_hash;
+    uint64_t content_hash;
+    long long size;
+    long long mtime_ns;
+    unsigned long long inode;
+} FileFingerprint;
+
+bool fingerprint_stat(const char *path, FileFingerprint *fp);
+bool fingerprint_same_stat(const FileFingerprint *a, const FileFingerprint *b);
+bool fingerprint_cache_get(const AppOptions *opts, const char *cache, const char *key, FileFingerprint *out);
+bool fingerprint_cache_put(const AppOptions *opts, const char *cache, const char *key, const FileFingerprint *fp);
+void fingerprint_cache_remove(const AppOptions *opts, const char *cache, const char *key);
+bool fingerprint_cache_flush(const AppOptions *opts);
+
+#endif
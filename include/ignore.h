@@ -0,0 +1,21 @@
+#ifndef DOTMGR_IGNORE_H
+#define DOTMGR_IGNORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define IGNORE_FILE ".dotmgrignore"
+
+/* Regras no formato do .gitignore compiladas uma vez: nomes literais, sufixos ('*.swp') e caminhos
+ * fixos viram consultas em tabela hash; só os demais globs são testados um a um. Vale a última regra. */
+
+typedef struct IgnoreRules IgnoreRules;
+
+IgnoreRules *ignore_create(void);
+bool ignore_add(IgnoreRules *rules, const char *line);
+bool ignore_load(IgnoreRules *rules, const char *path);
+bool ignore_match(const IgnoreRules *rules, const char *relative, bool is_dir);
+size_t ignore_count(const IgnoreRules *rules);
+void ignore_free(IgnoreRules *rules);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef DOTMGR_IO_SCHED_H
+#define DOTMGR_IO_SCHED_H
+
+#include <stdint.h>
+
+#include "dotmgr.h"
+#include "profile.h"
+
+/* Orçamento de I/O da execução: token buckets de bytes copiados (--io-rate) e de chamadas ao sistema
+ * de arquivos (--iops), recuo proporcional acima de --max-load e classe de I/O idle enquanto ativo. */
+
+#define IO_BURST_SECONDS 0.25
+
+typedef struct {
+    double rate;
+    double fallback;
+    double tokens;
+    uint64_t last_ns;
+} IoTokenBucket;
+
+void io_sched_begin(const AppOptions *opts);
+void io_sched_end(const AppOptions *opts);
+void io_sched_bytes(uint64_t bytes);
+/* Toda chamada ao sistema de arquivos passa por aqui: cobra uma operação do --iops e a conta no --profile.
+ * Pode dormir; quem chama com um lock tomado faz esperar quem disputa o mesmo lock. */
+void fs_op(ProfileFsCall call);
+/* Repõe o saldo pelo tempo decorrido (a primeira cobrança começa com o burst cheio, rate * IO_BURST_SECONDS,
+ * que também é o teto), desconta amount e devolve quantos ns esperar para quitar um saldo negativo. */
+uint64_t io_bucket_charge(IoTokenBucket *bucket, double rate, double amount, uint64_t now_ns);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef DOTMGR_LIBDOTMGR_H
+#define DOTMGR_LIBDOTMGR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dotmgr.h"
+#include "multi_root.h"
+#include "runner.h"
+#include "status_report.h"
+#include "utils.h"
+
+/* API embutível (libdotmgr.a / libdotmgr.so). Um contexto guarda opções, raízes e a config carregada,
+ * que é reutilizada entre operações até dotmgr_reload ou até que o arquivo, config/repo/máquina nas
+ * opções ou as variáveis usadas na expansão mudem. Caches, catálogo de backups e sinks são globais
+ * ao processo: as operações são serializadas entre contextos (nunca rodam ao mesmo tempo) e o estado é
+ * descarregado ao fim de cada uma. A API não é reentrante: chamada de dentro de um callback de log ou de
+ * progresso, uma operação devolve false com errno = EDEADLK. */
+
+typedef struct DotmgrContext DotmgrContext;
+
+typedef struct {
+    size_t processed;
+    size_t failed;
+    int exit_code;
+} DotmgrResult;
+
+bool dotmgr_options_init(AppOptions *opts);
+DotmgrContext *dotmgr_open(const AppOptions *opts);
+void dotmgr_close(DotmgrContext *ctx);
+AppOptions *dotmgr_options(DotmgrContext *ctx);
+RootList *dotmgr_roots(DotmgrContext *ctx);
+void dotmgr_set_log(DotmgrContext *ctx, LogSink sink, void *user);
+void dotmgr_set_progress(DotmgrContext *ctx, RunProgress progress, void *user);
+bool dotmgr_reload(DotmgrContext *ctx);
+const DotfileConfig *dotmgr_config(DotmgrContext *ctx);
+bool dotmgr_run(DotmgrContext *ctx, CommandType command, DotmgrResult *result);
+bool dotmgr_status(DotmgrContext *ctx, StatusReport *report);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef DOTMGR_LINK_GC_H
+#define DOTMGR_LINK_GC_H
+
+#include "dotmgr.h"
+#include "multi_root.h"
+#include "runner.h"
+
+bool run_gc(const AppOptions *opts, const DotfileConfig *config, const RootList *roots, RunSummary *summary);
+/* Normalização léxica ('.', '..', barras repetidas) de um caminho absoluto: o destino do link pode nem existir. */
+bool gc_clean_path(const char *path, char *output, size_t len);
+/* Termo de --skip-dir: sem '/' vale para qualquer diretório com esse nome; com '/' é relativo à raiz varrida. */
+bool gc_skip_matches(const char *term, const char *relative, const char *name);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef DOTMGR_METRICS_H
+#define DOTMGR_METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dotmgr.h"
+
+void metrics_reset(void);
+void metrics_add_copied_bytes(uint64_t bytes);
+uint64_t metrics_copied_bytes(void);
+void metrics_git_sync(bool ok);
+void metrics_status_counts(const size_t counts[STATUS_STATE_COUNT]);
+bool metrics_record_run(const AppOptions *opts, bool ok);
+bool metrics_write_prom(const AppOptions *opts, const char *path);
+
+#endif
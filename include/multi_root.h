@@ -0,0 +1,31 @@
+#ifndef DOTMGR_MULTI_ROOT_H
+#define DOTMGR_MULTI_ROOT_H
+
+#include "dotmgr.h"
+
+typedef enum {
+    ROOT_PREFIX,
+    ROOT_HOME
+} RootKind;
+
+typedef struct {
+    char path[PATH_MAX];
+    RootKind kind;
+} RootSpec;
+
+typedef struct {
+    RootSpec *items;
+    size_t count;
+    size_t capacity;
+} RootList;
+
+bool root_list_add(RootList *list, const char *path, RootKind kind);
+bool root_list_load(RootList *list, const char *file);
+void root_list_free(RootList *list);
+bool run_multi_root(const AppOptions *opts, const DotfileConfig *config, const RootList *roots);
+/* Destino da config dentro da raiz: ROOT_PREFIX prefixa o caminho inteiro; ROOT_HOME troca o HOME (em
+ * qualquer das duas grafias) pelo da raiz, e destinos fora do HOME voltam com *outside. */
+bool root_rebase_target(const RootSpec *root, const char *home, const char *home_norm, const char *target,
+                        char *output, size_t len, bool *outside);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef DOTMGR_PATH_EXPAND_H
+#define DOTMGR_PATH_EXPAND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dotmgr.h"
+
+typedef enum {
+    PATH_TOKEN_LITERAL,
+    PATH_TOKEN_HOME,
+    PATH_TOKEN_ENV,
+    PATH_TOKEN_VAR
+} PathTokenKind;
+
+struct PathTemplate;
+
+typedef struct {
+    PathTokenKind kind;
+    char *text;
+    struct PathTemplate *fallback;
+} PathToken;
+
+typedef struct PathTemplate {
+    PathToken *tokens;
+    size_t count;
+} PathTemplate;
+
+typedef struct {
+    char *name;
+    char *value;
+    bool builtin;
+    bool from_env;
+} PathVar;
+
+typedef struct PathVars {
+    PathVar *vars;
+    size_t count;
+    size_t capacity;
+    char machine_name[64];
+} PathVars;
+
+bool path_template_compile(const char *raw, PathTemplate *tpl);
+void path_template_free(PathTemplate *tpl);
+bool path_template_render(const PathTemplate *tpl, PathVars *vars, char *output, size_t len);
+
+void path_vars_init(PathVars *vars, const AppOptions *opts);
+void path_vars_free(PathVars *vars);
+bool path_vars_define(PathVars *vars, const char *name, const char *value);
+const char *path_vars_lookup(PathVars *vars, const char *name, bool is_env);
+uint64_t path_vars_fingerprint(const PathVars *vars);
+bool path_vars_stale(const PathVars *vars);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef DOTMGR_PIPELINE_H
+#define DOTMGR_PIPELINE_H
+
+#include "dotmgr.h"
+#include "runner.h"
+#include "strmap.h"
+
+/* --stream: uma thread lê a config e entrega as entradas numa fila limitada, executadas à medida que chegam.
+ * A primeira operação não espera o parse do arquivo inteiro e a memória não cresce com a config, fora um
+ * índice de destinos usado para avisar de destinos repetidos ou aninhados. */
+
+bool pipeline_supported(const AppOptions *opts, bool has_roots);
+bool run_pipeline(const AppOptions *opts, RunSummary *summary);
+
+/* Índice incremental de destinos (destino -> linha) e dos diretórios que contêm algum destino. */
+typedef struct {
+    StrMap targets;
+    StrMap parents;
+} PipelineTargetIndex;
+
+#define PIPELINE_TARGET_REPEATED 1u
+#define PIPELINE_TARGET_CONTAINS 2u
+#define PIPELINE_TARGET_NESTED 4u
+
+/* Registra o destino no índice e devolve os avisos emitidos (PIPELINE_TARGET_*). */
+unsigned pipeline_check_target(PipelineTargetIndex *index, const char *target, size_t line);
+
+#endif
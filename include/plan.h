@@ -0,0 +1,54 @@
+#ifndef DOTMGR_PLAN_H
+#define DOTMGR_PLAN_H
+
+#include <stdio.h>
+
+#include "dotmgr.h"
+
+typedef enum {
+    PLAN_OP_MKDIR,
+    PLAN_OP_BACKUP,
+    PLAN_OP_UNLINK,
+    PLAN_OP_SYMLINK,
+    PLAN_OP_COPY,
+    PLAN_OP_RESTORE
+} PlanOpType;
+
+typedef enum {
+    PLAN_EXPECT_ANY,
+    PLAN_EXPECT_ABSENT,
+    PLAN_EXPECT_DIR,
+    PLAN_EXPECT_FILE,
+    PLAN_EXPECT_LINK
+} PlanExpectKind;
+
+typedef struct {
+    PlanExpectKind kind;
+    long long size;
+    long long mtime;
+    char *link_target;
+} PlanExpect;
+
+typedef struct {
+    PlanOpType type;
+    char *path;
+    char *arg;
+    bool is_directory;
+    PlanExpect expect;
+    size_t *deps;
+    size_t dep_count;
+} PlanOp;
+
+typedef struct {
+    PlanOp *ops;
+    size_t count;
+    size_t capacity;
+} Plan;
+
+bool plan_build(const AppOptions *opts, const DotfileConfig *config, CommandType command, Plan *plan);
+bool plan_write(const Plan *plan, FILE *out);
+bool plan_read(FILE *in, Plan *plan);
+bool plan_apply(const AppOptions *opts, const Plan *plan);
+void plan_free(Plan *plan);
+
+#endif
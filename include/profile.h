@@ -0,0 +1,62 @@
+#ifndef DOTMGR_PROFILE_H
+#define DOTMGR_PROFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PROFILE_SLOWEST_ENTRIES 10
+
+typedef enum {
+    PROFILE_MAIN,
+    PROFILE_LOAD_CONFIG,
+    PROFILE_NORMALIZE,
+    PROFILE_ENTRY,
+    PROFILE_INSTALL,
+    PROFILE_COLLECT,
+    PROFILE_CONFLICT,
+    PROFILE_MKDIR,
+    PROFILE_SYMLINK,
+    PROFILE_COPY,
+    PROFILE_SYNC,
+    PROFILE_GIT_SYNC,
+    PROFILE_GIT_COMMAND,
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+typedef enum {
+    PROFILE_FS_ACCESS,
+    PROFILE_FS_STAT,
+    PROFILE_FS_LSTAT,
+    PROFILE_FS_READLINK,
+    PROFILE_FS_REALPATH,
+    PROFILE_FS_MKDIR,
+    PROFILE_FS_SYMLINK,
+    PROFILE_FS_UNLINK,
+    PROFILE_FS_RENAME,
+    PROFILE_FS_OPEN,
+    PROFILE_FS_OPENDIR,
+    PROFILE_FS_COUNT
+} ProfileFsCall;
+
+typedef struct {
+    ProfilePhase phase;
+    ProfilePhase parent;
+    uint64_t start;
+} ProfileSpan;
+
+void profile_enable(bool enabled);
+bool profile_enabled(void);
+void profile_record(bool enabled);
+void profile_reset(void);
+const char *profile_phase_name(ProfilePhase phase);
+bool profile_phase_totals(ProfilePhase phase, uint64_t *count, uint64_t *total_ns);
+void profile_begin(ProfileSpan *span, ProfilePhase phase);
+uint64_t profile_end(ProfileSpan *span);
+void profile_end_detail(ProfileSpan *span, const char *detail);
+void profile_end_entry(ProfileSpan *span, const char *target);
+void profile_fs(ProfileFsCall call);
+void profile_report(FILE *out);
+
+#endif
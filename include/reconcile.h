@@ -0,0 +1,9 @@
+#ifndef DOTMGR_RECONCILE_H
+#define DOTMGR_RECONCILE_H
+
+#include "dotmgr.h"
+#include "runner.h"
+
+bool run_reconcile(const AppOptions *opts, const DotfileConfig *config, RunSummary *summary);
+
+#endif
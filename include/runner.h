@@ -0,0 +1,21 @@
+#ifndef DOTMGR_RUNNER_H
+#define DOTMGR_RUNNER_H
+
+#include "dotmgr.h"
+
+typedef struct {
+    size_t processed;
+    size_t failed;
+    int exit_code;
+} RunSummary;
+
+typedef void (*RunProgress)(const DotfileEntry *entry, bool ok, void *user);
+
+void runner_set_progress(RunProgress progress, void *user);
+bool run_entry(const AppOptions *opts, const DotfileConfig *config, size_t index, RunSummary *summary);
+/* Para entradas fora de config->entries (--stream); number é a posição usada nas mensagens. */
+bool run_single_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry, size_t number,
+                      RunSummary *summary);
+bool run_command(const AppOptions *opts, const DotfileConfig *config, RunSummary *summary);
+
+#endif
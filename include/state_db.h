@@ -0,0 +1,43 @@
+#ifndef DOTMGR_STATE_DB_H
+#define DOTMGR_STATE_DB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dotmgr.h"
+
+/* O que o dotmgr criou (links, cópias, hardlinks, renders, backups) com o stat do destino no momento.
+ * state.log recebe uma linha por mudança; state.idx é um snapshot ordenado por hash, lido via mmap,
+ * e só a cauda do log posterior a ele é reprocessada ao abrir. */
+
+typedef enum {
+    STATE_LINK,
+    STATE_COPY,
+    STATE_HARDLINK,
+    STATE_RENDER,
+    STATE_BACKUP,
+    STATE_KIND_COUNT
+} StateKind;
+
+typedef struct {
+    const char *target;
+    const char *source;
+    const char *scope;
+    StateKind kind;
+    long long size;
+    long long mtime_ns;
+    unsigned long long inode;
+} StateRecord;
+
+typedef bool (*StateVisitor)(const StateRecord *record, void *user);
+
+void state_db_set_scope(const char *scope);
+bool state_db_record(const AppOptions *opts, StateKind kind, const char *target, const char *source);
+void state_db_forget(const AppOptions *opts, const char *target);
+bool state_db_lookup(const AppOptions *opts, const char *target, StateRecord *record, char *buffer, size_t len);
+bool state_db_each(const AppOptions *opts, StateVisitor visit, void *user);
+bool state_db_matches_disk(const StateRecord *record);
+bool state_db_flush(const AppOptions *opts);
+const char *state_kind_name(StateKind kind);
+
+#endif
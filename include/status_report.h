@@ -0,0 +1,37 @@
+#ifndef DOTMGR_STATUS_REPORT_H
+#define DOTMGR_STATUS_REPORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dotmgr.h"
+#include "runner.h"
+
+#define STATUS_NO_ACTUAL UINT32_MAX
+
+typedef struct {
+    uint32_t index;
+    uint32_t actual;
+    uint8_t state;
+    uint64_t duration_ns;
+} StatusResult;
+
+typedef struct {
+    StatusResult *results;
+    size_t count;
+    char *strings;
+    size_t strings_len;
+    size_t strings_capacity;
+    size_t counts[STATUS_STATE_COUNT];
+    EntryStatus worst;
+} StatusReport;
+
+bool status_report_build(const AppOptions *opts, const DotfileConfig *config, StatusReport *report);
+const char *status_report_actual(const StatusReport *report, const StatusResult *result);
+void status_report_free(StatusReport *report);
+const char *entry_status_name(EntryStatus state);
+void status_log_result(const DotfileEntry *entry, EntryStatus state, const char *actual);
+int entry_status_exit_code(EntryStatus state);
+bool run_status_report(const AppOptions *opts, const DotfileConfig *config, RunSummary *summary);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef DOTMGR_STRMAP_H
+#define DOTMGR_STRMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    char *key;
+    uint64_t hash;
+    size_t value;
+} StrMapSlot;
+
+typedef struct {
+    StrMapSlot *slots;
+    size_t capacity;
+    size_t count;
+} StrMap;
+
+bool strmap_init(StrMap *map, size_t expected);
+void strmap_free(StrMap *map);
+bool strmap_put(StrMap *map, const char *key, size_t value);
+bool strmap_get(const StrMap *map, const char *key, size_t *value);
+
+#endif
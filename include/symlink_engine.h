@@ -6,5 +6,8 @@
 bool install_entry(const AppOptions *opts, const DotfileEntry *entry);
 bool uninstall_entry(const AppOptions *opts, const DotfileEntry *entry);
 bool status_entry(const AppOptions *opts, const DotfileEntry *entry);
+EntryStatus inspect_entry_status(const DotfileEntry *entry, char *actual, size_t len);
+bool create_entry_symlink(const DotfileEntry *entry, bool dry_run);
+bool remove_entry_symlink(const DotfileEntry *entry, bool dry_run);
 
 #endif
@@ -0,0 +1,29 @@
+#ifndef DOTMGR_TARGET_LOCK_H
+#define DOTMGR_TARGET_LOCK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "dotmgr.h"
+
+/* Locks consultivos por destino entre execuções concorrentes: cada diretório pai cai num dos
+ * TARGET_LOCK_SLOTS bytes de <repo>/.dotmgr.lock, travado com fcntl (OFD no Linux). Execuções sobre
+ * entradas disjuntas seguem em paralelo; as que se sobrepõem esperam só nas entradas em comum. O byte
+ * TARGET_LOCK_SLOTS é o lock de estado, exclusivo enquanto caches e métricas são relidos e regravados. */
+
+#define TARGET_LOCK_FILE ".dotmgr.lock"
+#define TARGET_LOCK_SLOTS 1024
+
+typedef struct {
+    size_t slot;
+    bool held;
+} TargetLock;
+
+void target_lock_begin(const AppOptions *opts);
+void target_lock_end(const AppOptions *opts);
+void target_lock_acquire(const AppOptions *opts, const char *target, TargetLock *lock);
+void target_lock_release(TargetLock *lock);
+void target_lock_state_begin(const AppOptions *opts);
+void target_lock_state_end(void);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef DOTMGR_TEMPLATE_RENDER_H
+#define DOTMGR_TEMPLATE_RENDER_H
+
+#include "dotmgr.h"
+
+bool render_install_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry);
+bool render_uninstall_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry);
+bool render_status_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry);
+EntryStatus render_inspect_status(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry);
+bool render_entry_conflicts(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry);
+bool render_collect_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry);
+
+#endif
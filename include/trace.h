@@ -0,0 +1,13 @@
+#ifndef DOTMGR_TRACE_H
+#define DOTMGR_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool trace_open(const char *path);
+bool trace_enabled(void);
+void trace_complete(const char *name, const char *category, uint64_t start_ns, uint64_t duration_ns,
+                    const char *detail);
+bool trace_close(void);
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #include "dotmgr.h"
 
@@ -11,6 +13,17 @@
 #define LOG_COLOR_WARN   "\033[33m"
 #define LOG_COLOR_ERROR  "\033[31m"
 
+#define HASH_FNV1A64_SEED 0xcbf29ce484222325ULL
+
+typedef enum {
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR
+} LogLevel;
+
+typedef void (*LogSink)(LogLevel level, const char *message, void *user);
+
+void log_set_sink(LogSink sink, void *user);
 void log_info(const char *fmt, ...);
 void log_warn(const char *fmt, ...);
 void log_error(const char *fmt, ...);
@@ -19,12 +32,27 @@ bool expand_home(const char *input, char *output, size_t len);
 bool join_paths(const char *base, const char *relative, char *output, size_t len);
 bool is_absolute_path(const char *path);
 bool ensure_parent_dirs(const char *path, bool dry_run);
+bool create_dir_if_missing(const char *path);
+bool make_dirs(const char *path);
+bool read_file_contents(const char *path, char **data, size_t *len);
+bool write_file_atomic(const char *path, const void *data, size_t len, int mode);
+FILE *open_sibling_temp(const char *path, char *tmp_path, size_t len);
+bool get_state_directory(char *output, size_t len);
 bool path_exists(const char *path);
 bool is_same_symlink_target(const char *link_path, const char *target);
 bool read_symlink_target(const char *link_path, char *buffer, size_t len);
 bool normalize_path(const char *path, char *output, size_t len);
+bool normalize_link_path(const char *path, char *output, size_t len);
 bool get_current_directory(char *output, size_t len);
 bool get_machine_name(char *output, size_t len);
+int default_job_count(void);
+uint64_t monotonic_ns(void);
+uint64_t hash_fnv1a64(const void *data, size_t len, uint64_t seed);
+
+#ifndef _WIN32
+struct stat;
+long long stat_mtime_ns(const struct stat *st);
+#endif
 
 #ifdef _WIN32
 #include <wchar.h>
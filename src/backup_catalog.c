@@ -0,0 +1,394 @@
+#define _DEFAULT_SOURCE
+
+#include "backup_catalog.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "state_db.h"
+#include "strmap.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#define CATALOG_FILE "backups.tsv"
+/* Linhas mortas (substituídas ou restauradas) toleradas além das vivas antes de compactar. */
+#define CATALOG_COMPACT_SLACK 64
+
+typedef struct {
+    char *target;
+    char *backup;
+    long long created;
+    bool removed;
+} CatalogRecord;
+
+typedef struct {
+    char path[PATH_MAX];
+    CatalogRecord *records;
+    size_t count;
+    size_t capacity;
+    StrMap index;
+    size_t lines;
+    bool loaded;
+} BackupCatalog;
+
+static BackupCatalog catalog;
+static pthread_mutex_t catalog_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool catalog_path(const AppOptions *opts, char *output, size_t len) {
+    return join_paths(opts->state_dir, CATALOG_FILE, output, len);
+}
+
+static void catalog_reset(void) {
+    for (size_t i = 0; i < catalog.count; ++i) {
+        free(catalog.records[i].target);
+        free(catalog.records[i].backup);
+    }
+    free(catalog.records);
+    strmap_free(&catalog.index);
+    memset(&catalog, 0, sizeof(catalog));
+}
+
+static bool catalog_put(const char *target, const char *backup, long long created) {
+    size_t existing;
+    if (strmap_get(&catalog.index, target, &existing)) {
+        char *copy = malloc(strlen(backup) + 1);
+        if (!copy) {
+            return false;
+        }
+        strcpy(copy, backup);
+        free(catalog.records[existing].backup);
+        catalog.records[existing].backup = copy;
+        catalog.records[existing].created = created;
+        catalog.records[existing].removed = false;
+        return true;
+    }
+    if (catalog.count == catalog.capacity) {
+        size_t next = catalog.capacity ? catalog.capacity * 2 : 32;
+        CatalogRecord *tmp = realloc(catalog.records, next * sizeof(CatalogRecord));
+        if (!tmp) {
+            return false;
+        }
+        catalog.records = tmp;
+        catalog.capacity = next;
+    }
+    CatalogRecord *record = &catalog.records[catalog.count];
+    record->target = malloc(strlen(target) + 1);
+    record->backup = malloc(strlen(backup) + 1);
+    if (!record->target || !record->backup) {
+        free(record->target);
+        free(record->backup);
+        return false;
+    }
+    strcpy(record->target, target);
+    strcpy(record->backup, backup);
+    record->created = created;
+    record->removed = false;
+    if (!strmap_put(&catalog.index, target, catalog.count)) {
+        free(record->target);
+        free(record->backup);
+        return false;
+    }
+    ++catalog.count;
+    return true;
+}
+
+static bool catalog_load(const AppOptions *opts) {
+    char path[PATH_MAX];
+    if (!catalog_path(opts, path, sizeof(path))) {
+        return false;
+    }
+    if (catalog.loaded && strcmp(catalog.path, path) == 0) {
+        return true;
+    }
+    catalog_reset();
+    snprintf(catalog.path, sizeof(catalog.path), "%s", path);
+    if (!strmap_init(&catalog.index, 64)) {
+        return false;
+    }
+    catalog.loaded = true;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return errno == ENOENT;
+    }
+    char line[2 * PATH_MAX + 64];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        ++catalog.lines;
+        char *backup = strchr(line, '\t');
+        if (!backup) {
+            continue;
+        }
+        *backup++ = '\0';
+        char *created = strchr(backup, '\t');
+        if (created) {
+            *created++ = '\0';
+        }
+        if (strcmp(backup, "-") == 0) {
+            size_t existing;
+            if (strmap_get(&catalog.index, line, &existing)) {
+                catalog.records[existing].removed = true;
+            }
+            continue;
+        }
+        if (!catalog_put(line, backup, created ? atoll(created) : 0)) {
+            fclose(fp);
+            return false;
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+/* Lock consultivo em <catálogo>.lock: quem acrescenta linhas toma leitura, a compactação toma escrita.
+ * Fica num arquivo à parte porque o rename da compactação troca o inode do catálogo. Sem lock, -1. */
+static int lock_catalog(const char *path, bool exclusive) {
+#ifndef _WIN32
+    char lock_path[PATH_MAX + 8];
+    if (snprintf(lock_path, sizeof(lock_path), "%s.lock", path) >= (int)sizeof(lock_path)) {
+        return -1;
+    }
+    int fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    struct flock range;
+    memset(&range, 0, sizeof(range));
+    range.l_type = exclusive ? F_WRLCK : F_RDLCK;
+    range.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &range) != 0) {
+        if (errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+#else
+    (void)path;
+    (void)exclusive;
+    return -1;
+#endif
+}
+
+static void unlock_catalog(int fd) {
+#ifndef _WIN32
+    if (fd >= 0) {
+        close(fd);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+/* backup "-" é um tombstone: o destino foi restaurado. */
+static bool append_line(const AppOptions *opts, const char *target, const char *backup) {
+    if (!make_dirs(opts->state_dir)) {
+        return false;
+    }
+    char path[PATH_MAX];
+    if (!catalog_path(opts, path, sizeof(path))) {
+        return false;
+    }
+    char line[2 * PATH_MAX + 64];
+    int len = snprintf(line, sizeof(line), "%s\t%s\t%lld\n", target, backup, (long long)time(NULL));
+    if (len < 0 || len >= (int)sizeof(line)) {
+        return false;
+    }
+#ifndef _WIN32
+    int lock = lock_catalog(path, false);
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        log_warn("Não foi possível abrir catálogo de backups '%s': %s", path, strerror(errno));
+        unlock_catalog(lock);
+        return false;
+    }
+    bool ok = write(fd, line, (size_t)len) == len;
+    close(fd);
+    unlock_catalog(lock);
+#else
+    FILE *fp = fopen(path, "ab");
+    if (!fp) {
+        log_warn("Não foi possível abrir catálogo de backups '%s': %s", path, strerror(errno));
+        return false;
+    }
+    bool ok = fwrite(line, 1, (size_t)len, fp) == (size_t)len;
+    fclose(fp);
+#endif
+    return ok;
+}
+
+bool backup_catalog_record(const AppOptions *opts, const char *target, const char *backup) {
+    if (!opts || !target || !backup || opts->dry_run) {
+        return false;
+    }
+    pthread_mutex_lock(&catalog_lock);
+    bool ok = append_line(opts, target, backup);
+    if (ok && catalog.loaded) {
+        ok = catalog_put(target, backup, (long long)time(NULL));
+        ++catalog.lines;
+    }
+    pthread_mutex_unlock(&catalog_lock);
+    if (!ok) {
+        log_warn("Backup de '%s' não foi registrado no catálogo", target);
+    }
+    state_db_record(opts, STATE_BACKUP, backup, target);
+    return ok;
+}
+
+bool backup_catalog_lookup(const AppOptions *opts, const char *target, char *backup, size_t len) {
+    if (!opts || !target || !backup) {
+        return false;
+    }
+    pthread_mutex_lock(&catalog_lock);
+    bool found = false;
+    size_t index;
+    if (catalog_load(opts) && strmap_get(&catalog.index, target, &index) && !catalog.records[index].removed) {
+        found = snprintf(backup, len, "%s", catalog.records[index].backup) < (int)len;
+    }
+    pthread_mutex_unlock(&catalog_lock);
+    return found;
+}
+
+bool backup_catalog_restore(const AppOptions *opts, const char *target) {
+    char backup[PATH_MAX];
+    if (!backup_catalog_lookup(opts, target, backup, sizeof(backup))) {
+        if (opts->verbose) {
+            log_info("Nenhum backup catalogado para %s", target);
+        }
+        return true;
+    }
+    return backup_catalog_restore_from(opts, target, backup);
+}
+
+/* Devolve um backup já localizado (pelo catálogo ou por um plano) e registra o tombstone. */
+bool backup_catalog_restore_from(const AppOptions *opts, const char *target, const char *backup) {
+    if (!opts || !target || !backup) {
+        return false;
+    }
+    if (!path_exists(backup)) {
+        log_warn("Backup catalogado não existe mais: %s", backup);
+        return true;
+    }
+    if (opts->dry_run) {
+        log_info("[dry-run] restaurar %s -> %s", backup, target);
+        return true;
+    }
+#ifndef _WIN32
+    struct stat st;
+    if (lstat(target, &st) == 0) {
+        log_warn("Destino %s ocupado, backup %s mantido", target, backup);
+        return true;
+    }
+#else
+    if (path_exists(target)) {
+        log_warn("Destino %s ocupado, backup %s mantido", target, backup);
+        return true;
+    }
+#endif
+    if (rename(backup, target) != 0) {
+        log_error("Não foi possível restaurar '%s': %s", backup, strerror(errno));
+        return false;
+    }
+    log_info("Backup restaurado: %s", target);
+    state_db_forget(opts, backup);
+
+    pthread_mutex_lock(&catalog_lock);
+    if (!append_line(opts, target, "-")) {
+        log_warn("Restauração de '%s' não foi registrada no catálogo", target);
+    } else if (catalog.loaded) {
+        size_t index;
+        if (strmap_get(&catalog.index, target, &index)) {
+            catalog.records[index].removed = true;
+        }
+        ++catalog.lines;
+    }
+    pthread_mutex_unlock(&catalog_lock);
+    return true;
+}
+
+static size_t live_records(void) {
+    size_t live = 0;
+    for (size_t i = 0; i < catalog.count; ++i) {
+        live += !catalog.records[i].removed;
+    }
+    return live;
+}
+
+#ifndef _WIN32
+static bool rewrite_catalog(void) {
+    char tmp_path[PATH_MAX + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", catalog.path);
+    int fd = mkstemp(tmp_path);
+    FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!fp) {
+        log_warn("Não foi possível compactar catálogo de backups: %s", strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+            remove(tmp_path);
+        }
+        return false;
+    }
+    fchmod(fd, 0644);
+    for (size_t i = 0; i < catalog.count; ++i) {
+        const CatalogRecord *record = &catalog.records[i];
+        if (!record->removed) {
+            fprintf(fp, "%s\t%s\t%lld\n", record->target, record->backup, record->created);
+        }
+    }
+    bool ok = fflush(fp) == 0 && fsync(fd) == 0;
+    ok = fclose(fp) == 0 && ok && rename(tmp_path, catalog.path) == 0;
+    if (!ok) {
+        log_warn("Falha ao gravar catálogo de backups '%s'", catalog.path);
+        remove(tmp_path);
+    }
+    return ok;
+}
+#endif
+
+/* Com o lock exclusivo nenhuma outra execução acrescenta linhas; o catálogo é relido do disco para que
+ * o que elas gravaram desde que esta o carregou não se perca na reescrita. No Windows não há lock e o
+ * catálogo só cresce. */
+bool backup_catalog_compact(const AppOptions *opts) {
+    if (!opts) {
+        return false;
+    }
+    bool ok = true;
+    pthread_mutex_lock(&catalog_lock);
+    if (catalog.loaded && !opts->dry_run && catalog.lines > 2 * live_records() + CATALOG_COMPACT_SLACK) {
+#ifndef _WIN32
+        int lock = lock_catalog(catalog.path, true);
+        if (lock >= 0) {
+            catalog_reset();
+            ok = catalog_load(opts);
+            if (ok && catalog.lines > 2 * live_records() + CATALOG_COMPACT_SLACK) {
+                ok = rewrite_catalog();
+            }
+            unlock_catalog(lock);
+        }
+#endif
+    }
+    pthread_mutex_unlock(&catalog_lock);
+    return ok;
+}
+
+/* O catálogo em disco já está atualizado (só recebe appends); aqui só se descarta a cópia em memória. */
+bool backup_catalog_flush(const AppOptions *opts) {
+    if (!opts) {
+        return false;
+    }
+    pthread_mutex_lock(&catalog_lock);
+    catalog_reset();
+    pthread_mutex_unlock(&catalog_lock);
+    return true;
+}
@@ -0,0 +1,159 @@
+#include "bufwriter.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+static bool bufwriter_init(BufWriter *writer, FILE *fp, bool owns_fp, size_t capacity) {
+    memset(writer, 0, sizeof(*writer));
+    writer->capacity = capacity ? capacity : BUFWRITER_DEFAULT_CAPACITY;
+    writer->data = malloc(writer->capacity);
+    if (!writer->data) {
+        return false;
+    }
+    writer->fp = fp;
+    writer->owns_fp = owns_fp;
+    if (owns_fp) {
+        /* O buffer próprio já agrupa as escritas; o do stdio só duplicaria as cópias. */
+        setvbuf(fp, NULL, _IONBF, 0);
+    }
+    return true;
+}
+
+bool bufwriter_open(BufWriter *writer, const char *path, size_t capacity) {
+    if (!writer || !path) {
+        return false;
+    }
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        log_error("Não foi possível abrir '%s' para escrita: %s", path, strerror(errno));
+        return false;
+    }
+    if (!bufwriter_init(writer, fp, true, capacity)) {
+        fclose(fp);
+        return false;
+    }
+    return true;
+}
+
+bool bufwriter_attach(BufWriter *writer, FILE *fp, size_t capacity) {
+    if (!writer || !fp) {
+        return false;
+    }
+    return bufwriter_init(writer, fp, false, capacity);
+}
+
+bool bufwriter_flush(BufWriter *writer) {
+    if (!writer || !writer->fp) {
+        return false;
+    }
+    if (writer->len > 0 && !writer->failed) {
+        if (fwrite(writer->data, 1, writer->len, writer->fp) != writer->len) {
+            writer->failed = true;
+        }
+    }
+    writer->len = 0;
+    return !writer->failed;
+}
+
+void bufwriter_write(BufWriter *writer, const char *data, size_t len) {
+    if (writer->len + len > writer->capacity) {
+        bufwriter_flush(writer);
+        if (len > writer->capacity) {
+            if (!writer->failed && fwrite(data, 1, len, writer->fp) != len) {
+                writer->failed = true;
+            }
+            return;
+        }
+    }
+    memcpy(writer->data + writer->len, data, len);
+    writer->len += len;
+}
+
+void bufwriter_puts(BufWriter *writer, const char *text) {
+    bufwriter_write(writer, text, strlen(text));
+}
+
+void bufwriter_printf(BufWriter *writer, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    size_t space = writer->capacity - writer->len;
+    int needed = vsnprintf(writer->data + writer->len, space, fmt, args);
+    va_end(args);
+    if (needed < 0) {
+        writer->failed = true;
+        return;
+    }
+    if ((size_t)needed < space) {
+        writer->len += (size_t)needed;
+        return;
+    }
+    bufwriter_flush(writer);
+    char *scratch = writer->data;
+    if ((size_t)needed >= writer->capacity) {
+        scratch = malloc((size_t)needed + 1);
+        if (!scratch) {
+            writer->failed = true;
+            return;
+        }
+    }
+    va_start(args, fmt);
+    vsnprintf(scratch, (size_t)needed + 1, fmt, args);
+    va_end(args);
+    if (scratch == writer->data) {
+        writer->len = (size_t)needed;
+    } else {
+        bufwriter_write(writer, scratch, (size_t)needed);
+        free(scratch);
+    }
+}
+
+void bufwriter_json_string(BufWriter *writer, const char *text) {
+    bufwriter_write(writer, "\"", 1);
+    const char *run = text;
+    for (const char *c = text; *c; ++c) {
+        unsigned char ch = (unsigned char)*c;
+        if (ch != '"' && ch != '\\' && ch >= 0x20) {
+            continue;
+        }
+        bufwriter_write(writer, run, (size_t)(c - run));
+        switch (ch) {
+            case '"':
+                bufwriter_write(writer, "\\\"", 2);
+                break;
+            case '\\':
+                bufwriter_write(writer, "\\\\", 2);
+                break;
+            case '\n':
+                bufwriter_write(writer, "\\n", 2);
+                break;
+            case '\t':
+                bufwriter_write(writer, "\\t", 2);
+                break;
+            default:
+                bufwriter_printf(writer, "\\u%04x", ch);
+                break;
+        }
+        run = c + 1;
+    }
+    bufwriter_puts(writer, run);
+    bufwriter_write(writer, "\"", 1);
+}
+
+bool bufwriter_close(BufWriter *writer) {
+    if (!writer || !writer->fp) {
+        return false;
+    }
+    bool ok = bufwriter_flush(writer);
+    if (writer->owns_fp) {
+        ok = fclose(writer->fp) == 0 && ok;
+    } else {
+        ok = fflush(writer->fp) == 0 && ok;
+    }
+    free(writer->data);
+    memset(writer, 0, sizeof(*writer));
+    return ok;
+}
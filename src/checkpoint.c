@@ -0,0 +1,309 @@
+#define _DEFAULT_SOURCE
+
+#include "checkpoint.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strmap.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#define CHECKPOINT_MAGIC "# dotmgr checkpoint 1"
+#define CHECKPOINT_FLUSH_LINES 64
+#define CHECKPOINT_FLUSH_NS 1000000000ULL
+
+typedef struct {
+    long long offset;
+    long long size;
+    long long mtime_ns;
+} PartialRecord;
+
+/* Linhas "done\t<destino>" e "partial\t<offset>\t<tamanho>\t<mtime>\t<destino>" depois do cabeçalho;
+ * o último "partial" de um destino vale. Uma linha cortada por um kill no meio da escrita é descartada. */
+typedef struct {
+    bool active;
+    bool writable;
+    bool resumed;
+    char dir[PATH_MAX];
+    char path[PATH_MAX];
+    char header[128];
+    bool locked;
+    int lock_fd;
+    FILE *out;
+    StrMap done;
+    StrMap partial;
+    PartialRecord *partials;
+    size_t partial_count;
+    size_t partial_capacity;
+    size_t pending;
+    uint64_t last_flush;
+} Checkpoint;
+
+static Checkpoint state;
+static pthread_mutex_t checkpoint_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void checkpoint_reset(void) {
+    if (state.out) {
+        fclose(state.out);
+    }
+#ifndef _WIN32
+    if (state.locked) {
+        close(state.lock_fd);
+    }
+#endif
+    strmap_free(&state.done);
+    strmap_free(&state.partial);
+    free(state.partials);
+    memset(&state, 0, sizeof(state));
+}
+
+static uint64_t checkpoint_key(const AppOptions *opts) {
+    uint64_t hash = HASH_FNV1A64_SEED;
+    hash = hash_fnv1a64(opts->config_path, strlen(opts->config_path) + 1, hash);
+    hash = hash_fnv1a64(opts->repo_path, strlen(opts->repo_path) + 1, hash);
+    hash = hash_fnv1a64(opts->machine_name, strlen(opts->machine_name) + 1, hash);
+    return hash_fnv1a64(opts->project_root, strlen(opts->project_root) + 1, hash);
+}
+
+static bool put_partial(const char *dst, long long offset, long long size, long long mtime_ns) {
+    size_t index;
+    if (!strmap_get(&state.partial, dst, &index)) {
+        if (state.partial_count == state.partial_capacity) {
+            size_t next = state.partial_capacity ? state.partial_capacity * 2 : 8;
+            PartialRecord *tmp = realloc(state.partials, next * sizeof(PartialRecord));
+            if (!tmp) {
+                return false;
+            }
+            state.partials = tmp;
+            state.partial_capacity = next;
+        }
+        index = state.partial_count;
+        if (!strmap_put(&state.partial, dst, index)) {
+            return false;
+        }
+        ++state.partial_count;
+    }
+    state.partials[index].offset = offset;
+    state.partials[index].size = size;
+    state.partials[index].mtime_ns = mtime_ns;
+    return true;
+}
+
+/* Um checkpoint por config/comando (checkpoint-<comando>-<chave>.tsv), travado durante a execução:
+ * outra execução com a mesma chave segue sem checkpoint em vez de truncar ou apagar o desta. Falso só
+ * quando o lock está com outra execução; sem o arquivo de lock, segue como antes. */
+static bool lock_checkpoint(void) {
+#ifndef _WIN32
+    char lock_path[PATH_MAX + 8];
+    if (snprintf(lock_path, sizeof(lock_path), "%s.lock", state.path) >= (int)sizeof(lock_path) ||
+        !make_dirs(state.dir)) {
+        return true;
+    }
+    int fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return true;
+    }
+    struct flock range;
+    memset(&range, 0, sizeof(range));
+    range.l_type = F_WRLCK;
+    range.l_whence = SEEK_SET;
+    if (fcntl(fd, F_SETLK, &range) != 0) {
+        bool busy = errno == EAGAIN || errno == EACCES;
+        close(fd);
+        return !busy;
+    }
+    state.lock_fd = fd;
+    state.locked = true;
+#endif
+    return true;
+}
+
+/* Falso quando não há o que retomar ou o arquivo é de outra config/comando. */
+static bool load_existing(void) {
+    FILE *fp = fopen(state.path, "r");
+    if (!fp) {
+        if (errno == ENOENT) {
+            log_info("Nenhum checkpoint para retomar; executando do início");
+        } else {
+            log_warn("Não foi possível ler checkpoint '%s': %s", state.path, strerror(errno));
+        }
+        return false;
+    }
+    char line[PATH_MAX + 128];
+    if (!fgets(line, sizeof(line), fp) || (line[strcspn(line, "\n")] = '\0', strcmp(line, state.header) != 0)) {
+        log_warn("Checkpoint '%s' é de outra execução; começando do início", state.path);
+        fclose(fp);
+        return false;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        size_t len = strcspn(line, "\n");
+        if (line[len] != '\n') {
+            continue;
+        }
+        line[len] = '\0';
+        if (strncmp(line, "done\t", 5) == 0) {
+            strmap_put(&state.done, line + 5, 0);
+        } else if (strncmp(line, "partial\t", 8) == 0) {
+            long long offset;
+            long long size;
+            long long mtime_ns;
+            int consumed = 0;
+            if (sscanf(line + 8, "%lld\t%lld\t%lld\t%n", &offset, &size, &mtime_ns, &consumed) == 3 && consumed > 0) {
+                put_partial(line + 8 + consumed, offset, size, mtime_ns);
+            }
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+/* Aberto só na primeira linha: uma execução sem progresso não cria o arquivo. */
+static FILE *checkpoint_output(void) {
+    if (state.out || !state.writable) {
+        return state.out;
+    }
+    if (!make_dirs(state.dir) || !(state.out = fopen(state.path, state.resumed ? "a" : "w"))) {
+        log_warn("Não foi possível gravar checkpoint '%s': %s", state.path, strerror(errno));
+        state.writable = false;
+        return NULL;
+    }
+    if (!state.resumed) {
+        fprintf(state.out, "%s\n", state.header);
+    }
+    return state.out;
+}
+
+static void checkpoint_flush_locked(bool force) {
+    uint64_t now = monotonic_ns();
+    if (!state.out || (!force && state.pending < CHECKPOINT_FLUSH_LINES && now - state.last_flush < CHECKPOINT_FLUSH_NS)) {
+        return;
+    }
+    fflush(state.out);
+    state.pending = 0;
+    state.last_flush = now;
+}
+
+bool checkpoint_begin(const AppOptions *opts) {
+    pthread_mutex_lock(&checkpoint_lock);
+    checkpoint_reset();
+    if (opts->command != CMD_INSTALL && opts->command != CMD_COLLECT) {
+        pthread_mutex_unlock(&checkpoint_lock);
+        return true;
+    }
+    const char *command = opts->command == CMD_INSTALL ? "install" : "collect";
+    uint64_t key = checkpoint_key(opts);
+    char file[64];
+    snprintf(file, sizeof(file), CHECKPOINT_PREFIX "-%s-%016llx.tsv", command, (unsigned long long)key);
+    bool ok = snprintf(state.dir, sizeof(state.dir), "%s", opts->state_dir) < (int)sizeof(state.dir) &&
+              join_paths(opts->state_dir, file, state.path, sizeof(state.path)) &&
+              strmap_init(&state.done, 64) && strmap_init(&state.partial, 8);
+    if (!ok) {
+        log_error("Não foi possível preparar checkpoint em '%s'", opts->state_dir);
+        checkpoint_reset();
+        pthread_mutex_unlock(&checkpoint_lock);
+        return false;
+    }
+    snprintf(state.header, sizeof(state.header), "%s\t%s\t%016llx", CHECKPOINT_MAGIC, command,
+             (unsigned long long)key);
+    state.active = true;
+    bool usable = opts->dry_run || lock_checkpoint();
+    if (!usable) {
+        log_warn("Outra execução está usando o checkpoint '%s'; seguindo sem checkpoint", state.path);
+    }
+    state.writable = usable && !opts->dry_run;
+    state.resumed = usable && opts->resume && load_existing();
+    state.last_flush = monotonic_ns();
+    if (state.resumed) {
+        log_info("Retomando: %zu entradas já concluídas, %zu cópias parciais", state.done.count,
+                 state.partial_count);
+    }
+    pthread_mutex_unlock(&checkpoint_lock);
+    return true;
+}
+
+/* Sem falhas o checkpoint some; com falhas fica para --resume. Uma execução nova sem nada gravado
+ * também descarta o checkpoint antigo, que não corresponde mais ao que está no disco. */
+void checkpoint_end(bool complete) {
+    pthread_mutex_lock(&checkpoint_lock);
+    if (!state.active) {
+        pthread_mutex_unlock(&checkpoint_lock);
+        return;
+    }
+    bool written = state.out != NULL;
+    if (state.out && fclose(state.out) != 0) {
+        log_warn("Não foi possível gravar checkpoint '%s': %s", state.path, strerror(errno));
+    }
+    state.out = NULL;
+    if (state.writable) {
+        if (complete || (!written && !state.resumed)) {
+            if (unlink(state.path) != 0 && errno != ENOENT) {
+                log_warn("Não foi possível remover checkpoint '%s': %s", state.path, strerror(errno));
+            }
+        } else {
+            log_warn("Execução incompleta; rode de novo com --resume para continuar de onde parou");
+        }
+    }
+    checkpoint_reset();
+    pthread_mutex_unlock(&checkpoint_lock);
+}
+
+bool checkpoint_active(void) {
+    pthread_mutex_lock(&checkpoint_lock);
+    bool active = state.active && state.writable;
+    pthread_mutex_unlock(&checkpoint_lock);
+    return active;
+}
+
+bool checkpoint_done(const char *target) {
+    pthread_mutex_lock(&checkpoint_lock);
+    size_t unused;
+    bool done = state.active && state.resumed && strmap_get(&state.done, target, &unused);
+    pthread_mutex_unlock(&checkpoint_lock);
+    return done;
+}
+
+void checkpoint_mark_done(const char *target) {
+    pthread_mutex_lock(&checkpoint_lock);
+    FILE *out = state.active ? checkpoint_output() : NULL;
+    if (out) {
+        fprintf(out, "done\t%s\n", target);
+        ++state.pending;
+        checkpoint_flush_locked(false);
+    }
+    pthread_mutex_unlock(&checkpoint_lock);
+}
+
+/* O offset só vale se a origem não mudou (mesmo tamanho e mtime) desde a execução interrompida. */
+bool checkpoint_partial(const char *dst, long long size, long long mtime_ns, long long *offset) {
+    pthread_mutex_lock(&checkpoint_lock);
+    size_t index;
+    bool found = state.active && state.resumed && strmap_get(&state.partial, dst, &index) &&
+                 state.partials[index].size == size && state.partials[index].mtime_ns == mtime_ns &&
+                 state.partials[index].offset > 0 && state.partials[index].offset <= size;
+    if (found) {
+        *offset = state.partials[index].offset;
+    }
+    pthread_mutex_unlock(&checkpoint_lock);
+    return found;
+}
+
+/* Chamado depois que os dados até offset chegaram ao disco; vai direto para o arquivo. */
+void checkpoint_save_partial(const char *dst, long long offset, long long size, long long mtime_ns) {
+    pthread_mutex_lock(&checkpoint_lock);
+    FILE *out = state.active ? checkpoint_output() : NULL;
+    if (out) {
+        fprintf(out, "partial\t%lld\t%lld\t%lld\t%s\n", offset, size, mtime_ns, dst);
+        checkpoint_flush_locked(true);
+    }
+    pthread_mutex_unlock(&checkpoint_lock);
+}
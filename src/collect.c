@@ -1,22 +1,123 @@
+#define _GNU_SOURCE
+
 #include "collect.h"
 
+#include "checkpoint.h"
+#include "ignore.h"
+#include "io_sched.h"
+#include "metrics.h"
+#include "profile.h"
+#include "strmap.h"
 #include "symlink_engine.h"
 #include "utils.h"
 
 #include <errno.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 
 #ifndef _WIN32
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
 #else
 #include <direct.h>
 #include <io.h>
 #endif
 
-static bool copy_entry_recursive(const AppOptions *opts, const char *src, const char *dst);
+#define COPY_CHUNK (64 * 1024)
+#define RESUME_MIN_SIZE (16LL * 1024 * 1024)
+#define RESUME_STRIDE (32LL * 1024 * 1024)
+
+static atomic_bool pending_sync;
+
+/* Primeiro destino copiado de cada inode com mais de um link, para recriar hardlinks. */
+typedef struct {
+    StrMap inodes;
+    char **paths;
+    size_t count;
+    size_t capacity;
+} LinkMap;
+
+/* Estado de uma cópia de árvore. As regras de ignore são compiladas ao abrir o diretório raiz:
+ * as do repositório casam com o caminho relativo ao repositório, as da entrada com o relativo à raiz. */
+typedef struct {
+    LinkMap links;
+    bool prepared;
+    IgnoreRules *repo_rules;
+    IgnoreRules *entry_rules;
+    size_t src_root_len;
+    char repo_prefix[PATH_MAX];
+} CopyTree;
+
+static bool copy_entry_recursive(const AppOptions *opts, const char *src, const char *dst, CopyTree *tree,
+                                 bool follow);
+
+static bool relative_to(const char *path, const char *root, const char **rest) {
+    size_t len = strlen(root);
+    if (len == 0 || strncmp(path, root, len) != 0 || (path[len] != '/' && path[len] != '\\' && path[len] != '\0')) {
+        return false;
+    }
+    *rest = path[len] ? path + len + 1 : path + len;
+    return true;
+}
+
+static IgnoreRules *load_rules(const char *dir, IgnoreRules *rules) {
+    char path[PATH_MAX];
+    if (!join_paths(dir, IGNORE_FILE, path, sizeof(path))) {
+        return rules;
+    }
+    if (!rules) {
+        rules = ignore_create();
+    }
+    if (rules) {
+        ignore_load(rules, path);
+    }
+    return rules;
+}
+
+static void prepare_ignore(const AppOptions *opts, CopyTree *tree, const char *src, const char *dst) {
+    tree->prepared = true;
+    tree->src_root_len = strlen(src);
+    tree->entry_rules = load_rules(dst, load_rules(src, NULL));
+    char repo[PATH_MAX];
+    const char *rest = NULL;
+    if ((normalize_path(opts->repo_path, repo, sizeof(repo)) && relative_to(dst, repo, &rest)) ||
+        relative_to(dst, opts->repo_path, &rest)) {
+        snprintf(tree->repo_prefix, sizeof(tree->repo_prefix), "%s", rest);
+        size_t len = strlen(tree->repo_prefix);
+        while (len > 0 && (tree->repo_prefix[len - 1] == '/' || tree->repo_prefix[len - 1] == '\\')) {
+            tree->repo_prefix[--len] = '\0';
+        }
+        tree->repo_rules = load_rules(opts->repo_path, NULL);
+    }
+    if (opts->verbose && ignore_count(tree->entry_rules) + ignore_count(tree->repo_rules) > 0) {
+        log_info("%zu regras de %s para %s", ignore_count(tree->entry_rules) + ignore_count(tree->repo_rules),
+                 IGNORE_FILE, src);
+    }
+}
+
+/* Testado antes de descer: um diretório ignorado nunca é aberto. */
+static bool ignored_child(const AppOptions *opts, const CopyTree *tree, const char *src_child, bool is_dir) {
+    const char *relative = src_child + tree->src_root_len + 1;
+    bool ignored = ignore_match(tree->entry_rules, relative, is_dir);
+    if (!ignored && tree->repo_rules) {
+        char key[PATH_MAX];
+        int len = tree->repo_prefix[0] ? snprintf(key, sizeof(key), "%s/%s", tree->repo_prefix, relative) :
+                                         snprintf(key, sizeof(key), "%s", relative);
+        ignored = len > 0 && (size_t)len < sizeof(key) && ignore_match(tree->repo_rules, key, is_dir);
+    }
+    if (ignored && opts->verbose) {
+        log_info("Ignorado por %s: %s", IGNORE_FILE, src_child);
+    }
+    return ignored;
+}
 
 static bool ensure_directory(const AppOptions *opts, const char *path) {
     if (path_exists(path)) {
@@ -26,6 +127,10 @@ static bool ensure_directory(const AppOptions *opts, const char *path) {
         log_info("[dry-run] mkdir %s", path);
         return true;
     }
+    if (!ensure_parent_dirs(path, false)) {
+        return false;
+    }
+    fs_op(PROFILE_FS_MKDIR);
 #ifndef _WIN32
     if (mkdir(path, 0755) == 0) {
         return true;
@@ -42,12 +147,14 @@ static bool ensure_directory(const AppOptions *opts, const char *path) {
     return false;
 }
 
+#ifdef _WIN32
 static bool copy_file_contents(const AppOptions *opts, const char *src, const char *dst) {
     if (opts->dry_run) {
         log_info("[dry-run] cp %s %s", src, dst);
         return true;
     }
 
+    fs_op(PROFILE_FS_OPEN);
     FILE *in = fopen(src, "rb");
     if (!in) {
         log_error("Não foi possível abrir '%s' para leitura: %s", src, strerror(errno));
@@ -59,6 +166,7 @@ static bool copy_file_contents(const AppOptions *opts, const char *src, const ch
         return false;
     }
 
+    fs_op(PROFILE_FS_OPEN);
     FILE *out = fopen(dst, "wb");
     if (!out) {
         log_error("Não foi possível abrir '%s' para escrita: %s", dst, strerror(errno));
@@ -70,11 +178,13 @@ static bool copy_file_contents(const AppOptions *opts, const char *src, const ch
     size_t read_bytes;
     bool ok = true;
     while ((read_bytes = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        io_sched_bytes(read_bytes);
         if (fwrite(buffer, 1, read_bytes, out) != read_bytes) {
             log_error("Erro ao escrever em '%s': %s", dst, strerror(errno));
             ok = false;
             break;
         }
+        metrics_add_copied_bytes(read_bytes);
     }
 
     if (ferror(in)) {
@@ -87,8 +197,10 @@ static bool copy_file_contents(const AppOptions *opts, const char *src, const ch
     return ok;
 }
 
-#ifdef _WIN32
-static bool copy_directory_win(const AppOptions *opts, const char *src, const char *dst) {
+static bool copy_directory_win(const AppOptions *opts, const char *src, const char *dst, CopyTree *tree) {
+    if (!tree->prepared) {
+        prepare_ignore(opts, tree, src, dst);
+    }
     if (!ensure_directory(opts, dst)) {
         return false;
     }
@@ -109,7 +221,10 @@ static bool copy_directory_win(const AppOptions *opts, const char *src, const ch
         char dst_child[PATH_MAX];
         snprintf(src_child, sizeof(src_child), "%s\\%s", src, data.name);
         snprintf(dst_child, sizeof(dst_child), "%s\\%s", dst, data.name);
-        if (!copy_entry_recursive(opts, src_child, dst_child)) {
+        if (ignored_child(opts, tree, src_child, (data.attrib & _A_SUBDIR) != 0)) {
+            continue;
+        }
+        if (!copy_entry_recursive(opts, src_child, dst_child, tree, false)) {
             ok = false;
             break;
         }
@@ -118,10 +233,435 @@ static bool copy_directory_win(const AppOptions *opts, const char *src, const ch
     return ok;
 }
 #else
-static bool copy_directory_posix(const AppOptions *opts, const char *src, const char *dst) {
+/* Copia [start, end) com pread/pwrite; end < 0 copia até o fim do arquivo. */
+static bool copy_range(int in, int out, off_t start, off_t end, char *buffer) {
+    off_t pos = start;
+    while (end < 0 || pos < end) {
+        size_t want = COPY_CHUNK;
+        if (end >= 0 && (off_t)want > end - pos) {
+            want = (size_t)(end - pos);
+        }
+        ssize_t got = pread(in, buffer, want, pos);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (got == 0) {
+            break;
+        }
+        io_sched_bytes((uint64_t)got);
+        for (ssize_t done = 0; done < got;) {
+            ssize_t written = pwrite(out, buffer + done, (size_t)(got - done), pos + done);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            done += written;
+        }
+        metrics_add_copied_bytes((uint64_t)got);
+        pos += got;
+    }
+    return true;
+}
+
+/* Copia só as regiões com dados; os buracos ficam para o ftruncate final. */
+static bool copy_sparse(int in, int out, const struct stat *st, char *buffer, bool *handled) {
+    *handled = false;
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    off_t pos = 0;
+    while (pos < st->st_size) {
+        off_t data = lseek(in, pos, SEEK_DATA);
+        if (data < 0) {
+            if (errno == ENXIO) {
+                break;
+            }
+            return pos == 0;
+        }
+        off_t hole = lseek(in, data, SEEK_HOLE);
+        if (hole < 0 || !copy_range(in, out, data, hole, buffer)) {
+            *handled = true;
+            return false;
+        }
+        pos = hole;
+    }
+    *handled = true;
+    return ftruncate(out, st->st_size) == 0;
+#else
+    (void)in;
+    (void)out;
+    (void)st;
+    (void)buffer;
+    return true;
+#endif
+}
+
+/* Reflink (btrfs, XFS, bcachefs...): o destino compartilha os extents da origem, sem copiar dados.
+ * Se o sistema de arquivos não suporta (EOPNOTSUPP/EINVAL), não tenta mais; EXDEV vale só para o par. */
+static bool clone_file(int in, int out) {
+#ifdef FICLONE
+    static atomic_bool unsupported;
+    if (atomic_load(&unsupported)) {
+        return false;
+    }
+    if (ioctl(out, FICLONE, in) == 0) {
+        return true;
+    }
+    if (errno == EOPNOTSUPP || errno == ENOTTY || errno == EINVAL) {
+        atomic_store(&unsupported, true);
+    }
+#else
+    (void)in;
+    (void)out;
+#endif
+    return false;
+}
+
+static bool copy_data(int in, int out, const struct stat *st) {
+    if (clone_file(in, out)) {
+        return true;
+    }
+    char *buffer = malloc(COPY_CHUNK);
+    if (!buffer) {
+        return false;
+    }
+    bool ok = true;
+    bool handled = false;
+    if ((off_t)st->st_blocks * 512 < st->st_size) {
+        ok = copy_sparse(in, out, st, buffer, &handled);
+    }
+    if (ok && !handled) {
+        ok = copy_range(in, out, 0, -1, buffer);
+    }
+    free(buffer);
+    return ok;
+}
+
+/* Remove o que ocupa o destino (symlink ou hardlink antigo) antes de recriá-lo. */
+static bool clear_destination(const char *dst) {
+    struct stat st;
+    fs_op(PROFILE_FS_LSTAT);
+    if (lstat(dst, &st) != 0) {
+        return true;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        log_error("Destino '%s' é um diretório no repositório", dst);
+        return false;
+    }
+    fs_op(PROFILE_FS_UNLINK);
+    if (unlink(dst) != 0) {
+        log_error("Não foi possível substituir '%s': %s", dst, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool parent_directory(const char *path, char *output, size_t len) {
+    const char *slash = strrchr(path, '/');
+    size_t dir_len = !slash ? 0 : slash == path ? 1 : (size_t)(slash - path);
+    if (dir_len == 0) {
+        return snprintf(output, len, ".") < (int)len;
+    }
+    if (dir_len >= len) {
+        return false;
+    }
+    memcpy(output, path, dir_len);
+    output[dir_len] = '\0';
+    return true;
+}
+
+/* Abre o arquivo de trabalho no diretório do destino; temp fica vazio para um O_TMPFILE anônimo. */
+static int open_temp_file(const char *dst, mode_t mode, char *temp, size_t len) {
+    temp[0] = '\0';
+#ifdef O_TMPFILE
+    static atomic_int proc_fd_available = -1;
+    if (proc_fd_available < 0) {
+        proc_fd_available = access("/proc/self/fd", X_OK) == 0;
+    }
+    char dir[PATH_MAX];
+    if (proc_fd_available && parent_directory(dst, dir, sizeof(dir))) {
+        fs_op(PROFILE_FS_OPEN);
+        int fd = open(dir, O_TMPFILE | O_WRONLY, mode);
+        if (fd >= 0) {
+            return fd;
+        }
+    }
+#else
+    (void)mode;
+#endif
+    if (snprintf(temp, len, "%s.dotmgr-XXXXXX", dst) >= (int)len) {
+        temp[0] = '\0';
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    fs_op(PROFILE_FS_OPEN);
+    return mkstemp(temp);
+}
+
+static atomic_uint temp_counter;
+
+/* Dá nome ao arquivo: link direto se o destino não existe, senão nome temporário + rename por cima. */
+static bool publish_temp_file(int fd, const char *temp, const char *dst) {
+    if (temp[0] != '\0') {
+        fs_op(PROFILE_FS_RENAME);
+        return rename(temp, dst) == 0;
+    }
+    char proc_path[64];
+    snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", fd);
+    if (linkat(AT_FDCWD, proc_path, AT_FDCWD, dst, AT_SYMLINK_FOLLOW) == 0) {
+        return true;
+    }
+    if (errno != EEXIST) {
+        return false;
+    }
+    char staged[PATH_MAX];
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        if (snprintf(staged, sizeof(staged), "%s.dotmgr-%ld-%u", dst, (long)getpid(),
+                     atomic_fetch_add(&temp_counter, 1)) >= (int)sizeof(staged)) {
+            errno = ENAMETOOLONG;
+            return false;
+        }
+        if (linkat(AT_FDCWD, proc_path, AT_FDCWD, staged, AT_SYMLINK_FOLLOW) != 0) {
+            if (errno == EEXIST) {
+                continue;
+            }
+            return false;
+        }
+        fs_op(PROFILE_FS_RENAME);
+        if (rename(staged, dst) == 0) {
+            return true;
+        }
+        int saved = errno;
+        unlink(staged);
+        errno = saved;
+        return false;
+    }
+    return false;
+}
+
+/* Arquivos grandes com checkpoint ativo: o arquivo de trabalho tem nome fixo (<destino>.dotmgr-partial) e o
+ * offset vai para o checkpoint a cada RESUME_STRIDE já em disco, para que --resume continue dali. */
+static bool copy_resumable(const AppOptions *opts, int in, const char *src, const char *dst, const struct stat *st) {
+    char partial[PATH_MAX];
+    if (snprintf(partial, sizeof(partial), "%s" COLLECT_PARTIAL_SUFFIX, dst) >= (int)sizeof(partial)) {
+        log_error("Caminho muito longo: %s", dst);
+        return false;
+    }
+    long long size = (long long)st->st_size;
+    long long mtime_ns = stat_mtime_ns(st);
+    long long offset = 0;
+    int out = -1;
+    if (checkpoint_partial(dst, size, mtime_ns, &offset)) {
+        fs_op(PROFILE_FS_OPEN);
+        out = open(partial, O_WRONLY);
+        struct stat current;
+        if (out >= 0 && (fstat(out, &current) != 0 || current.st_size < offset || ftruncate(out, offset) != 0)) {
+            close(out);
+            out = -1;
+        }
+        if (out >= 0) {
+            log_info("Retomando cópia de '%s' em %lld de %lld MiB", src, offset >> 20, size >> 20);
+        }
+    }
+    if (out < 0) {
+        offset = 0;
+        fs_op(PROFILE_FS_OPEN);
+        out = open(partial, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (out < 0) {
+            log_error("Não foi possível criar '%s': %s", partial, strerror(errno));
+            return false;
+        }
+    }
+
+    bool ok = true;
+    if (offset > 0 || !clone_file(in, out)) {
+        char *buffer = malloc(COPY_CHUNK);
+        ok = buffer != NULL;
+        while (ok && offset < size) {
+            long long end = size - offset > RESUME_STRIDE ? offset + RESUME_STRIDE : size;
+            ok = copy_range(in, out, (off_t)offset, (off_t)end, buffer) && fsync(out) == 0;
+            if (ok) {
+                offset = end;
+                checkpoint_save_partial(dst, offset, size, mtime_ns);
+            }
+        }
+        ok = ok && copy_range(in, out, (off_t)offset, -1, buffer);
+        free(buffer);
+    }
+    if (!ok) {
+        log_error("Erro ao copiar '%s' para '%s': %s", src, dst, strerror(errno));
+    }
+    if (ok && fchmod(out, st->st_mode & 07777) != 0 && opts->verbose) {
+        log_warn("Não foi possível preservar permissões de '%s': %s", dst, strerror(errno));
+    }
+    close(out);
+    if (!ok) {
+        return false;
+    }
+    fs_op(PROFILE_FS_RENAME);
+    if (rename(partial, dst) != 0) {
+        log_error("Não foi possível gravar '%s': %s", dst, strerror(errno));
+        return false;
+    }
+    atomic_store(&pending_sync, true);
+    return true;
+}
+
+/* Escreve num arquivo temporário e só então o coloca no lugar: uma interrupção nunca deixa o destino truncado.
+ * A durabilidade fica para um syncfs antes de substituir o original (collect_sync_entry) ou, quando
+ * nada é substituído, para um único collect_sync no fim da execução. */
+static bool copy_file_contents(const AppOptions *opts, const char *src, const char *dst, const struct stat *st) {
+    if (opts->dry_run) {
+        log_info("[dry-run] cp %s %s", src, dst);
+        return true;
+    }
+
+    fs_op(PROFILE_FS_OPEN);
+    int in = open(src, O_RDONLY);
+    if (in < 0) {
+        log_error("Não foi possível abrir '%s' para leitura: %s", src, strerror(errno));
+        return false;
+    }
+
+    if (!ensure_parent_dirs(dst, false)) {
+        close(in);
+        return false;
+    }
+
+    if (st->st_size >= RESUME_MIN_SIZE && (off_t)st->st_blocks * 512 >= st->st_size && checkpoint_active()) {
+        bool ok = copy_resumable(opts, in, src, dst, st);
+        close(in);
+        return ok;
+    }
+
+    char temp[PATH_MAX];
+    int out = open_temp_file(dst, st->st_mode & 0777, temp, sizeof(temp));
+    if (out < 0) {
+        log_error("Não foi possível criar arquivo temporário para '%s': %s", dst, strerror(errno));
+        close(in);
+        return false;
+    }
+
+    bool ok = copy_data(in, out, st);
+    if (!ok) {
+        log_error("Erro ao copiar '%s' para '%s': %s", src, dst, strerror(errno));
+    }
+    if (ok && fchmod(out, st->st_mode & 07777) != 0 && opts->verbose) {
+        log_warn("Não foi possível preservar permissões de '%s': %s", dst, strerror(errno));
+    }
+    if (ok && !publish_temp_file(out, temp, dst)) {
+        log_error("Não foi possível gravar '%s': %s", dst, strerror(errno));
+        ok = false;
+    }
+    if (!ok && temp[0] != '\0') {
+        unlink(temp);
+    }
+    if (ok) {
+        atomic_store(&pending_sync, true);
+    }
+    close(out);
+    close(in);
+    return ok;
+}
+
+static bool copy_symlink(const AppOptions *opts, const char *src, const char *dst) {
+    char link_target[PATH_MAX];
+    fs_op(PROFILE_FS_READLINK);
+    if (!read_symlink_target(src, link_target, sizeof(link_target))) {
+        log_error("Não foi possível ler symlink '%s': %s", src, strerror(errno));
+        return false;
+    }
+    if (is_same_symlink_target(dst, link_target)) {
+        return true;
+    }
+    if (opts->dry_run) {
+        log_info("[dry-run] ln -s %s %s", link_target, dst);
+        return true;
+    }
+    if (!ensure_parent_dirs(dst, false) || !clear_destination(dst)) {
+        return false;
+    }
+    fs_op(PROFILE_FS_SYMLINK);
+    if (symlink(link_target, dst) != 0) {
+        log_error("Falha ao criar symlink %s -> %s: %s", dst, link_target, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool link_known_inode(const AppOptions *opts, const LinkMap *links, const char *key, const char *dst) {
+    size_t index;
+    if (!strmap_get(&links->inodes, key, &index)) {
+        return false;
+    }
+    const char *first = links->paths[index];
+    if (opts->dry_run) {
+        log_info("[dry-run] ln %s %s", first, dst);
+        return true;
+    }
+    if (!ensure_parent_dirs(dst, false) || !clear_destination(dst)) {
+        return false;
+    }
+    if (link(first, dst) != 0) {
+        if (opts->verbose) {
+            log_warn("Não foi possível recriar hardlink %s -> %s: %s", dst, first, strerror(errno));
+        }
+        return false;
+    }
+    return true;
+}
+
+static void remember_inode(LinkMap *links, const char *key, const char *dst) {
+    if (links->count == links->capacity) {
+        size_t next = links->capacity ? links->capacity * 2 : 16;
+        char **grown = realloc(links->paths, next * sizeof(char *));
+        if (!grown) {
+            return;
+        }
+        links->paths = grown;
+        links->capacity = next;
+    }
+    size_t len = strlen(dst) + 1;
+    char *copy = malloc(len);
+    if (!copy) {
+        return;
+    }
+    memcpy(copy, dst, len);
+    if (!strmap_put(&links->inodes, key, links->count)) {
+        free(copy);
+        return;
+    }
+    links->paths[links->count++] = copy;
+}
+
+static bool copy_regular(const AppOptions *opts, const char *src, const char *dst, const struct stat *st,
+                         LinkMap *links) {
+    if (st->st_nlink < 2) {
+        return copy_file_contents(opts, src, dst, st);
+    }
+    char key[64];
+    snprintf(key, sizeof(key), "%llu:%llu", (unsigned long long)st->st_dev, (unsigned long long)st->st_ino);
+    if (link_known_inode(opts, links, key, dst)) {
+        return true;
+    }
+    if (!copy_file_contents(opts, src, dst, st)) {
+        return false;
+    }
+    remember_inode(links, key, dst);
+    return true;
+}
+
+static bool copy_directory_posix(const AppOptions *opts, const char *src, const char *dst, CopyTree *tree) {
+    if (!tree->prepared) {
+        prepare_ignore(opts, tree, src, dst);
+    }
     if (!ensure_directory(opts, dst)) {
         return false;
     }
+    fs_op(PROFILE_FS_OPENDIR);
     DIR *dir = opendir(src);
     if (!dir) {
         log_error("Não foi possível abrir diretório '%s': %s", src, strerror(errno));
@@ -136,7 +676,16 @@ static bool copy_directory_posix(const AppOptions *opts, const char *src, const
         char dst_child[PATH_MAX];
         snprintf(src_child, sizeof(src_child), "%s/%s", src, entry->d_name);
         snprintf(dst_child, sizeof(dst_child), "%s/%s", dst, entry->d_name);
-        if (!copy_entry_recursive(opts, src_child, dst_child)) {
+        bool is_dir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat st;
+            fs_op(PROFILE_FS_LSTAT);
+            is_dir = lstat(src_child, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        if (ignored_child(opts, tree, src_child, is_dir)) {
+            continue;
+        }
+        if (!copy_entry_recursive(opts, src_child, dst_child, tree, false)) {
             closedir(dir);
             return false;
         }
@@ -146,43 +695,147 @@ static bool copy_directory_posix(const AppOptions *opts, const char *src, const
 }
 #endif
 
-static bool copy_entry_recursive(const AppOptions *opts, const char *src, const char *dst) {
+/* --max-size vale só dentro de diretórios: um arquivo pedido explicitamente é sempre copiado. */
+static bool too_large(const AppOptions *opts, const char *src, long long size, bool top) {
+    if (top || opts->collect_max_size <= 0 || size <= opts->collect_max_size) {
+        return false;
+    }
+    log_warn("Ignorando '%s': %lld bytes, acima de --max-size", src, size);
+    return true;
+}
+
+/* O topo segue symlinks (o alvo pode ser um link antigo); dentro da árvore eles são preservados. */
+static bool copy_entry_recursive(const AppOptions *opts, const char *src, const char *dst, CopyTree *tree,
+                                 bool follow) {
+    fs_op(follow ? PROFILE_FS_STAT : PROFILE_FS_LSTAT);
 #ifdef _WIN32
     struct _stat64i32 st;
     if (_stat(src, &st) != 0) {
         log_error("Não foi possível acessar '%s': %s", src, strerror(errno));
         return false;
     }
-    bool is_dir = (st.st_mode & _S_IFDIR) != 0;
+    if ((st.st_mode & _S_IFDIR) != 0) {
+        return copy_directory_win(opts, src, dst, tree);
+    }
+    if (too_large(opts, src, (long long)st.st_size, follow)) {
+        return true;
+    }
+    return copy_file_contents(opts, src, dst);
 #else
     struct stat st;
-    if (stat(src, &st) != 0) {
+    if ((follow ? stat(src, &st) : lstat(src, &st)) != 0) {
         log_error("Não foi possível acessar '%s': %s", src, strerror(errno));
         return false;
     }
-    bool is_dir = S_ISDIR(st.st_mode);
+    if (S_ISLNK(st.st_mode)) {
+        return copy_symlink(opts, src, dst);
+    }
+    if (S_ISDIR(st.st_mode)) {
+        return copy_directory_posix(opts, src, dst, tree);
+    }
+    if (!S_ISREG(st.st_mode)) {
+        log_warn("Ignorando '%s': tipo de arquivo não suportado", src);
+        return true;
+    }
+    if (too_large(opts, src, (long long)st.st_size, follow)) {
+        return true;
+    }
+    return copy_regular(opts, src, dst, &st, &tree->links);
 #endif
+}
+
+bool collect_copy_tree(const AppOptions *opts, const char *src, const char *dst) {
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_COPY);
+    CopyTree tree;
+    memset(&tree, 0, sizeof(tree));
+    LinkMap *links = &tree.links;
+    bool ok = strmap_init(&links->inodes, 16);
+    if (!ok) {
+        log_error("Memória insuficiente para copiar '%s'", src);
+    } else {
+        ok = copy_entry_recursive(opts, src, dst, &tree, true);
+        strmap_free(&links->inodes);
+    }
+    for (size_t i = 0; i < links->count; ++i) {
+        free(links->paths[i]);
+    }
+    free(links->paths);
+    ignore_free(tree.entry_rules);
+    ignore_free(tree.repo_rules);
+    profile_end_detail(&span, src);
+    return ok;
+}
 
-    if (is_dir) {
+static bool sync_repository(const AppOptions *opts) {
 #ifdef _WIN32
-        return copy_directory_win(opts, src, dst);
+    (void)opts;
+    return true;
 #else
-        return copy_directory_posix(opts, src, dst);
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_SYNC);
+    bool ok = true;
+    fs_op(PROFILE_FS_OPEN);
+    int fd = open(opts->repo_path, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        sync();
+    } else {
+#ifdef __linux__
+        if (syncfs(fd) != 0) {
+            log_error("Falha ao sincronizar '%s': %s", opts->repo_path, strerror(errno));
+            ok = false;
+        }
+#else
+        sync();
 #endif
+        close(fd);
     }
+    profile_end_detail(&span, opts->repo_path);
+    return ok;
+#endif
+}
 
-    return copy_file_contents(opts, src, dst);
+bool collect_sync(const AppOptions *opts) {
+    if (opts->dry_run || !atomic_exchange(&pending_sync, false)) {
+        return true;
+    }
+    return sync_repository(opts);
 }
 
-bool collect_entry(const AppOptions *opts, const DotfileEntry *entry) {
+/* Incondicional: com workers em paralelo, a flag pode ter sido zerada por um syncfs que começou antes
+ * da última cópia desta entrada. Zerá-la antes cobre o que já foi renomeado, e o syncfs do fim só roda
+ * se houver cópias depois. */
+bool collect_sync_entry(const AppOptions *opts) {
+    if (opts->dry_run) {
+        return true;
+    }
+    atomic_store(&pending_sync, false);
+    return sync_repository(opts);
+}
+
+static bool collect_target(const AppOptions *opts, const DotfileEntry *entry) {
     if (!path_exists(entry->target_path)) {
         log_warn("Destino ausente ao coletar: %s", entry->target_path);
         return true;
     }
+    if (is_same_symlink_target(entry->target_path, entry->source_path)) {
+        if (opts->verbose) {
+            log_info("Já gerenciado pelo repositório: %s", entry->target_path);
+        }
+        return true;
+    }
 
-    if (!copy_entry_recursive(opts, entry->target_path, entry->source_path)) {
+    if (!collect_copy_tree(opts, entry->target_path, entry->source_path) || !collect_sync_entry(opts)) {
         return false;
     }
 
     return install_entry(opts, entry);
 }
+
+bool collect_entry(const AppOptions *opts, const DotfileEntry *entry) {
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_COLLECT);
+    bool ok = collect_target(opts, entry);
+    profile_end(&span);
+    return ok;
+}
@@ -0,0 +1,372 @@
+#include "config_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "path_expand.h"
+#include "strmap.h"
+#include "utils.h"
+
+#define FILTER_MAX_TERMS 32
+
+typedef struct {
+    size_t *items;
+    size_t count;
+    size_t capacity;
+} IndexList;
+
+typedef struct {
+    const char *target;
+    size_t entry;
+} TargetRef;
+
+struct ConfigIndex {
+    StrMap tags;
+    IndexList *lists;
+    size_t list_count;
+    size_t list_capacity;
+    TargetRef *by_target;
+    size_t target_count;
+};
+
+typedef struct {
+    const IndexList *list;
+    char prefix[PATH_MAX];
+    bool is_tag;
+} FilterTerm;
+
+static bool list_push(IndexList *list, size_t value) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 8;
+        size_t *items = realloc(list->items, capacity * sizeof(size_t));
+        if (!items) {
+            return false;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = value;
+    return true;
+}
+
+ConfigIndex *config_index_create(void) {
+    ConfigIndex *index = calloc(1, sizeof(ConfigIndex));
+    if (!index) {
+        return NULL;
+    }
+    if (!strmap_init(&index->tags, 16)) {
+        free(index);
+        return NULL;
+    }
+    return index;
+}
+
+bool config_index_tag(ConfigIndex *index, const char *tag, size_t entry) {
+    size_t slot;
+    if (!strmap_get(&index->tags, tag, &slot)) {
+        if (index->list_count == index->list_capacity) {
+            size_t capacity = index->list_capacity ? index->list_capacity * 2 : 8;
+            IndexList *lists = realloc(index->lists, capacity * sizeof(IndexList));
+            if (!lists) {
+                return false;
+            }
+            index->lists = lists;
+            index->list_capacity = capacity;
+        }
+        slot = index->list_count;
+        memset(&index->lists[slot], 0, sizeof(IndexList));
+        if (!strmap_put(&index->tags, tag, slot)) {
+            return false;
+        }
+        ++index->list_count;
+    }
+    IndexList *list = &index->lists[slot];
+    if (list->count > 0 && list->items[list->count - 1] == entry) {
+        return true;
+    }
+    return list_push(list, entry);
+}
+
+static int compare_targets(const void *a, const void *b) {
+    const TargetRef *left = a;
+    const TargetRef *right = b;
+    int cmp = strcmp(left->target, right->target);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return left->entry < right->entry ? -1 : left->entry > right->entry;
+}
+
+bool config_index_finish(ConfigIndex *index, const DotfileConfig *config) {
+    free(index->by_target);
+    index->by_target = malloc((config->count ? config->count : 1) * sizeof(TargetRef));
+    if (!index->by_target) {
+        index->target_count = 0;
+        return false;
+    }
+    for (size_t i = 0; i < config->count; ++i) {
+        index->by_target[i].target = config->entries[i].target_path;
+        index->by_target[i].entry = i;
+    }
+    index->target_count = config->count;
+    qsort(index->by_target, index->target_count, sizeof(TargetRef), compare_targets);
+    return true;
+}
+
+void config_index_free(ConfigIndex *index) {
+    if (!index) {
+        return;
+    }
+    for (size_t i = 0; i < index->list_count; ++i) {
+        free(index->lists[i].items);
+    }
+    free(index->lists);
+    strmap_free(&index->tags);
+    free(index->by_target);
+    free(index);
+}
+
+bool config_has_filter(const AppOptions *opts) {
+    return opts->only_filter[0] || opts->except_filter[0];
+}
+
+static bool next_term(const char **cursor, char *term, size_t len) {
+    const char *start = *cursor;
+    while (*start == ',' || *start == ' ') {
+        ++start;
+    }
+    if (*start == '\0') {
+        return false;
+    }
+    const char *end = strchr(start, ',');
+    size_t span = end ? (size_t)(end - start) : strlen(start);
+    *cursor = start + span;
+    while (span > 0 && start[span - 1] == ' ') {
+        --span;
+    }
+    snprintf(term, len, "%.*s", (int)span, start);
+    return true;
+}
+
+static bool is_path_term(const char *term) {
+    return term[0] == '~' || strchr(term, '/') != NULL || strchr(term, '\\') != NULL;
+}
+
+/* Prefixos passam pela mesma normalização dos destinos do config (relativos ficam sob o HOME). */
+static bool resolve_prefix(const DotfileConfig *config, const char *term, char *output, size_t len) {
+    char expanded[PATH_MAX];
+    if (!expand_home(term, expanded, sizeof(expanded))) {
+        return false;
+    }
+    char joined[PATH_MAX];
+    if (is_absolute_path(expanded)) {
+        snprintf(joined, sizeof(joined), "%s", expanded);
+    } else {
+        const char *home = config->vars ? path_vars_lookup(config->vars, "home", false) : NULL;
+        if (!home || !join_paths(home, expanded, joined, sizeof(joined))) {
+            return false;
+        }
+    }
+    if (!normalize_link_path(joined, output, len)) {
+        return snprintf(output, len, "%s", joined) < (int)len;
+    }
+    return true;
+}
+
+static bool parse_terms(const DotfileConfig *config, const char *filter, FilterTerm *terms, size_t *count) {
+    const ConfigIndex *index = config->index;
+    const char *cursor = filter;
+    char term[PATH_MAX];
+    *count = 0;
+    while (next_term(&cursor, term, sizeof(term))) {
+        if (*count == FILTER_MAX_TERMS) {
+            log_error("Filtro com mais de %d termos", FILTER_MAX_TERMS);
+            return false;
+        }
+        FilterTerm *out = &terms[*count];
+        memset(out, 0, sizeof(*out));
+        if (is_path_term(term)) {
+            if (!resolve_prefix(config, term, out->prefix, sizeof(out->prefix))) {
+                log_error("Prefixo de destino inválido: %s", term);
+                return false;
+            }
+        } else {
+            size_t slot;
+            out->is_tag = true;
+            if (index && strmap_get(&index->tags, term, &slot)) {
+                out->list = &index->lists[slot];
+            } else {
+                log_warn("Tag desconhecida no filtro: %s", term);
+            }
+        }
+        ++*count;
+    }
+    return true;
+}
+
+static bool prefix_matches(const char *target, const char *prefix) {
+    size_t len = strlen(prefix);
+    if (strncmp(target, prefix, len) != 0) {
+        return false;
+    }
+    return target[len] == '\0' || target[len] == '/' || target[len] == '\\' ||
+           (len > 0 && (prefix[len - 1] == '/' || prefix[len - 1] == '\\'));
+}
+
+static size_t lower_bound(const ConfigIndex *index, const char *prefix) {
+    size_t low = 0;
+    size_t high = index->target_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (strcmp(index->by_target[mid].target, prefix) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static bool list_contains(const IndexList *list, size_t entry) {
+    size_t low = 0;
+    size_t high = list->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (list->items[mid] == entry) {
+            return true;
+        }
+        if (list->items[mid] < entry) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return false;
+}
+
+static bool collect_matches(const ConfigIndex *index, const FilterTerm *term, IndexList *out) {
+    if (term->is_tag) {
+        for (size_t i = 0; term->list && i < term->list->count; ++i) {
+            if (!list_push(out, term->list->items[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    for (size_t i = lower_bound(index, term->prefix); i < index->target_count; ++i) {
+        const TargetRef *ref = &index->by_target[i];
+        if (strncmp(ref->target, term->prefix, strlen(term->prefix)) != 0) {
+            break;
+        }
+        if (prefix_matches(ref->target, term->prefix) && !list_push(out, ref->entry)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int compare_size(const void *a, const void *b) {
+    size_t left = *(const size_t *)a;
+    size_t right = *(const size_t *)b;
+    return left < right ? -1 : left > right;
+}
+
+static bool excluded(const DotfileConfig *config, size_t entry, const FilterTerm *terms, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (terms[i].is_tag) {
+            if (terms[i].list && list_contains(terms[i].list, entry)) {
+                return true;
+            }
+        } else if (prefix_matches(config->entries[entry].target_path, terms[i].prefix)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool select_candidates(const DotfileConfig *config, const FilterTerm *only, size_t only_count,
+                              IndexList *candidates) {
+    if (only_count == 0) {
+        for (size_t i = 0; i < config->count; ++i) {
+            if (!list_push(candidates, i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    for (size_t i = 0; i < only_count; ++i) {
+        if (!collect_matches(config->index, &only[i], candidates)) {
+            return false;
+        }
+    }
+    qsort(candidates->items, candidates->count, sizeof(size_t), compare_size);
+    size_t unique = 0;
+    for (size_t i = 0; i < candidates->count; ++i) {
+        if (unique == 0 || candidates->items[unique - 1] != candidates->items[i]) {
+            candidates->items[unique++] = candidates->items[i];
+        }
+    }
+    candidates->count = unique;
+    return true;
+}
+
+/* Monta uma config-visão com as entradas selecionadas na ordem original; as variáveis são compartilhadas.
+ * Se origin não for NULL, recebe (para liberar com free) o índice original de cada entrada da visão. */
+bool config_select(const AppOptions *opts, const DotfileConfig *config, DotfileConfig *view, size_t **origin) {
+    memset(view, 0, sizeof(*view));
+    if (origin) {
+        *origin = NULL;
+    }
+    if (!config->index) {
+        log_error("Config sem índice de filtros");
+        return false;
+    }
+    FilterTerm *terms = malloc(2 * FILTER_MAX_TERMS * sizeof(FilterTerm));
+    if (!terms) {
+        return false;
+    }
+    FilterTerm *only = terms;
+    FilterTerm *except = terms + FILTER_MAX_TERMS;
+    size_t only_count = 0;
+    size_t except_count = 0;
+    IndexList candidates;
+    memset(&candidates, 0, sizeof(candidates));
+    bool ok = parse_terms(config, opts->only_filter, only, &only_count) &&
+              parse_terms(config, opts->except_filter, except, &except_count) &&
+              select_candidates(config, only, only_count, &candidates);
+    if (ok) {
+        view->entries = malloc((candidates.count ? candidates.count : 1) * sizeof(DotfileEntry));
+        ok = view->entries != NULL;
+    }
+    for (size_t i = 0; ok && i < candidates.count; ++i) {
+        size_t entry = candidates.items[i];
+        if (!excluded(config, entry, except, except_count)) {
+            candidates.items[view->count] = entry;
+            view->entries[view->count++] = config->entries[entry];
+        }
+    }
+    if (ok && origin) {
+        *origin = candidates.items;
+        candidates.items = NULL;
+    }
+    free(candidates.items);
+    free(terms);
+    if (!ok) {
+        config_view_free(view);
+        return false;
+    }
+    view->vars = config->vars;
+    view->vars_fingerprint = config->vars_fingerprint;
+    if (opts->verbose) {
+        log_info("Filtro selecionou %zu de %zu entradas", view->count, config->count);
+    }
+    return true;
+}
+
+void config_view_free(DotfileConfig *view) {
+    free(view->entries);
+    view->entries = NULL;
+    view->count = 0;
+    view->vars = NULL;
+}
@@ -6,8 +6,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "config_index.h"
+#include "io_sched.h"
+#include "profile.h"
 #include "utils.h"
 
+#define ENTRY_MAX_TAGS 8
+
 static char *trim_whitespace(char *str) {
     if (!str) {
         return str;
@@ -25,26 +30,33 @@ static char *trim_whitespace(char *str) {
     return str;
 }
 
-static bool expand_target(const char *raw, char *output, size_t len) {
-    if (!raw || !output) {
+static bool expand_path(const char *raw, PathVars *vars, char *output, size_t len) {
+    PathTemplate tpl;
+    if (!path_template_compile(raw, &tpl)) {
+        log_error("Expressão inválida em caminho: '%s'", raw);
         return false;
     }
-    if (raw[0] == '~') {
-        return expand_home(raw, output, len);
+    bool ok = path_template_render(&tpl, vars, output, len);
+    path_template_free(&tpl);
+    return ok;
+}
+
+static bool expand_target(const char *raw, PathVars *vars, char *output, size_t len) {
+    if (!raw || !output) {
+        return false;
     }
-    if (is_absolute_path(raw)) {
-        return snprintf(output, len, "%s", raw) < (int)len;
+    char expanded[PATH_MAX];
+    if (!expand_path(raw, vars, expanded, sizeof(expanded))) {
+        return false;
     }
-    const char *home = getenv("HOME");
-#ifdef _WIN32
-    if (!home) {
-        home = getenv("USERPROFILE");
+    if (is_absolute_path(expanded)) {
+        return snprintf(output, len, "%s", expanded) < (int)len;
     }
-#endif
+    const char *home = path_vars_lookup(vars, "home", false);
     if (!home) {
         return false;
     }
-    return join_paths(home, raw, output, len);
+    return join_paths(home, expanded, output, len);
 }
 
 static bool detect_directory(const char *path) {
@@ -58,26 +70,160 @@ static bool detect_directory(const char *path) {
     return path[len - 1] == '/' || path[len - 1] == '\\';
 }
 
-bool load_config(const AppOptions *opts, DotfileConfig *config) {
-    if (!opts || !config) {
+static bool is_variable_name(const char *name) {
+    if (!*name || !(isalpha((unsigned char)*name) || *name == '_')) {
         return false;
     }
-    memset(config, 0, sizeof(*config));
+    for (const char *c = name; *c; ++c) {
+        if (!isalnum((unsigned char)*c) && *c != '_' && *c != '.' && *c != '-') {
+            return false;
+        }
+    }
+    return true;
+}
 
-    FILE *fp = fopen(opts->config_path, "r");
-    if (!fp) {
-        log_error("Não foi possível abrir config '%s': %s", opts->config_path, strerror(errno));
+static void parse_variable(char *line, PathVars *vars, size_t line_number) {
+    char *equals = strchr(line, '=');
+    *equals = '\0';
+    char *name = trim_whitespace(line);
+    char *raw_value = trim_whitespace(equals + 1);
+    if (!is_variable_name(name)) {
+        log_warn("Config linha %zu: nome de variável inválido '%s'", line_number, name);
+        return;
+    }
+    char value[PATH_MAX];
+    if (!expand_path(raw_value, vars, value, sizeof(value))) {
+        log_error("Não foi possível resolver variável na linha %zu", line_number);
+        return;
+    }
+    if (!path_vars_define(vars, name, value)) {
+        log_error("Memória insuficiente ao definir variável na linha %zu", line_number);
+    }
+}
+
+static bool parse_attributes(char *attrs, DotfileEntry *entry, const char **tags, size_t *tag_count,
+                             size_t line_number) {
+    char *token = strtok(attrs, " \t,");
+    while (token) {
+        if (token[0] == '@') {
+            if (!is_variable_name(token + 1)) {
+                log_warn("Config linha %zu: tag inválida '%s'", line_number, token);
+                return false;
+            }
+            if (*tag_count == ENTRY_MAX_TAGS) {
+                log_warn("Config linha %zu: mais de %d tags", line_number, ENTRY_MAX_TAGS);
+                return false;
+            }
+            tags[(*tag_count)++] = token + 1;
+        } else if (strcmp(token, "link") == 0) {
+            entry->mode = DEPLOY_LINK;
+        } else if (strcmp(token, "render") == 0) {
+            entry->mode = DEPLOY_RENDER;
+        } else if (strcmp(token, "copy") == 0) {
+            entry->mode = DEPLOY_COPY;
+        } else if (strcmp(token, "hardlink") == 0) {
+            entry->mode = DEPLOY_HARDLINK;
+        } else {
+            log_warn("Config linha %zu: atributo desconhecido '%s'", line_number, token);
+            return false;
+        }
+        token = strtok(NULL, " \t,");
+    }
+    return true;
+}
+
+static bool parse_entry(const AppOptions *opts, PathVars *vars, char *trimmed, size_t line_number, DotfileEntry *entry,
+                        const char **tags, size_t *tag_count) {
+    char *arrow = strstr(trimmed, "->");
+    *arrow = '\0';
+    char *source_raw = trim_whitespace(trimmed);
+    char *target_raw = arrow + 2;
+    char *attrs = strchr(target_raw, '|');
+    if (attrs) {
+        *attrs++ = '\0';
+    }
+    target_raw = trim_whitespace(target_raw);
+    if (*source_raw == '\0' || *target_raw == '\0') {
+        log_warn("Config linha %zu incompleta", line_number);
         return false;
     }
 
-    size_t capacity = 8;
-    config->entries = calloc(capacity, sizeof(DotfileEntry));
-    if (!config->entries) {
-        fclose(fp);
+    memset(entry, 0, sizeof(*entry));
+    entry->mode = DEPLOY_LINK;
+    if (attrs && !parse_attributes(attrs, entry, tags, tag_count, line_number)) {
+        return false;
+    }
+
+    char source_buffer[PATH_MAX];
+    if (!expand_path(source_raw, vars, source_buffer, sizeof(source_buffer))) {
+        log_error("Não foi possível resolver origem na linha %zu", line_number);
+        return false;
+    }
+    char joined[PATH_MAX];
+    if (!join_paths(opts->repo_path, source_buffer, joined, sizeof(joined))) {
+        log_error("Caminho de origem muito longo em linha %zu", line_number);
+        return false;
+    }
+    if (!normalize_path(joined, entry->source_path, sizeof(entry->source_path))) {
+        strncpy(entry->source_path, joined, sizeof(entry->source_path) - 1);
+    }
+
+    char target_buffer[PATH_MAX];
+    if (!expand_target(target_raw, vars, target_buffer, sizeof(target_buffer))) {
+        log_error("Não foi possível resolver destino na linha %zu", line_number);
+        return false;
+    }
+    if (!normalize_link_path(target_buffer, entry->target_path, sizeof(entry->target_path))) {
+        strncpy(entry->target_path, target_buffer, sizeof(entry->target_path) - 1);
+    }
+
+    entry->is_directory = detect_directory(source_raw) || detect_directory(target_raw);
+    if (entry->mode != DEPLOY_LINK && entry->is_directory) {
+        log_warn("Config linha %zu: '%s' só é suportado para arquivos", line_number,
+                 entry->mode == DEPLOY_RENDER ? "render" : entry->mode == DEPLOY_COPY ? "copy" : "hardlink");
         return false;
     }
+    return true;
+}
 
+/* "[grupo]" sozinho na linha marca as entradas seguintes com a tag do grupo até o próximo cabeçalho
+ * ("[]" encerra); "[grupo] origem -> destino" marca só aquela entrada. Devolve o resto da linha. */
+static char *parse_group(char *trimmed, char *group, size_t len, size_t line_number) {
+    char *close = strchr(trimmed, ']');
+    if (!close) {
+        log_warn("Config linha %zu: cabeçalho de grupo sem ']'", line_number);
+        return NULL;
+    }
+    *close = '\0';
+    char *name = trim_whitespace(trimmed + 1);
+    if (*name && !is_variable_name(name)) {
+        log_warn("Config linha %zu: nome de grupo inválido '%s'", line_number, name);
+        return NULL;
+    }
+    snprintf(group, len, "%s", name);
+    return trim_whitespace(close + 1);
+}
+
+static bool index_entry(DotfileConfig *config, size_t entry, const char *group, const char **tags, size_t tag_count) {
+    if (group[0] && !config_index_tag(config->index, group, entry)) {
+        return false;
+    }
+    for (size_t i = 0; i < tag_count; ++i) {
+        if (!config_index_tag(config->index, tags[i], entry)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Recebe cada entrada válida com o grupo e as tags; false interrompe a leitura. */
+typedef bool (*EntryVisitor)(const DotfileEntry *entry, size_t line_number, const char *group, const char **tags,
+                             size_t tag_count, void *user);
+
+static bool parse_lines(const AppOptions *opts, PathVars *vars, FILE *fp, EntryVisitor visit, void *user) {
     char line[1024];
+    char group[128] = "";
+    char inline_group[128];
     size_t line_number = 0;
     while (fgets(line, sizeof(line), fp)) {
         ++line_number;
@@ -89,64 +235,159 @@ bool load_config(const AppOptions *opts, DotfileConfig *config) {
         if (*trimmed == '\0') {
             continue;
         }
-        char *arrow = strstr(trimmed, "->");
-        if (!arrow) {
-            log_warn("Config linha %zu inválida: '%s'", line_number, trimmed);
-            continue;
+        bool inline_tagged = false;
+        if (*trimmed == '[') {
+            trimmed = parse_group(trimmed, inline_group, sizeof(inline_group), line_number);
+            if (!trimmed) {
+                continue;
+            }
+            if (*trimmed == '\0') {
+                snprintf(group, sizeof(group), "%s", inline_group);
+                continue;
+            }
+            inline_tagged = inline_group[0] != '\0';
         }
-        *arrow = '\0';
-        char *source_raw = trim_whitespace(trimmed);
-        char *target_raw = trim_whitespace(arrow + 2);
-        if (*source_raw == '\0' || *target_raw == '\0') {
-            log_warn("Config linha %zu incompleta", line_number);
+        if (!strstr(trimmed, "->")) {
+            if (strchr(trimmed, '=')) {
+                parse_variable(trimmed, vars, line_number);
+                continue;
+            }
+            log_warn("Config linha %zu inválida: '%s'", line_number, trimmed);
             continue;
         }
 
         DotfileEntry entry;
-        memset(&entry, 0, sizeof(entry));
-
-        char joined[PATH_MAX];
-        if (!join_paths(opts->repo_path, source_raw, joined, sizeof(joined))) {
-            log_error("Caminho de origem muito longo em linha %zu", line_number);
-            continue;
+        const char *tags[ENTRY_MAX_TAGS];
+        size_t tag_count = 0;
+        if (inline_tagged) {
+            tags[tag_count++] = inline_group;
         }
-        if (!normalize_path(joined, entry.source_path, sizeof(entry.source_path))) {
-            strncpy(entry.source_path, joined, sizeof(entry.source_path) - 1);
-        }
-
-        char target_buffer[PATH_MAX];
-        if (!expand_target(target_raw, target_buffer, sizeof(target_buffer))) {
-            log_error("Não foi possível resolver destino na linha %zu", line_number);
+        if (!parse_entry(opts, vars, trimmed, line_number, &entry, tags, &tag_count)) {
             continue;
         }
-        if (!normalize_path(target_buffer, entry.target_path, sizeof(entry.target_path))) {
-            strncpy(entry.target_path, target_buffer, sizeof(entry.target_path) - 1);
+        if (!visit(&entry, line_number, group, tags, tag_count, user)) {
+            return false;
         }
+    }
+    return true;
+}
 
-        entry.is_directory = detect_directory(source_raw) || detect_directory(target_raw);
+typedef struct {
+    DotfileConfig *config;
+    size_t capacity;
+} ConfigBuilder;
 
-        if (config->count == capacity) {
-            capacity *= 2;
-            DotfileEntry *tmp = realloc(config->entries, capacity * sizeof(DotfileEntry));
-            if (!tmp) {
-                log_error("Memória insuficiente ao carregar config");
-                free_config(config);
-                fclose(fp);
-                return false;
-            }
-            config->entries = tmp;
+static bool append_entry(const DotfileEntry *entry, size_t line_number, const char *group, const char **tags,
+                         size_t tag_count, void *user) {
+    (void)line_number;
+    ConfigBuilder *builder = user;
+    DotfileConfig *config = builder->config;
+    if (config->count == builder->capacity) {
+        builder->capacity *= 2;
+        DotfileEntry *tmp = realloc(config->entries, builder->capacity * sizeof(DotfileEntry));
+        if (!tmp) {
+            log_error("Memória insuficiente ao carregar config");
+            return false;
         }
+        config->entries = tmp;
+    }
+    if (!index_entry(config, config->count, group, tags, tag_count)) {
+        log_error("Memória insuficiente ao indexar config");
+        return false;
+    }
+    config->entries[config->count++] = *entry;
+    return true;
+}
+
+static FILE *open_config(const AppOptions *opts) {
+    fs_op(PROFILE_FS_OPEN);
+    FILE *fp = fopen(opts->config_path, "r");
+    if (!fp) {
+        log_error("Não foi possível abrir config '%s': %s", opts->config_path, strerror(errno));
+    }
+    return fp;
+}
+
+static bool parse_config(const AppOptions *opts, DotfileConfig *config) {
+    memset(config, 0, sizeof(*config));
+    config->vars = malloc(sizeof(PathVars));
+    if (!config->vars) {
+        return false;
+    }
+    path_vars_init(config->vars, opts);
+
+    FILE *fp = open_config(opts);
+    if (!fp) {
+        free_config(config);
+        return false;
+    }
 
-        config->entries[config->count++] = entry;
+    ConfigBuilder builder = {config, 8};
+    config->entries = calloc(builder.capacity, sizeof(DotfileEntry));
+    config->index = config_index_create();
+    if (!config->entries || !config->index || !parse_lines(opts, config->vars, fp, append_entry, &builder)) {
+        free_config(config);
+        fclose(fp);
+        return false;
     }
 
     fclose(fp);
+    if (!config_index_finish(config->index, config)) {
+        log_error("Memória insuficiente ao indexar config");
+        free_config(config);
+        return false;
+    }
+    config->vars_fingerprint = path_vars_fingerprint(config->vars);
     if (config->count == 0) {
         log_warn("Nenhuma entrada carregada do arquivo de configuração");
     }
     return true;
 }
 
+typedef struct {
+    ConfigEntrySink sink;
+    void *user;
+    size_t count;
+} StreamState;
+
+static bool forward_entry(const DotfileEntry *entry, size_t line_number, const char *group, const char **tags,
+                          size_t tag_count, void *user) {
+    (void)group;
+    (void)tags;
+    (void)tag_count;
+    StreamState *stream = user;
+    ++stream->count;
+    return stream->sink(entry, line_number, stream->user);
+}
+
+bool config_stream(const AppOptions *opts, PathVars *vars, ConfigEntrySink sink, void *user) {
+    if (!opts || !vars || !sink) {
+        return false;
+    }
+    FILE *fp = open_config(opts);
+    if (!fp) {
+        return false;
+    }
+    StreamState stream = {sink, user, 0};
+    bool ok = parse_lines(opts, vars, fp, forward_entry, &stream);
+    fclose(fp);
+    if (ok && stream.count == 0) {
+        log_warn("Nenhuma entrada carregada do arquivo de configuração");
+    }
+    return ok;
+}
+
+bool load_config(const AppOptions *opts, DotfileConfig *config) {
+    if (!opts || !config) {
+        return false;
+    }
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_LOAD_CONFIG);
+    bool ok = parse_config(opts, config);
+    profile_end(&span);
+    return ok;
+}
+
 void free_config(DotfileConfig *config) {
     if (!config) {
         return;
@@ -154,4 +395,11 @@ void free_config(DotfileConfig *config) {
     free(config->entries);
     config->entries = NULL;
     config->count = 0;
+    config_index_free(config->index);
+    config->index = NULL;
+    if (config->vars) {
+        path_vars_free(config->vars);
+        free(config->vars);
+        config->vars = NULL;
+    }
 }
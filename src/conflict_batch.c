@@ -0,0 +1,275 @@
+#define _DEFAULT_SOURCE
+
+#include "conflict_batch.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "conflict_manager.h"
+#include "deploy_copy.h"
+#include "template_render.h"
+#include "utils.h"
+
+typedef enum {
+    BATCH_UNDECIDED,
+    BATCH_BACKUP,
+    BATCH_OVERWRITE,
+    BATCH_SKIP
+} BatchChoice;
+
+typedef struct {
+    size_t index;
+    BatchChoice choice;
+} BatchConflict;
+
+typedef struct {
+    const AppOptions *opts;
+    const DotfileConfig *config;
+    const size_t *indices;
+    size_t count;
+    RunSummary summary;
+    bool ok;
+} CleanRun;
+
+/* Cada modo usa o mesmo critério da sua instalação, para que nenhum conflito chegue ao CONFLICT_BATCH. */
+static bool target_conflicts(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry) {
+    switch (entry->mode) {
+        case DEPLOY_RENDER:
+            return render_entry_conflicts(opts, config, entry);
+        case DEPLOY_COPY:
+        case DEPLOY_HARDLINK:
+            return deploy_entry_conflicts(opts, entry);
+        default:
+            break;
+    }
+#ifndef _WIN32
+    struct stat st;
+    if (lstat(entry->target_path, &st) != 0) {
+        return errno != ENOENT;
+    }
+    if (S_ISLNK(st.st_mode)) {
+        return !is_same_symlink_target(entry->target_path, entry->source_path);
+    }
+#else
+    if (!path_exists(entry->target_path)) {
+        return false;
+    }
+#endif
+    /* O collect copia o destino para o repositório antes de linkar: o conteúdo fica igual ao da fonte. */
+    return opts->command != CMD_COLLECT && !conflict_same_content(entry->target_path, entry->source_path);
+}
+
+static bool glob_match(const char *pattern, const char *text) {
+    while (*pattern) {
+        if (*pattern == '*') {
+            while (*pattern == '*') {
+                ++pattern;
+            }
+            if (!*pattern) {
+                return true;
+            }
+            for (; *text; ++text) {
+                if (glob_match(pattern, text)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (!*text || (*pattern != '?' && *pattern != *text)) {
+            return false;
+        }
+        ++pattern;
+        ++text;
+    }
+    return *text == '\0';
+}
+
+bool conflict_pattern_matches(const char *pattern, const char *target) {
+    size_t len = strlen(pattern);
+    if (len > 0 && pattern[len - 1] == '/') {
+        return strncmp(target, pattern, len) == 0 || (strncmp(target, pattern, len - 1) == 0 && target[len - 1] == '\0');
+    }
+    if (!strchr(pattern, '/')) {
+        const char *base = strrchr(target, '/');
+        return glob_match(pattern, base ? base + 1 : target);
+    }
+    return glob_match(pattern, target);
+}
+
+static void *run_clean_entries(void *arg) {
+    CleanRun *run = arg;
+    for (size_t i = 0; i < run->count; ++i) {
+        if (!run_entry(run->opts, run->config, run->indices[i], &run->summary)) {
+            run->ok = false;
+        }
+    }
+    return NULL;
+}
+
+static const char *choice_label(BatchChoice choice) {
+    switch (choice) {
+        case BATCH_BACKUP:
+            return "backup";
+        case BATCH_OVERWRITE:
+            return "sobrescrever";
+        case BATCH_SKIP:
+            return "pular";
+        default:
+            return "?";
+    }
+}
+
+static void print_conflicts(const DotfileConfig *config, const BatchConflict *conflicts, size_t count) {
+    printf("\n%zu conflito(s) encontrados:\n", count);
+    for (size_t i = 0; i < count; ++i) {
+        printf("  %3zu) %s\n", i + 1, config->entries[conflicts[i].index].target_path);
+    }
+    printf("Decida com '<b|s|p> <padrão>': b=backup, s=sobrescrever, p=pular.\n");
+    printf("Padrão: número da lista, diretório ('~/.config/'), glob ('*.conf', '~/.local/*') ou '*'.\n");
+    printf("A primeira regra que casar vale; linha vazia encerra e pula os restantes.\n");
+}
+
+static size_t apply_rule(const DotfileConfig *config, BatchConflict *conflicts, size_t count, BatchChoice choice,
+                         const char *pattern) {
+    char expanded[PATH_MAX];
+    if (!expand_home(pattern, expanded, sizeof(expanded))) {
+        snprintf(expanded, sizeof(expanded), "%s", pattern);
+    }
+    char *end;
+    unsigned long number = strtoul(pattern, &end, 10);
+    bool numeric = *pattern && *end == '\0';
+
+    size_t decided = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (conflicts[i].choice != BATCH_UNDECIDED) {
+            continue;
+        }
+        bool match = numeric ? number == i + 1 :
+            conflict_pattern_matches(expanded, config->entries[conflicts[i].index].target_path);
+        if (match) {
+            conflicts[i].choice = choice;
+            ++decided;
+        }
+    }
+    return decided;
+}
+
+static void collect_decisions(const DotfileConfig *config, BatchConflict *conflicts, size_t count) {
+    print_conflicts(config, conflicts, count);
+    size_t pending = count;
+    char line[PATH_MAX + 16];
+    while (pending > 0) {
+        printf("decisão> ");
+        fflush(stdout);
+        if (!fgets(line, sizeof(line), stdin)) {
+            printf("\n");
+            break;
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        char *cursor = line;
+        while (isspace((unsigned char)*cursor)) {
+            ++cursor;
+        }
+        if (*cursor == '\0') {
+            break;
+        }
+        BatchChoice choice;
+        switch (tolower((unsigned char)*cursor)) {
+            case 'b':
+                choice = BATCH_BACKUP;
+                break;
+            case 's':
+                choice = BATCH_OVERWRITE;
+                break;
+            case 'p':
+                choice = BATCH_SKIP;
+                break;
+            default:
+                printf("Opção inválida: use b, s ou p seguido de um padrão.\n");
+                continue;
+        }
+        ++cursor;
+        while (isspace((unsigned char)*cursor)) {
+            ++cursor;
+        }
+        if (*cursor == '\0') {
+            printf("Informe um padrão (ex.: 'b *').\n");
+            continue;
+        }
+        size_t decided = apply_rule(config, conflicts, count, choice, cursor);
+        pending -= decided;
+        printf("%zu conflito(s) -> %s, %zu pendente(s)\n", decided, choice_label(choice), pending);
+    }
+    fflush(stdout);
+    if (pending > 0) {
+        log_warn("%zu conflito(s) sem decisão serão pulados", pending);
+    }
+}
+
+bool run_batch(const AppOptions *opts, const DotfileConfig *config, RunSummary *summary) {
+    size_t *clean = malloc((config->count ? config->count : 1) * sizeof(size_t));
+    BatchConflict *conflicts = malloc((config->count ? config->count : 1) * sizeof(BatchConflict));
+    if (!clean || !conflicts) {
+        free(clean);
+        free(conflicts);
+        log_error("Memória insuficiente para o modo batch");
+        return false;
+    }
+    size_t clean_count = 0;
+    size_t conflict_count = 0;
+    for (size_t i = 0; i < config->count; ++i) {
+        if (target_conflicts(opts, config, &config->entries[i])) {
+            conflicts[conflict_count].index = i;
+            conflicts[conflict_count].choice = BATCH_UNDECIDED;
+            ++conflict_count;
+        } else {
+            clean[clean_count++] = i;
+        }
+    }
+
+    CleanRun run = {opts, config, clean, clean_count, {0, 0, 0}, true};
+    pthread_t worker;
+    bool threaded = conflict_count > 0 && clean_count > 0 &&
+        pthread_create(&worker, NULL, run_clean_entries, &run) == 0;
+    if (!threaded) {
+        run_clean_entries(&run);
+    }
+    if (conflict_count > 0) {
+        collect_decisions(config, conflicts, conflict_count);
+    }
+    if (threaded) {
+        pthread_join(worker, NULL);
+    }
+
+    bool ok = run.ok;
+    summary->processed += run.summary.processed;
+    summary->failed += run.summary.failed;
+
+    AppOptions backup_opts = *opts;
+    backup_opts.conflict_mode = CONFLICT_BACKUP;
+    AppOptions force_opts = *opts;
+    force_opts.conflict_mode = CONFLICT_FORCE;
+    for (size_t i = 0; i < conflict_count; ++i) {
+        const DotfileEntry *entry = &config->entries[conflicts[i].index];
+        switch (conflicts[i].choice) {
+            case BATCH_BACKUP:
+                ok = run_entry(&backup_opts, config, conflicts[i].index, summary) && ok;
+                break;
+            case BATCH_OVERWRITE:
+                ok = run_entry(&force_opts, config, conflicts[i].index, summary) && ok;
+                break;
+            default:
+                log_warn("Pulando %s", entry->target_path);
+                ++summary->processed;
+                break;
+        }
+    }
+    free(clean);
+    free(conflicts);
+    return ok;
+}
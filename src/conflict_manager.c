@@ -1,12 +1,21 @@
+#define _DEFAULT_SOURCE
+
 #include "conflict_manager.h"
 
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "backup_catalog.h"
+#include "io_sched.h"
+#include "profile.h"
 #include "utils.h"
 
 #ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #else
@@ -23,16 +32,19 @@ typedef struct _stat64i32 StatBuffer;
 typedef struct stat StatBuffer;
 #endif
 
-static bool remove_path(const char *path, bool dry_run) {
+bool conflict_remove(const AppOptions *opts, const char *path) {
+    bool dry_run = opts->dry_run;
     if (dry_run) {
         log_info("[dry-run] remover %s", path);
         return true;
     }
 #ifndef _WIN32
+    fs_op(PROFILE_FS_UNLINK);
     if (unlink(path) == 0) {
         return true;
     }
     if (errno == EPERM || errno == EISDIR) {
+        fs_op(PROFILE_FS_UNLINK);
         if (rmdir(path) == 0) {
             return true;
         }
@@ -49,7 +61,8 @@ static bool remove_path(const char *path, bool dry_run) {
     return false;
 }
 
-static bool backup_path(const char *path, bool dry_run) {
+bool conflict_backup(const AppOptions *opts, const char *path) {
+    bool dry_run = opts->dry_run;
     char backup_path[PATH_MAX];
     if (snprintf(backup_path, sizeof(backup_path), "%s.bak", path) >= (int)sizeof(backup_path)) {
         log_error("Caminho de backup muito longo para '%s'", path);
@@ -63,14 +76,200 @@ static bool backup_path(const char *path, bool dry_run) {
         log_info("[dry-run] mover %s -> %s", path, backup_path);
         return true;
     }
+    fs_op(PROFILE_FS_RENAME);
     if (rename(path, backup_path) != 0) {
         log_error("Não foi possível criar backup de '%s': %s", path, strerror(errno));
         return false;
     }
     log_info("Backup criado: %s", backup_path);
+    backup_catalog_record(opts, path, backup_path);
     return true;
 }
 
+#define COMPARE_CHUNK (64 * 1024)
+
+static bool same_stream_contents(FILE *a, FILE *b) {
+    char *left = malloc(COMPARE_CHUNK);
+    char *right = malloc(COMPARE_CHUNK);
+    bool same = left && right;
+    while (same) {
+        size_t got_left = fread(left, 1, COMPARE_CHUNK, a);
+        size_t got_right = fread(right, 1, COMPARE_CHUNK, b);
+        if (got_left != got_right || memcmp(left, right, got_left) != 0) {
+            same = false;
+        } else if (got_left < COMPARE_CHUNK) {
+            same = !ferror(a) && !ferror(b);
+            break;
+        }
+    }
+    free(left);
+    free(right);
+    return same;
+}
+
+static bool same_file_contents(const char *target, const char *source, long long size) {
+    if (size == 0) {
+        return true;
+    }
+    fs_op(PROFILE_FS_OPEN);
+    fs_op(PROFILE_FS_OPEN);
+#ifndef _WIN32
+    int fd_target = open(target, O_RDONLY);
+    int fd_source = open(source, O_RDONLY);
+    bool same = false;
+    if (fd_target >= 0 && fd_source >= 0) {
+        void *map_target = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd_target, 0);
+        void *map_source = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd_source, 0);
+        if (map_target != MAP_FAILED && map_source != MAP_FAILED) {
+            same = memcmp(map_target, map_source, (size_t)size) == 0;
+        } else {
+            FILE *a = fdopen(dup(fd_target), "rb");
+            FILE *b = fdopen(dup(fd_source), "rb");
+            same = a && b && same_stream_contents(a, b);
+            if (a) {
+                fclose(a);
+            }
+            if (b) {
+                fclose(b);
+            }
+        }
+        if (map_target != MAP_FAILED) {
+            munmap(map_target, (size_t)size);
+        }
+        if (map_source != MAP_FAILED) {
+            munmap(map_source, (size_t)size);
+        }
+    }
+    if (fd_target >= 0) {
+        close(fd_target);
+    }
+    if (fd_source >= 0) {
+        close(fd_source);
+    }
+    return same;
+#else
+    FILE *a = fopen(target, "rb");
+    FILE *b = fopen(source, "rb");
+    bool same = a && b && same_stream_contents(a, b);
+    if (a) {
+        fclose(a);
+    }
+    if (b) {
+        fclose(b);
+    }
+    return same;
+#endif
+}
+
+#ifndef _WIN32
+static size_t count_children(const char *path) {
+    fs_op(PROFILE_FS_OPENDIR);
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return (size_t)-1;
+    }
+    size_t count = 0;
+    struct dirent *child;
+    while ((child = readdir(dir)) != NULL) {
+        if (strcmp(child->d_name, ".") != 0 && strcmp(child->d_name, "..") != 0) {
+            ++count;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+#endif
+
+static bool same_tree(const char *target, const char *source) {
+    StatBuffer st_target;
+    StatBuffer st_source;
+    fs_op(PROFILE_FS_LSTAT);
+    fs_op(PROFILE_FS_LSTAT);
+    if (lstat(target, &st_target) != 0 || lstat(source, &st_source) != 0) {
+        return false;
+    }
+#ifndef _WIN32
+    if (st_target.st_dev == st_source.st_dev && st_target.st_ino == st_source.st_ino) {
+        return false;
+    }
+#endif
+    if (S_ISREG(st_target.st_mode) && S_ISREG(st_source.st_mode)) {
+        return st_target.st_size == st_source.st_size &&
+            same_file_contents(target, source, (long long)st_target.st_size);
+    }
+#ifndef _WIN32
+    if (S_ISLNK(st_target.st_mode) && S_ISLNK(st_source.st_mode)) {
+        char link_target[PATH_MAX];
+        char link_source[PATH_MAX];
+        return read_symlink_target(target, link_target, sizeof(link_target)) &&
+            read_symlink_target(source, link_source, sizeof(link_source)) &&
+            strcmp(link_target, link_source) == 0;
+    }
+    if (!S_ISDIR(st_target.st_mode) || !S_ISDIR(st_source.st_mode)) {
+        return false;
+    }
+    fs_op(PROFILE_FS_OPENDIR);
+    DIR *dir = opendir(target);
+    if (!dir) {
+        return false;
+    }
+    size_t count = 0;
+    bool same = true;
+    struct dirent *child;
+    while (same && (child = readdir(dir)) != NULL) {
+        if (strcmp(child->d_name, ".") == 0 || strcmp(child->d_name, "..") == 0) {
+            continue;
+        }
+        char target_child[PATH_MAX];
+        char source_child[PATH_MAX];
+        same = join_paths(target, child->d_name, target_child, sizeof(target_child)) &&
+            join_paths(source, child->d_name, source_child, sizeof(source_child)) &&
+            same_tree(target_child, source_child);
+        ++count;
+    }
+    closedir(dir);
+    return same && count_children(source) == count;
+#else
+    return false;
+#endif
+}
+
+bool conflict_same_content(const char *target_path, const char *source_path) {
+    if (!target_path || !source_path) {
+        return false;
+    }
+    return same_tree(target_path, source_path);
+}
+
+static bool remove_tree(const AppOptions *opts, const char *path) {
+#ifndef _WIN32
+    StatBuffer st;
+    fs_op(PROFILE_FS_LSTAT);
+    if (!opts->dry_run && lstat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        fs_op(PROFILE_FS_OPENDIR);
+        DIR *dir = opendir(path);
+        if (!dir) {
+            log_error("Não foi possível abrir diretório '%s': %s", path, strerror(errno));
+            return false;
+        }
+        bool ok = true;
+        struct dirent *child;
+        while (ok && (child = readdir(dir)) != NULL) {
+            if (strcmp(child->d_name, ".") == 0 || strcmp(child->d_name, "..") == 0) {
+                continue;
+            }
+            char child_path[PATH_MAX];
+            ok = join_paths(path, child->d_name, child_path, sizeof(child_path)) && remove_tree(opts, child_path);
+        }
+        closedir(dir);
+        if (!ok) {
+            return false;
+        }
+    }
+#endif
+    return conflict_remove(opts, path);
+}
+
 static ConflictOutcome prompt_user(const char *path) {
     printf("Encontrado conflito em '%s'. (b)ackup, (s)obrescrever, (p)ular? ", path);
     fflush(stdout);
@@ -94,11 +293,19 @@ static ConflictOutcome prompt_user(const char *path) {
     }
 }
 
-ConflictOutcome resolve_conflict(const AppOptions *opts, const char *target_path) {
-    if (!opts || !target_path) {
-        return CONFLICT_ERROR;
+/* As verificações do resolve_conflict antes de consultar o modo: true quando ele teria de decidir. */
+bool conflict_needs_decision(const char *target_path, const char *source_path) {
+    StatBuffer st;
+    fs_op(PROFILE_FS_LSTAT);
+    if (lstat(target_path, &st) != 0) {
+        return errno != ENOENT;
     }
+    return S_ISLNK(st.st_mode) || !conflict_same_content(target_path, source_path);
+}
+
+static ConflictOutcome resolve_existing(const AppOptions *opts, const char *target_path, const char *source_path) {
     StatBuffer st;
+    fs_op(PROFILE_FS_LSTAT);
     if (lstat(target_path, &st) != 0) {
         if (errno == ENOENT) {
             return CONFLICT_OK;
@@ -107,14 +314,22 @@ ConflictOutcome resolve_conflict(const AppOptions *opts, const char *target_path
         return CONFLICT_ERROR;
     }
 
+    if (!S_ISLNK(st.st_mode) && conflict_same_content(target_path, source_path)) {
+        if (!remove_tree(opts, target_path)) {
+            return CONFLICT_ERROR;
+        }
+        log_info("Conteúdo idêntico ao repositório, substituindo sem backup: %s", target_path);
+        return CONFLICT_OK;
+    }
+
     switch (opts->conflict_mode) {
         case CONFLICT_BACKUP:
-            if (backup_path(target_path, opts->dry_run)) {
+            if (conflict_backup(opts, target_path)) {
                 return CONFLICT_OK;
             }
             return CONFLICT_ERROR;
         case CONFLICT_FORCE:
-            if (remove_path(target_path, opts->dry_run)) {
+            if (conflict_remove(opts, target_path)) {
                 return CONFLICT_OK;
             }
             return CONFLICT_ERROR;
@@ -125,17 +340,31 @@ ConflictOutcome resolve_conflict(const AppOptions *opts, const char *target_path
             }
             if (choice == CONFLICT_OK) {
                 printf("Executando estratégia default (backup).\n");
-                if (backup_path(target_path, opts->dry_run)) {
+                if (conflict_backup(opts, target_path)) {
                     return CONFLICT_OK;
                 }
-                if (remove_path(target_path, opts->dry_run)) {
+                if (conflict_remove(opts, target_path)) {
                     return CONFLICT_OK;
                 }
             }
             return CONFLICT_ERROR;
         }
+        case CONFLICT_BATCH:
+            log_error("Conflito não detectado na pré-análise em '%s'", target_path);
+            return CONFLICT_ERROR;
         default:
             log_error("Modo de conflito desconhecido");
             return CONFLICT_ERROR;
     }
 }
+
+ConflictOutcome resolve_conflict(const AppOptions *opts, const char *target_path, const char *source_path) {
+    if (!opts || !target_path) {
+        return CONFLICT_ERROR;
+    }
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_CONFLICT);
+    ConflictOutcome outcome = resolve_existing(opts, target_path, source_path);
+    profile_end_detail(&span, target_path);
+    return outcome;
+}
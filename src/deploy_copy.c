@@ -0,0 +1,338 @@
+#define _DEFAULT_SOURCE
+
+#include "deploy_copy.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "backup_catalog.h"
+#include "collect.h"
+#include "conflict_manager.h"
+#include "fingerprint_cache.h"
+#include "io_sched.h"
+#include "state_db.h"
+#include "status_report.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define DEPLOY_CACHE "deploy"
+
+typedef enum {
+    TARGET_ABSENT,
+    TARGET_OWNED,
+    TARGET_MODIFIED,
+    TARGET_FOREIGN
+} TargetState;
+
+static bool hash_file(const char *path, uint64_t *hash) {
+    char *data = NULL;
+    size_t len = 0;
+    if (!read_file_contents(path, &data, &len)) {
+        return false;
+    }
+    *hash = hash_fnv1a64(data, len, HASH_FNV1A64_SEED);
+    free(data);
+    return true;
+}
+
+/* Carimbo barato da origem (tamanho, mtime, inode): enquanto não mudar, a cópia não precisa ser relida. */
+static bool source_stamp(const char *source, uint64_t *stamp) {
+    FileFingerprint fp;
+    if (!fingerprint_stat(source, &fp)) {
+        return false;
+    }
+    uint64_t hash = hash_fnv1a64(&fp.size, sizeof(fp.size), HASH_FNV1A64_SEED);
+    hash = hash_fnv1a64(&fp.mtime_ns, sizeof(fp.mtime_ns), hash);
+    *stamp = hash_fnv1a64(&fp.inode, sizeof(fp.inode), hash);
+    return true;
+}
+
+static bool target_occupied(const char *target) {
+#ifndef _WIN32
+    struct stat st;
+    fs_op(PROFILE_FS_LSTAT);
+    return lstat(target, &st) == 0;
+#else
+    return path_exists(target);
+#endif
+}
+
+/* Metadados iguais aos do cache bastam; só quando mudaram o destino é lido e comparado pelo hash
+ * (ex.: touch ou cópia idêntica), e o cache é atualizado para a próxima consulta sair pelo stat. */
+static TargetState inspect_copy(const AppOptions *opts, const char *target, FileFingerprint *cached) {
+    bool has_cache = fingerprint_cache_get(opts, DEPLOY_CACHE, target, cached);
+    FileFingerprint current;
+    if (!fingerprint_stat(target, &current)) {
+        return target_occupied(target) ? TARGET_FOREIGN : TARGET_ABSENT;
+    }
+    if (!has_cache) {
+        return TARGET_FOREIGN;
+    }
+    if (fingerprint_same_stat(&current, cached)) {
+        return TARGET_OWNED;
+    }
+    uint64_t content;
+    if (!hash_file(target, &content) || content != cached->content_hash) {
+        return TARGET_MODIFIED;
+    }
+    current.input_hash = cached->input_hash;
+    current.content_hash = content;
+    *cached = current;
+    if (!opts->dry_run) {
+        fingerprint_cache_put(opts, DEPLOY_CACHE, target, &current);
+    }
+    return TARGET_OWNED;
+}
+
+/* A origem mudou de metadados mas não de conteúdo: atualiza o carimbo sem recopiar. */
+static bool copy_up_to_date(const AppOptions *opts, const char *source, const char *target, FileFingerprint *cached) {
+    uint64_t stamp;
+    if (source_stamp(source, &stamp) && stamp == cached->input_hash) {
+        return true;
+    }
+    uint64_t content;
+    if (!hash_file(source, &content) || content != cached->content_hash) {
+        return false;
+    }
+    if (!opts->dry_run && source_stamp(source, &stamp)) {
+        cached->input_hash = stamp;
+        fingerprint_cache_put(opts, DEPLOY_CACHE, target, cached);
+    }
+    return true;
+}
+
+static void remember_copy(const AppOptions *opts, const DotfileEntry *entry) {
+    FileFingerprint fp;
+    if (opts->dry_run || !fingerprint_stat(entry->target_path, &fp)) {
+        return;
+    }
+    if (!source_stamp(entry->source_path, &fp.input_hash) || !hash_file(entry->source_path, &fp.content_hash)) {
+        return;
+    }
+    fingerprint_cache_put(opts, DEPLOY_CACHE, entry->target_path, &fp);
+    state_db_record(opts, STATE_COPY, entry->target_path, entry->source_path);
+}
+
+static bool same_inode(const char *a, const char *b) {
+#ifndef _WIN32
+    struct stat left;
+    struct stat right;
+    fs_op(PROFILE_FS_LSTAT);
+    if (lstat(a, &left) != 0 || !S_ISREG(left.st_mode)) {
+        return false;
+    }
+    fs_op(PROFILE_FS_STAT);
+    return stat(b, &right) == 0 && left.st_dev == right.st_dev && left.st_ino == right.st_ino;
+#else
+    (void)a;
+    (void)b;
+    return false;
+#endif
+}
+
+static TargetState inspect_hardlink(const AppOptions *opts, const DotfileEntry *entry) {
+    if (same_inode(entry->target_path, entry->source_path)) {
+        return TARGET_OWNED;
+    }
+    if (!target_occupied(entry->target_path)) {
+        return TARGET_ABSENT;
+    }
+    FileFingerprint cached;
+    return fingerprint_cache_get(opts, DEPLOY_CACHE, entry->target_path, &cached) ? TARGET_MODIFIED : TARGET_FOREIGN;
+}
+
+static bool create_hardlink(const AppOptions *opts, const DotfileEntry *entry) {
+    if (opts->dry_run) {
+        log_info("[dry-run] ln %s %s", entry->source_path, entry->target_path);
+        return true;
+    }
+#ifndef _WIN32
+    if (link(entry->source_path, entry->target_path) != 0) {
+        log_error("Falha ao criar hardlink %s -> %s: %s", entry->target_path, entry->source_path, strerror(errno));
+        if (errno == EXDEV) {
+            log_warn("Repositório e destino estão em sistemas de arquivos diferentes; use '| copy'");
+        }
+        return false;
+    }
+    log_info("Hardlink criado: %s -> %s", entry->target_path, entry->source_path);
+    FileFingerprint fp;
+    if (fingerprint_stat(entry->target_path, &fp)) {
+        fp.input_hash = 0;
+        fp.content_hash = 0;
+        fingerprint_cache_put(opts, DEPLOY_CACHE, entry->target_path, &fp);
+    }
+    state_db_record(opts, STATE_HARDLINK, entry->target_path, entry->source_path);
+    return true;
+#else
+    log_error("Hardlinks não são suportados no Windows: %s", entry->target_path);
+    return false;
+#endif
+}
+
+/* Um symlink antigo para a própria origem (entrada que era '| link') é trocado sem backup. */
+static ConflictOutcome clear_target(const AppOptions *opts, const DotfileEntry *entry) {
+    if (is_same_symlink_target(entry->target_path, entry->source_path)) {
+        return conflict_remove(opts, entry->target_path) ? CONFLICT_OK : CONFLICT_ERROR;
+    }
+    return resolve_conflict(opts, entry->target_path, entry->source_path);
+}
+
+bool deploy_install_entry(const AppOptions *opts, const DotfileEntry *entry) {
+    if (!opts || !entry) {
+        return false;
+    }
+    bool hardlink = entry->mode == DEPLOY_HARDLINK;
+    FileFingerprint cached;
+    TargetState state = hardlink ? inspect_hardlink(opts, entry) : inspect_copy(opts, entry->target_path, &cached);
+    if (state == TARGET_OWNED &&
+        (hardlink || copy_up_to_date(opts, entry->source_path, entry->target_path, &cached))) {
+        if (opts->verbose) {
+            log_info(hardlink ? "Hardlink atualizado: %s" : "Cópia atualizada: %s", entry->target_path);
+        }
+        return true;
+    }
+    if (state == TARGET_FOREIGN || state == TARGET_MODIFIED) {
+        if (state == TARGET_MODIFIED) {
+            log_warn(hardlink ? "%s não é mais hardlink do repositório" :
+                     "%s foi modificado desde a última cópia", entry->target_path);
+        }
+        ConflictOutcome outcome = clear_target(opts, entry);
+        if (outcome == CONFLICT_SKIP) {
+            log_warn("Pulando %s", entry->target_path);
+            return true;
+        }
+        if (outcome == CONFLICT_ERROR) {
+            return false;
+        }
+    }
+    if (!ensure_parent_dirs(entry->target_path, opts->dry_run)) {
+        return false;
+    }
+    if (hardlink) {
+        return create_hardlink(opts, entry);
+    }
+    if (!collect_copy_tree(opts, entry->source_path, entry->target_path)) {
+        return false;
+    }
+    if (!opts->dry_run) {
+        log_info("Cópia criada: %s -> %s", entry->source_path, entry->target_path);
+    }
+    remember_copy(opts, entry);
+    return true;
+}
+
+/* Mesmo critério do deploy_install_entry/clear_target. No collect o destino alheio ou modificado é
+ * coletado antes, e a instalação que segue encontra o mesmo conteúdo: não há o que decidir. */
+bool deploy_entry_conflicts(const AppOptions *opts, const DotfileEntry *entry) {
+    if (opts->command == CMD_COLLECT) {
+        return false;
+    }
+    FileFingerprint cached;
+    TargetState state = entry->mode == DEPLOY_HARDLINK ? inspect_hardlink(opts, entry) :
+                        inspect_copy(opts, entry->target_path, &cached);
+    if (state != TARGET_FOREIGN && state != TARGET_MODIFIED) {
+        return false;
+    }
+    return !is_same_symlink_target(entry->target_path, entry->source_path) &&
+           conflict_needs_decision(entry->target_path, entry->source_path);
+}
+
+EntryStatus deploy_inspect_status(const AppOptions *opts, const DotfileEntry *entry) {
+    TargetState state;
+    FileFingerprint cached;
+    if (entry->mode == DEPLOY_HARDLINK) {
+        state = inspect_hardlink(opts, entry);
+    } else {
+        state = inspect_copy(opts, entry->target_path, &cached);
+    }
+    switch (state) {
+        case TARGET_ABSENT:
+            return STATUS_MISSING;
+        case TARGET_FOREIGN:
+            return STATUS_CONFLICT;
+        case TARGET_MODIFIED:
+            return STATUS_DIVERGENT;
+        case TARGET_OWNED:
+            break;
+    }
+    if (entry->mode == DEPLOY_HARDLINK) {
+        return STATUS_OK;
+    }
+    if (!path_exists(entry->source_path)) {
+        log_error("Erro ao checar %s: origem inexistente", entry->source_path);
+        return STATUS_ERROR;
+    }
+    return copy_up_to_date(opts, entry->source_path, entry->target_path, &cached) ? STATUS_OK : STATUS_STALE;
+}
+
+bool deploy_status_entry(const AppOptions *opts, const DotfileEntry *entry) {
+    if (!opts || !entry) {
+        return false;
+    }
+    EntryStatus state = deploy_inspect_status(opts, entry);
+    status_log_result(entry, state, "");
+    return state != STATUS_ERROR;
+}
+
+bool deploy_uninstall_entry(const AppOptions *opts, const DotfileEntry *entry) {
+    if (!opts || !entry) {
+        return false;
+    }
+    FileFingerprint cached;
+    TargetState state = entry->mode == DEPLOY_HARDLINK ? inspect_hardlink(opts, entry) :
+                        inspect_copy(opts, entry->target_path, &cached);
+    if (state == TARGET_FOREIGN) {
+        log_warn("Destino %s não foi criado pelo dotmgr, pulando", entry->target_path);
+        return true;
+    }
+    if (state == TARGET_MODIFIED) {
+        log_warn("%s foi modificado desde a instalação, pulando", entry->target_path);
+        return true;
+    }
+    if (state == TARGET_OWNED) {
+        if (opts->dry_run) {
+            log_info("[dry-run] remover %s", entry->target_path);
+        } else if (remove(entry->target_path) != 0) {
+            log_error("Falha ao remover '%s': %s", entry->target_path, strerror(errno));
+            return false;
+        } else {
+            log_info("Removido: %s", entry->target_path);
+            fingerprint_cache_remove(opts, DEPLOY_CACHE, entry->target_path);
+            state_db_forget(opts, entry->target_path);
+        }
+    } else if (opts->verbose) {
+        log_info("Destino inexistente: %s", entry->target_path);
+    }
+    return !opts->restore_backups || backup_catalog_restore(opts, entry->target_path);
+}
+
+/* Edições locais numa cópia (ou num hardlink que o editor substituiu) voltam para o repositório. */
+bool deploy_collect_entry(const AppOptions *opts, const DotfileEntry *entry) {
+    if (!opts || !entry) {
+        return false;
+    }
+    FileFingerprint cached;
+    TargetState state = entry->mode == DEPLOY_HARDLINK ? inspect_hardlink(opts, entry) :
+                        inspect_copy(opts, entry->target_path, &cached);
+    FileFingerprint target;
+    if ((state == TARGET_MODIFIED || state == TARGET_FOREIGN) && fingerprint_stat(entry->target_path, &target)) {
+        log_info("Coletando %s -> %s", entry->target_path, entry->source_path);
+        if (!collect_copy_tree(opts, entry->target_path, entry->source_path)) {
+            return false;
+        }
+        if (entry->mode == DEPLOY_COPY) {
+            remember_copy(opts, entry);
+            return true;
+        }
+        if (!collect_sync_entry(opts)) {
+            return false;
+        }
+    }
+    return deploy_install_entry(opts, entry);
+}
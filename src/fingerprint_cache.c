@@ -0,0 +1,259 @@
+#define _DEFAULT_SOURCE
+
+#include "fingerprint_cache.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "io_sched.h"
+#include "strmap.h"
+#include "utils.h"
+
+#define MAX_CACHES 4
+
+typedef struct {
+    char *key;
+    FileFingerprint fp;
+    bool removed;
+    bool touched;
+} CacheRecord;
+
+typedef struct {
+    char name[32];
+    char path[PATH_MAX];
+    CacheRecord *records;
+    size_t count;
+    size_t capacity;
+    StrMap index;
+    bool dirty;
+} FingerprintCache;
+
+static FingerprintCache caches[MAX_CACHES];
+static size_t cache_count;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+bool fingerprint_stat(const char *path, FileFingerprint *fp) {
+    if (!path || !fp) {
+        return false;
+    }
+    fs_op(PROFILE_FS_LSTAT);
+#ifndef _WIN32
+    struct stat st;
+    if (lstat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    fp->mtime_ns = stat_mtime_ns(&st);
+    fp->inode = (unsigned long long)st.st_ino;
+#else
+    struct _stat64i32 st;
+    if (_stat(path, &st) != 0 || !(st.st_mode & _S_IFREG)) {
+        return false;
+    }
+    fp->mtime_ns = (long long)st.st_mtime * 1000000000LL;
+    fp->inode = 0;
+#endif
+    fp->size = (long long)st.st_size;
+    return true;
+}
+
+bool fingerprint_same_stat(const FileFingerprint *a, const FileFingerprint *b) {
+    return a->size == b->size && a->mtime_ns == b->mtime_ns && a->inode == b->inode;
+}
+
+static bool cache_insert(FingerprintCache *cache, const char *key, const FileFingerprint *fp) {
+    size_t index;
+    if (strmap_get(&cache->index, key, &index)) {
+        cache->records[index].fp = *fp;
+        cache->records[index].removed = false;
+        return true;
+    }
+    if (cache->count == cache->capacity) {
+        size_t next = cache->capacity ? cache->capacity * 2 : 32;
+        CacheRecord *tmp = realloc(cache->records, next * sizeof(CacheRecord));
+        if (!tmp) {
+            return false;
+        }
+        cache->records = tmp;
+        cache->capacity = next;
+    }
+    CacheRecord *record = &cache->records[cache->count];
+    record->key = malloc(strlen(key) + 1);
+    if (!record->key) {
+        return false;
+    }
+    strcpy(record->key, key);
+    record->fp = *fp;
+    record->removed = false;
+    record->touched = false;
+    if (!strmap_put(&cache->index, key, cache->count)) {
+        free(record->key);
+        return false;
+    }
+    ++cache->count;
+    return true;
+}
+
+/* Com merge, os registros alterados nesta execução prevalecem sobre os que estão no disco. */
+static void cache_read(FingerprintCache *cache, bool merge) {
+    FILE *fp = fopen(cache->path, "r");
+    if (!fp) {
+        return;
+    }
+    char line[PATH_MAX + 160];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *tab = strchr(line, '\t');
+        if (!tab) {
+            continue;
+        }
+        *tab = '\0';
+        size_t index;
+        if (merge && strmap_get(&cache->index, line, &index) && cache->records[index].touched) {
+            continue;
+        }
+        FileFingerprint record;
+        if (sscanf(tab + 1, "%" SCNx64 "\t%" SCNx64 "\t%lld\t%lld\t%llu",
+                   &record.input_hash, &record.content_hash, &record.size,
+                   &record.mtime_ns, &record.inode) != 5) {
+            continue;
+        }
+        cache_insert(cache, line, &record);
+    }
+    fclose(fp);
+}
+
+static FingerprintCache *cache_open(const AppOptions *opts, const char *name) {
+    char path[PATH_MAX];
+    char file[64];
+    snprintf(file, sizeof(file), "%s-cache.tsv", name);
+    if (!join_paths(opts->state_dir, file, path, sizeof(path))) {
+        return NULL;
+    }
+    for (size_t i = 0; i < cache_count; ++i) {
+        if (strcmp(caches[i].name, name) == 0 && strcmp(caches[i].path, path) == 0) {
+            return &caches[i];
+        }
+    }
+    if (cache_count == MAX_CACHES) {
+        return NULL;
+    }
+    FingerprintCache *cache = &caches[cache_count];
+    memset(cache, 0, sizeof(*cache));
+    snprintf(cache->name, sizeof(cache->name), "%s", name);
+    snprintf(cache->path, sizeof(cache->path), "%s", path);
+    if (!strmap_init(&cache->index, 64)) {
+        return NULL;
+    }
+    ++cache_count;
+    cache_read(cache, false);
+    return cache;
+}
+
+bool fingerprint_cache_get(const AppOptions *opts, const char *cache_name, const char *key, FileFingerprint *out) {
+    if (!opts || !cache_name || !key || !out) {
+        return false;
+    }
+    pthread_mutex_lock(&cache_lock);
+    bool found = false;
+    FingerprintCache *cache = cache_open(opts, cache_name);
+    size_t index;
+    if (cache && strmap_get(&cache->index, key, &index) && !cache->records[index].removed) {
+        *out = cache->records[index].fp;
+        found = true;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return found;
+}
+
+bool fingerprint_cache_put(const AppOptions *opts, const char *cache_name, const char *key, const FileFingerprint *fp) {
+    if (!opts || !cache_name || !key || !fp) {
+        return false;
+    }
+    pthread_mutex_lock(&cache_lock);
+    FingerprintCache *cache = cache_open(opts, cache_name);
+    size_t index;
+    bool ok = cache && cache_insert(cache, key, fp) && strmap_get(&cache->index, key, &index);
+    if (ok) {
+        cache->records[index].touched = true;
+        cache->dirty = true;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return ok;
+}
+
+void fingerprint_cache_remove(const AppOptions *opts, const char *cache_name, const char *key) {
+    if (!opts || !cache_name || !key) {
+        return;
+    }
+    pthread_mutex_lock(&cache_lock);
+    FingerprintCache *cache = cache_open(opts, cache_name);
+    size_t index;
+    if (cache && strmap_get(&cache->index, key, &index)) {
+        cache->records[index].removed = true;
+        cache->records[index].touched = true;
+        cache->dirty = true;
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+/* Chamado sob o lock de estado: o arquivo é relido para não descartar o que outra execução gravou
+ * desde o carregamento, e só os registros alterados nesta o sobrescrevem. */
+static bool cache_write(FingerprintCache *cache) {
+    for (size_t i = 0; i < cache->count; ++i) {
+        if (!cache->records[i].touched) {
+            cache->records[i].removed = true;
+        }
+    }
+    cache_read(cache, true);
+    char tmp_path[PATH_MAX + 8];
+    FILE *fp = open_sibling_temp(cache->path, tmp_path, sizeof(tmp_path));
+    if (!fp) {
+        log_warn("Não foi possível gravar cache '%s': %s", cache->path, strerror(errno));
+        return false;
+    }
+    for (size_t i = 0; i < cache->count; ++i) {
+        const CacheRecord *record = &cache->records[i];
+        if (record->removed) {
+            continue;
+        }
+        fprintf(fp, "%s\t%016" PRIx64 "\t%016" PRIx64 "\t%lld\t%lld\t%llu\n", record->key,
+                record->fp.input_hash, record->fp.content_hash, record->fp.size,
+                record->fp.mtime_ns, record->fp.inode);
+    }
+    if (fclose(fp) != 0 || rename(tmp_path, cache->path) != 0) {
+        log_warn("Não foi possível gravar cache '%s'", cache->path);
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+bool fingerprint_cache_flush(const AppOptions *opts) {
+    if (!opts) {
+        return false;
+    }
+    pthread_mutex_lock(&cache_lock);
+    bool ok = true;
+    for (size_t i = 0; i < cache_count; ++i) {
+        FingerprintCache *cache = &caches[i];
+        if (cache->dirty && !opts->dry_run) {
+            if (!make_dirs(opts->state_dir) || !cache_write(cache)) {
+                ok = false;
+            }
+        }
+        for (size_t r = 0; r < cache->count; ++r) {
+            free(cache->records[r].key);
+        }
+        free(cache->records);
+        strmap_free(&cache->index);
+        memset(cache, 0, sizeof(*cache));
+    }
+    cache_count = 0;
+    pthread_mutex_unlock(&cache_lock);
+    return ok;
+}
@@ -1,34 +1,143 @@
+#define _DEFAULT_SOURCE
+
 #include "git_helper.h"
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "collect.h"
+#include "profile.h"
+#include "target_lock.h"
 #include "utils.h"
 
-static bool run_git(const AppOptions *opts, const char *args) {
+#ifndef _WIN32
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#else
+#include <io.h>
+#include <process.h>
+#endif
+
+#define GIT_MAX_ARGS 16
+
+static void describe_command(const char *const *argv, char *output, size_t len) {
+    size_t used = 0;
+    output[0] = '\0';
+    for (size_t i = 0; argv[i] && used < len; ++i) {
+        int written = snprintf(output + used, len - used, i ? " %s" : "%s", argv[i]);
+        if (written < 0) {
+            break;
+        }
+        used += (size_t)written;
+    }
+}
+
+/* Executa git sem passar por shell: argumentos (ex.: a mensagem de commit) chegam intactos. A saída do
+ * git vai para stderr, já que stdout pode ser o fluxo JSON do batch ou de quem embute a biblioteca. */
+static int spawn_git(char *const *argv) {
+#ifndef _WIN32
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions) != 0) {
+        return -1;
+    }
+    pid_t pid;
+    int rc = posix_spawn_file_actions_adddup2(&actions, STDERR_FILENO, STDOUT_FILENO);
+    if (rc == 0) {
+        rc = posix_spawnp(&pid, "git", &actions, NULL, argv, environ);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) {
+        errno = rc;
+        return -1;
+    }
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+#else
+    char quoted[GIT_MAX_ARGS][1100];
+    const char *args[GIT_MAX_ARGS + 1];
+    size_t count = 0;
+    for (; argv[count] && count < GIT_MAX_ARGS; ++count) {
+        if (strpbrk(argv[count], " \t\"")) {
+            snprintf(quoted[count], sizeof(quoted[count]), "\"%s\"", argv[count]);
+            args[count] = quoted[count];
+        } else {
+            args[count] = argv[count];
+        }
+    }
+    args[count] = NULL;
+    fflush(stdout);
+    int saved = _dup(1);
+    _dup2(2, 1);
+    intptr_t rc = _spawnvp(_P_WAIT, "git", args);
+    if (saved >= 0) {
+        _dup2(saved, 1);
+        _close(saved);
+    }
+    return rc < 0 ? -1 : (int)rc;
+#endif
+}
+
+static bool run_git(const AppOptions *opts, const char *const *args) {
+    char *argv[GIT_MAX_ARGS + 4];
+    size_t argc = 0;
+    argv[argc++] = "git";
+    argv[argc++] = "-C";
+    argv[argc++] = (char *)opts->project_root;
+    for (size_t i = 0; args[i] && argc < GIT_MAX_ARGS + 3; ++i) {
+        argv[argc++] = (char *)args[i];
+    }
+    argv[argc] = NULL;
+
     char command[1024];
-    snprintf(command, sizeof(command), "cd '%s' && git %s", opts->project_root, args);
+    describe_command((const char *const *)argv, command, sizeof(command));
     log_info("Executando: %s", command);
-    int rc = system(command);
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_GIT_COMMAND);
+    int rc = spawn_git(argv);
+    profile_end_detail(&span, command);
+    if (rc < 0) {
+        log_warn("Não foi possível executar git: %s", strerror(errno));
+        return false;
+    }
     if (rc != 0) {
-        log_warn("Comando git falhou (%d): %s", rc, args);
+        log_warn("Comando git falhou (%d): %s", rc, command);
         return false;
     }
     return true;
 }
 
-bool git_auto_sync(const AppOptions *opts) {
-    if (!run_git(opts, "status --short")) {
+static bool sync_repository(const AppOptions *opts) {
+    const char *status[] = {"status", "--short", NULL};
+    if (!run_git(opts, status)) {
         return false;
     }
-    if (!run_git(opts, "add .")) {
+    const char *add[] = {"add", "--", ".", ":(exclude,glob)**/" TARGET_LOCK_FILE,
+                         ":(exclude,glob)**/*" COLLECT_PARTIAL_SUFFIX, NULL};
+    if (!run_git(opts, add)) {
         return false;
     }
-    char commit_cmd[1024];
-    snprintf(commit_cmd, sizeof(commit_cmd), "commit -m \"%s\"", opts->git_message);
-    if (!run_git(opts, commit_cmd)) {
+    const char *commit[] = {"commit", "-m", opts->git_message, NULL};
+    if (!run_git(opts, commit)) {
         return false;
     }
-    return run_git(opts, "push");
+    const char *push[] = {"push", NULL};
+    return run_git(opts, push);
+}
+
+bool git_auto_sync(const AppOptions *opts) {
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_GIT_SYNC);
+    bool ok = sync_repository(opts);
+    profile_end(&span);
+    return ok;
 }
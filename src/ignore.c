@@ -0,0 +1,315 @@
+#include "ignore.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strmap.h"
+#include "utils.h"
+
+#define IGNORE_NONE SIZE_MAX
+
+typedef struct {
+    char *pattern;
+    bool negate;
+    bool dir_only;
+    bool anchored;
+    size_t previous;
+} IgnoreRule;
+
+struct IgnoreRules {
+    IgnoreRule *rules;
+    size_t count;
+    size_t capacity;
+    StrMap names;
+    StrMap suffixes;
+    StrMap paths;
+    size_t *globs;
+    size_t glob_count;
+};
+
+IgnoreRules *ignore_create(void) {
+    IgnoreRules *rules = calloc(1, sizeof(IgnoreRules));
+    if (!rules) {
+        return NULL;
+    }
+    if (!strmap_init(&rules->names, 16) || !strmap_init(&rules->suffixes, 16) || !strmap_init(&rules->paths, 16)) {
+        ignore_free(rules);
+        return NULL;
+    }
+    return rules;
+}
+
+void ignore_free(IgnoreRules *rules) {
+    if (!rules) {
+        return;
+    }
+    for (size_t i = 0; i < rules->count; ++i) {
+        free(rules->rules[i].pattern);
+    }
+    free(rules->rules);
+    free(rules->globs);
+    strmap_free(&rules->names);
+    strmap_free(&rules->suffixes);
+    strmap_free(&rules->paths);
+    free(rules);
+}
+
+size_t ignore_count(const IgnoreRules *rules) {
+    return rules ? rules->count : 0;
+}
+
+static bool has_wildcard(const char *text) {
+    return strpbrk(text, "*?[\\") != NULL;
+}
+
+/* Cada chave aponta para a regra mais recente com ela; previous encadeia as anteriores. */
+static bool index_rule(StrMap *map, const char *key, IgnoreRules *rules, size_t index) {
+    size_t previous;
+    rules->rules[index].previous = strmap_get(map, key, &previous) ? previous : IGNORE_NONE;
+    return strmap_put(map, key, index);
+}
+
+bool ignore_add(IgnoreRules *rules, const char *line) {
+    if (!rules || !line) {
+        return false;
+    }
+    char buffer[4096];
+    size_t len = strcspn(line, "\r\n");
+    if (len >= sizeof(buffer)) {
+        return false;
+    }
+    memcpy(buffer, line, len);
+    buffer[len] = '\0';
+    while (len > 0 && buffer[len - 1] == ' ' && (len < 2 || buffer[len - 2] != '\\')) {
+        buffer[--len] = '\0';
+    }
+    char *pattern = buffer;
+    if (len == 0 || pattern[0] == '#') {
+        return true;
+    }
+    bool negate = false;
+    if (pattern[0] == '!') {
+        negate = true;
+        ++pattern;
+    } else if (pattern[0] == '\\' && (pattern[1] == '!' || pattern[1] == '#')) {
+        ++pattern;
+    }
+    len = strlen(pattern);
+    bool dir_only = false;
+    while (len > 0 && pattern[len - 1] == '/') {
+        dir_only = true;
+        pattern[--len] = '\0';
+    }
+    bool anchored = strchr(pattern, '/') != NULL;
+    while (*pattern == '/') {
+        ++pattern;
+    }
+    if (*pattern == '\0') {
+        return true;
+    }
+
+    if (rules->count == rules->capacity) {
+        size_t capacity = rules->capacity ? rules->capacity * 2 : 16;
+        IgnoreRule *grown = realloc(rules->rules, capacity * sizeof(IgnoreRule));
+        size_t *globs = realloc(rules->globs, capacity * sizeof(size_t));
+        if (grown) {
+            rules->rules = grown;
+        }
+        if (globs) {
+            rules->globs = globs;
+        }
+        if (!grown || !globs) {
+            return false;
+        }
+        rules->capacity = capacity;
+    }
+    size_t index = rules->count;
+    IgnoreRule *rule = &rules->rules[index];
+    rule->pattern = malloc(strlen(pattern) + 1);
+    if (!rule->pattern) {
+        return false;
+    }
+    strcpy(rule->pattern, pattern);
+    rule->negate = negate;
+    rule->dir_only = dir_only;
+    rule->anchored = anchored;
+    rule->previous = IGNORE_NONE;
+
+    bool ok;
+    if (!has_wildcard(pattern)) {
+        ok = index_rule(anchored ? &rules->paths : &rules->names, pattern, rules, index);
+    } else if (!anchored && pattern[0] == '*' && pattern[1] == '.' && !has_wildcard(pattern + 1)) {
+        ok = index_rule(&rules->suffixes, pattern + 1, rules, index);
+    } else {
+        rules->globs[rules->glob_count++] = index;
+        ok = true;
+    }
+    if (!ok) {
+        free(rule->pattern);
+        return false;
+    }
+    ++rules->count;
+    return true;
+}
+
+bool ignore_load(IgnoreRules *rules, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        if (errno == ENOENT || errno == ENOTDIR) {
+            return true;
+        }
+        log_warn("Não foi possível ler '%s': %s", path, strerror(errno));
+        return false;
+    }
+    char line[4096];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp)) {
+        ok = ignore_add(rules, line);
+    }
+    fclose(fp);
+    if (!ok) {
+        log_warn("Padrão inválido em '%s'", path);
+    }
+    return ok;
+}
+
+static bool match_class(const char **pattern, char c) {
+    const char *p = *pattern + 1;
+    bool negate = *p == '!' || *p == '^';
+    if (negate) {
+        ++p;
+    }
+    bool matched = false;
+    bool first = true;
+    while (*p && (first || *p != ']')) {
+        char low = *p;
+        if (low == '\\' && p[1]) {
+            low = *++p;
+        }
+        char high = low;
+        if (p[1] == '-' && p[2] && p[2] != ']') {
+            high = p[2];
+            p += 2;
+        }
+        if (c >= low && c <= high) {
+            matched = true;
+        }
+        ++p;
+        first = false;
+    }
+    if (*p != ']') {
+        return false;
+    }
+    *pattern = p + 1;
+    return matched != negate && c != '/';
+}
+
+/* '*', '?' e classes não cruzam '/'; '**' entre barras casa qualquer número de diretórios. */
+static bool glob_match(const char *start, const char *p, const char *t) {
+    while (*p) {
+        if (p[0] == '*' && p[1] == '*' && (p == start || p[-1] == '/') && (p[2] == '/' || p[2] == '\0')) {
+            if (p[2] == '\0') {
+                return true;
+            }
+            p += 3;
+            for (;;) {
+                if (glob_match(start, p, t)) {
+                    return true;
+                }
+                t = strchr(t, '/');
+                if (!t) {
+                    return false;
+                }
+                ++t;
+            }
+        }
+        if (*p == '*') {
+            while (*p == '*') {
+                ++p;
+            }
+            for (;;) {
+                if (glob_match(start, p, t)) {
+                    return true;
+                }
+                if (*t == '\0' || *t == '/') {
+                    return false;
+                }
+                ++t;
+            }
+        }
+        if (*p == '?') {
+            if (*t == '\0' || *t == '/') {
+                return false;
+            }
+            ++p;
+            ++t;
+            continue;
+        }
+        if (*p == '[') {
+            if (*t == '\0' || !match_class(&p, *t)) {
+                return false;
+            }
+            ++t;
+            continue;
+        }
+        if (*p == '\\' && p[1]) {
+            ++p;
+        }
+        if (*p != *t) {
+            return false;
+        }
+        ++p;
+        ++t;
+    }
+    return *t == '\0';
+}
+
+static size_t newest_applicable(const IgnoreRules *rules, const StrMap *map, const char *key, bool is_dir) {
+    size_t index;
+    if (!strmap_get(map, key, &index)) {
+        return IGNORE_NONE;
+    }
+    while (index != IGNORE_NONE && rules->rules[index].dir_only && !is_dir) {
+        index = rules->rules[index].previous;
+    }
+    return index;
+}
+
+static void keep_newest(size_t *best, size_t candidate) {
+    if (candidate != IGNORE_NONE && (*best == IGNORE_NONE || candidate > *best)) {
+        *best = candidate;
+    }
+}
+
+/* relative é o caminho a partir da raiz das regras, com '/'. */
+bool ignore_match(const IgnoreRules *rules, const char *relative, bool is_dir) {
+    if (!rules || rules->count == 0 || !relative) {
+        return false;
+    }
+    const char *slash = strrchr(relative, '/');
+    const char *name = slash ? slash + 1 : relative;
+    size_t best = IGNORE_NONE;
+    keep_newest(&best, newest_applicable(rules, &rules->names, name, is_dir));
+    keep_newest(&best, newest_applicable(rules, &rules->paths, relative, is_dir));
+    for (const char *dot = strchr(name, '.'); dot; dot = strchr(dot + 1, '.')) {
+        keep_newest(&best, newest_applicable(rules, &rules->suffixes, dot, is_dir));
+    }
+    for (size_t i = rules->glob_count; i > 0; --i) {
+        size_t index = rules->globs[i - 1];
+        if (best != IGNORE_NONE && index < best) {
+            break;
+        }
+        const IgnoreRule *rule = &rules->rules[index];
+        if (rule->dir_only && !is_dir) {
+            continue;
+        }
+        const char *subject = rule->anchored ? relative : name;
+        if (glob_match(rule->pattern, rule->pattern, subject)) {
+            best = index;
+            break;
+        }
+    }
+    return best != IGNORE_NONE && !rules->rules[best].negate;
+}
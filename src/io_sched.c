@@ -0,0 +1,177 @@
+#define _DEFAULT_SOURCE
+
+#include "io_sched.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+#define IO_LOAD_CHECK_NS 1000000000ULL
+#define IO_MIN_SCALE (1.0 / 16.0)
+/* Sem --io-rate/--iops, é daqui que o recuo por carga parte. */
+#define IO_BACKOFF_RATE (8.0 * 1024.0 * 1024.0)
+#define IO_BACKOFF_IOPS 200.0
+
+#if defined(__linux__) && defined(SYS_ioprio_set)
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_CLASS_SHIFT 13
+#endif
+
+typedef struct {
+    IoTokenBucket bytes;
+    IoTokenBucket ops;
+    double max_load;
+    double scale;
+    uint64_t load_checked_ns;
+    uint64_t waited_ns;
+    int saved_ioprio;
+    bool ioprio_changed;
+} IoSched;
+
+static IoSched sched;
+static atomic_bool sched_enabled;
+static pthread_mutex_t sched_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void sleep_ns(uint64_t ns) {
+#ifdef _WIN32
+    Sleep((DWORD)(ns / 1000000ULL));
+#else
+    struct timespec delay;
+    delay.tv_sec = (time_t)(ns / 1000000000ULL);
+    delay.tv_nsec = (long)(ns % 1000000000ULL);
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+#endif
+}
+
+/* A carga muda devagar: consultada no máximo uma vez por segundo. Devolve true ao entrar em recuo. */
+static bool refresh_load_locked(uint64_t now, double *load) {
+    if (sched.max_load <= 0.0 || now - sched.load_checked_ns < IO_LOAD_CHECK_NS) {
+        return false;
+    }
+    sched.load_checked_ns = now;
+#ifndef _WIN32
+    if (getloadavg(load, 1) == 1) {
+        double previous = sched.scale;
+        sched.scale = *load > sched.max_load ? sched.max_load / *load : 1.0;
+        if (sched.scale < IO_MIN_SCALE) {
+            sched.scale = IO_MIN_SCALE;
+        }
+        return previous >= 1.0 && sched.scale < 1.0;
+    }
+#endif
+    return false;
+}
+
+uint64_t io_bucket_charge(IoTokenBucket *bucket, double rate, double amount, uint64_t now_ns) {
+    double burst = rate * IO_BURST_SECONDS;
+    bucket->tokens += bucket->last_ns ? (double)(now_ns - bucket->last_ns) / 1e9 * rate : burst;
+    if (bucket->tokens > burst) {
+        bucket->tokens = burst;
+    }
+    bucket->last_ns = now_ns;
+    bucket->tokens -= amount;
+    return bucket->tokens < 0.0 ? (uint64_t)(-bucket->tokens / rate * 1e9) : 0;
+}
+
+/* Reserva amount tokens; com saldo negativo quem chega depois espera atrás, na ordem das reservas. */
+static void bucket_take(IoTokenBucket *bucket, double amount) {
+    uint64_t now = monotonic_ns();
+    uint64_t wait = 0;
+    double load = 0.0;
+    pthread_mutex_lock(&sched_lock);
+    bool backing_off = refresh_load_locked(now, &load);
+    double max_load = sched.max_load;
+    double rate = bucket->rate > 0.0 ? bucket->rate : (sched.scale < 1.0 ? bucket->fallback : 0.0);
+    rate *= sched.scale;
+    if (rate > 0.0) {
+        wait = io_bucket_charge(bucket, rate, amount, now);
+        sched.waited_ns += wait;
+    }
+    pthread_mutex_unlock(&sched_lock);
+    if (backing_off) {
+        log_warn("Carga %.2f acima de --max-load %.2f; reduzindo o ritmo de I/O", load, max_load);
+    }
+    if (wait > 0) {
+        sleep_ns(wait);
+    }
+}
+
+void io_sched_bytes(uint64_t bytes) {
+    if (atomic_load_explicit(&sched_enabled, memory_order_relaxed)) {
+        bucket_take(&sched.bytes, (double)bytes);
+    }
+}
+
+static void io_sched_op(void) {
+    if (atomic_load_explicit(&sched_enabled, memory_order_relaxed)) {
+        bucket_take(&sched.ops, 1.0);
+    }
+}
+
+void fs_op(ProfileFsCall call) {
+    io_sched_op();
+    profile_fs(call);
+}
+
+/* Classe idle: o disco só atende o dotmgr quando ninguém mais está pedindo. A prioridade anterior volta
+ * no io_sched_end, já que a lib pode estar embutida em outro processo. Threads criadas depois herdam. */
+static void enter_idle_class(void) {
+#ifdef IOPRIO_CLASS_IDLE
+    long previous = syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0);
+    if (previous >= 0 && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == 0) {
+        sched.saved_ioprio = (int)previous;
+        sched.ioprio_changed = true;
+    }
+#endif
+}
+
+void io_sched_begin(const AppOptions *opts) {
+    bool enabled = opts->io_rate > 0.0 || opts->iops > 0 || opts->max_load > 0.0;
+    pthread_mutex_lock(&sched_lock);
+    memset(&sched, 0, sizeof(sched));
+    sched.bytes.rate = opts->io_rate * 1024.0 * 1024.0;
+    sched.bytes.fallback = IO_BACKOFF_RATE;
+    sched.ops.rate = (double)opts->iops;
+    sched.ops.fallback = IO_BACKOFF_IOPS;
+    sched.max_load = opts->max_load;
+    sched.scale = 1.0;
+    if (enabled) {
+        enter_idle_class();
+    }
+    pthread_mutex_unlock(&sched_lock);
+    atomic_store(&sched_enabled, enabled);
+}
+
+void io_sched_end(const AppOptions *opts) {
+    if (!atomic_exchange(&sched_enabled, false)) {
+        return;
+    }
+    pthread_mutex_lock(&sched_lock);
+#ifdef IOPRIO_CLASS_IDLE
+    if (sched.ioprio_changed) {
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, sched.saved_ioprio);
+    }
+#endif
+    uint64_t waited = sched.waited_ns;
+    pthread_mutex_unlock(&sched_lock);
+    if (opts->verbose && waited > 0) {
+        log_info("Limites de I/O: %.2f s de espera acumulada", (double)waited / 1e9);
+    }
+}
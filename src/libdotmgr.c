@@ -0,0 +1,393 @@
+#include "libdotmgr.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backup_catalog.h"
+#include "checkpoint.h"
+#include "config_index.h"
+#include "config_parser.h"
+#include "fingerprint_cache.h"
+#include "git_helper.h"
+#include "io_sched.h"
+#include "link_gc.h"
+#include "metrics.h"
+#include "pipeline.h"
+#include "path_expand.h"
+#include "plan.h"
+#include "profile.h"
+#include "reconcile.h"
+#include "state_db.h"
+#include "target_lock.h"
+
+struct DotmgrContext {
+    AppOptions opts;
+    RootList roots;
+    DotfileConfig config;
+    bool loaded;
+    uint64_t loaded_key;
+    FileFingerprint config_fp;
+    bool config_fp_valid;
+    LogSink log_sink;
+    void *log_user;
+    RunProgress progress;
+    void *progress_user;
+};
+
+static pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Callbacks do usuário rodam com run_lock tomado, na thread principal ou em workers: marcados aqui, uma
+ * chamada de volta à API falha com EDEADLK em vez de travar no mutex. */
+static _Thread_local bool in_callback;
+
+bool dotmgr_options_init(AppOptions *opts) {
+    if (!opts) {
+        return false;
+    }
+    memset(opts, 0, sizeof(*opts));
+    if (!get_current_directory(opts->project_root, sizeof(opts->project_root))) {
+        log_error("Não foi possível obter diretório atual");
+        return false;
+    }
+    if (!get_machine_name(opts->machine_name, sizeof(opts->machine_name))) {
+        opts->machine_name[0] = '\0';
+    }
+    snprintf(opts->config_path, sizeof(opts->config_path), "configs/dotfiles.conf");
+    snprintf(opts->repo_path, sizeof(opts->repo_path), "dotfiles_repo");
+    opts->conflict_mode = CONFLICT_BACKUP;
+    snprintf(opts->git_message, sizeof(opts->git_message), "dotmgr sync");
+    opts->plan_command = CMD_INSTALL;
+    opts->root_failure_policy = ROOT_FAILURE_CONTINUE;
+    if (!get_state_directory(opts->state_dir, sizeof(opts->state_dir))) {
+        snprintf(opts->state_dir, sizeof(opts->state_dir), ".dotmgr-state");
+    }
+    return true;
+}
+
+DotmgrContext *dotmgr_open(const AppOptions *opts) {
+    DotmgrContext *ctx = calloc(1, sizeof(DotmgrContext));
+    if (!ctx) {
+        return NULL;
+    }
+    if (opts) {
+        ctx->opts = *opts;
+    } else if (!dotmgr_options_init(&ctx->opts)) {
+        free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void dotmgr_close(DotmgrContext *ctx) {
+    if (!ctx) {
+        return;
+    }
+    if (ctx->loaded) {
+        free_config(&ctx->config);
+    }
+    root_list_free(&ctx->roots);
+    free(ctx);
+}
+
+AppOptions *dotmgr_options(DotmgrContext *ctx) {
+    return ctx ? &ctx->opts : NULL;
+}
+
+RootList *dotmgr_roots(DotmgrContext *ctx) {
+    return ctx ? &ctx->roots : NULL;
+}
+
+void dotmgr_set_log(DotmgrContext *ctx, LogSink sink, void *user) {
+    ctx->log_sink = sink;
+    ctx->log_user = user;
+}
+
+void dotmgr_set_progress(DotmgrContext *ctx, RunProgress progress, void *user) {
+    ctx->progress = progress;
+    ctx->progress_user = user;
+}
+
+static void call_log(LogLevel level, const char *message, void *user) {
+    DotmgrContext *ctx = user;
+    bool outer = in_callback;
+    in_callback = true;
+    ctx->log_sink(level, message, ctx->log_user);
+    in_callback = outer;
+}
+
+static void call_progress(const DotfileEntry *entry, bool ok, void *user) {
+    DotmgrContext *ctx = user;
+    bool outer = in_callback;
+    in_callback = true;
+    ctx->progress(entry, ok, ctx->progress_user);
+    in_callback = outer;
+}
+
+static bool enter(DotmgrContext *ctx) {
+    if (in_callback) {
+        errno = EDEADLK;
+        return false;
+    }
+    pthread_mutex_lock(&run_lock);
+    log_set_sink(ctx->log_sink ? call_log : NULL, ctx);
+    runner_set_progress(ctx->progress ? call_progress : NULL, ctx);
+    return true;
+}
+
+static void leave(void) {
+    runner_set_progress(NULL, NULL);
+    log_set_sink(NULL, NULL);
+    pthread_mutex_unlock(&run_lock);
+}
+
+static uint64_t config_key(const AppOptions *opts) {
+    uint64_t hash = HASH_FNV1A64_SEED;
+    hash = hash_fnv1a64(opts->config_path, strlen(opts->config_path) + 1, hash);
+    hash = hash_fnv1a64(opts->repo_path, strlen(opts->repo_path) + 1, hash);
+    hash = hash_fnv1a64(opts->machine_name, strlen(opts->machine_name) + 1, hash);
+    return hash_fnv1a64(opts->project_root, strlen(opts->project_root) + 1, hash);
+}
+
+/* A config em cache continua válida enquanto as opções que a definem, o arquivo e as variáveis usadas
+ * na expansão não mudarem; sem stat do arquivo (ex.: config via symlink) recarrega sempre. */
+static bool loaded_config_fresh(DotmgrContext *ctx) {
+    if (ctx->loaded_key != config_key(&ctx->opts) || !ctx->config_fp_valid) {
+        return false;
+    }
+    FileFingerprint current;
+    if (!fingerprint_stat(ctx->opts.config_path, &current) || !fingerprint_same_stat(&current, &ctx->config_fp)) {
+        return false;
+    }
+    return !path_vars_stale(ctx->config.vars);
+}
+
+static bool ensure_loaded(DotmgrContext *ctx) {
+    if (ctx->loaded) {
+        if (loaded_config_fresh(ctx)) {
+            return true;
+        }
+        if (ctx->opts.verbose) {
+            log_info("Recarregando config: %s", ctx->opts.config_path);
+        }
+        free_config(&ctx->config);
+        ctx->loaded = false;
+    }
+    ctx->config_fp_valid = fingerprint_stat(ctx->opts.config_path, &ctx->config_fp);
+    ctx->loaded_key = config_key(&ctx->opts);
+    ctx->loaded = load_config(&ctx->opts, &ctx->config);
+    return ctx->loaded;
+}
+
+bool dotmgr_reload(DotmgrContext *ctx) {
+    if (!ctx) {
+        return false;
+    }
+    if (!enter(ctx)) {
+        return false;
+    }
+    if (ctx->loaded) {
+        free_config(&ctx->config);
+        ctx->loaded = false;
+    }
+    bool ok = ensure_loaded(ctx);
+    leave();
+    return ok;
+}
+
+const DotfileConfig *dotmgr_config(DotmgrContext *ctx) {
+    return ctx && ctx->loaded ? &ctx->config : NULL;
+}
+
+/* Sob o lock de estado: outra execução pode estar regravando os mesmos arquivos do state_dir. */
+static void flush_state(const AppOptions *opts) {
+    target_lock_state_begin(opts);
+    if (!backup_catalog_compact(opts) || !backup_catalog_flush(opts)) {
+        log_warn("Catálogo de backups não foi atualizado");
+    }
+    if (!fingerprint_cache_flush(opts)) {
+        log_warn("Cache de fingerprints não foi atualizado");
+    }
+    if (!state_db_flush(opts)) {
+        log_warn("Estado de instalação não foi atualizado");
+    }
+    target_lock_state_end();
+}
+
+static bool write_plan(const AppOptions *opts, const DotfileConfig *config) {
+    Plan plan;
+    /* Um plano parcial aplicado por um script deixaria o sistema pela metade: nada é escrito. */
+    if (!plan_build(opts, config, opts->plan_command, &plan)) {
+        log_error("Plano não gerado: há entradas que não puderam ser planejadas");
+        plan_free(&plan);
+        return false;
+    }
+    bool ok = true;
+    FILE *out = stdout;
+    if (opts->plan_path[0]) {
+        out = fopen(opts->plan_path, "w");
+        if (!out) {
+            log_error("Não foi possível abrir '%s' para escrita: %s", opts->plan_path, strerror(errno));
+            plan_free(&plan);
+            return false;
+        }
+    }
+    if (!plan_write(&plan, out)) {
+        ok = false;
+    }
+    if (out != stdout && fclose(out) != 0) {
+        ok = false;
+    }
+    if (opts->verbose) {
+        log_info("Plano com %zu operações", plan.count);
+    }
+    plan_free(&plan);
+    return ok;
+}
+
+static bool apply_plan_file(const AppOptions *opts) {
+    FILE *in = fopen(opts->plan_path, "r");
+    if (!in) {
+        log_error("Não foi possível abrir plano '%s': %s", opts->plan_path, strerror(errno));
+        return false;
+    }
+    Plan plan;
+    bool ok = plan_read(in, &plan);
+    fclose(in);
+    if (!ok) {
+        return false;
+    }
+    ok = plan_apply(opts, &plan);
+    plan_free(&plan);
+    return ok;
+}
+
+static bool run_loaded(const AppOptions *opts, const DotfileConfig *config, const RootList *roots,
+                       RunSummary *summary) {
+    if (opts->command == CMD_PLAN) {
+        return write_plan(opts, config);
+    }
+    if (opts->command == CMD_GC) {
+        return run_gc(opts, config, roots, summary);
+    }
+    if (roots->count == 0) {
+        return opts->command == CMD_RECONCILE ? run_reconcile(opts, config, summary) :
+               run_command(opts, config, summary);
+    }
+    if (opts->command == CMD_COLLECT || opts->command == CMD_RECONCILE) {
+        log_error("%s não suporta múltiplas raízes", opts->command == CMD_COLLECT ? "collect" : "reconcile");
+        return false;
+    }
+    if (opts->status_format != STATUS_FORMAT_TEXT) {
+        log_error("--format não suporta múltiplas raízes");
+        return false;
+    }
+    return run_multi_root(opts, config, roots);
+}
+
+static bool run_selected(DotmgrContext *ctx, RunSummary *summary) {
+    if (!config_has_filter(&ctx->opts)) {
+        return run_loaded(&ctx->opts, &ctx->config, &ctx->roots, summary);
+    }
+    DotfileConfig view;
+    if (!config_select(&ctx->opts, &ctx->config, &view, NULL)) {
+        return false;
+    }
+    bool ok = run_loaded(&ctx->opts, &view, &ctx->roots, summary);
+    config_view_free(&view);
+    return ok;
+}
+
+bool dotmgr_run(DotmgrContext *ctx, CommandType command, DotmgrResult *result) {
+    if (!ctx) {
+        return false;
+    }
+    if (command == CMD_BATCH) {
+        log_error("batch é um modo do CLI; chame dotmgr_run para cada comando");
+        return false;
+    }
+    if (!enter(ctx)) {
+        return false;
+    }
+    ctx->opts.command = command;
+    const AppOptions *opts = &ctx->opts;
+    profile_reset();
+    metrics_reset();
+    io_sched_begin(opts);
+    target_lock_begin(opts);
+    profile_record(!opts->dry_run);
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_MAIN);
+
+    bool ok;
+    RunSummary summary;
+    memset(&summary, 0, sizeof(summary));
+    if (command == CMD_APPLY) {
+        ok = apply_plan_file(opts);
+    } else if (opts->stream) {
+        ok = pipeline_supported(opts, ctx->roots.count > 0) && checkpoint_begin(opts);
+        if (ok) {
+            ok = run_pipeline(opts, &summary);
+            checkpoint_end(ok && summary.failed == 0);
+        }
+    } else if (ensure_loaded(ctx) && checkpoint_begin(opts)) {
+        ok = run_selected(ctx, &summary);
+        checkpoint_end(ok && summary.failed == 0);
+    } else {
+        ok = false;
+    }
+    target_lock_end(opts);
+    flush_state(opts);
+
+    if (ok && opts->git_auto) {
+        bool synced = git_auto_sync(opts);
+        metrics_git_sync(synced);
+        if (!synced) {
+            log_warn("Git auto-commit falhou");
+        }
+    }
+
+    io_sched_end(opts);
+    profile_end(&span);
+    target_lock_state_begin(opts);
+    metrics_record_run(opts, ok && summary.exit_code != 1);
+    target_lock_state_end();
+    if (opts->prom_path[0] && !metrics_write_prom(opts, opts->prom_path)) {
+        ok = false;
+    }
+    if (result) {
+        result->processed = summary.processed;
+        result->failed = summary.failed;
+        result->exit_code = ok ? summary.exit_code : EXIT_FAILURE;
+    }
+    leave();
+    return ok;
+}
+
+bool dotmgr_status(DotmgrContext *ctx, StatusReport *report) {
+    if (!ctx || !report) {
+        return false;
+    }
+    if (!enter(ctx)) {
+        return false;
+    }
+    ctx->opts.command = CMD_STATUS;
+    bool ok = ensure_loaded(ctx);
+    if (ok && config_has_filter(&ctx->opts)) {
+        DotfileConfig view;
+        size_t *origin = NULL;
+        ok = config_select(&ctx->opts, &ctx->config, &view, &origin) &&
+             status_report_build(&ctx->opts, &view, report);
+        for (size_t i = 0; ok && i < report->count; ++i) {
+            report->results[i].index = (uint32_t)origin[report->results[i].index];
+        }
+        free(origin);
+        config_view_free(&view);
+    } else if (ok) {
+        ok = status_report_build(&ctx->opts, &ctx->config, report);
+    }
+    flush_state(&ctx->opts);
+    leave();
+    return ok;
+}
@@ -0,0 +1,589 @@
+#define _DEFAULT_SOURCE
+
+#include "link_gc.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io_sched.h"
+#include "state_db.h"
+#include "strmap.h"
+#include "target_lock.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define GC_MAX_SKIP 64
+#define GC_DENTS_BUFFER (64 * 1024)
+
+/* Diretórios grandes que nunca guardam links do repositório; --skip-dir acrescenta outros. */
+static const char *default_skip[] = {"node_modules", ".cache", ".git", ".npm", ".cargo", ".rustup",
+                                     ".venv", "__pycache__", ".local/share/Trash", "snap"};
+
+typedef struct {
+    char *path;
+    char *destination;
+    bool broken;
+} GcLink;
+
+typedef struct {
+    char **items;
+    size_t count;
+    size_t capacity;
+} PathStack;
+
+typedef struct {
+    const AppOptions *opts;
+    const StrMap *managed;
+    char home[PATH_MAX];
+    char repo_real[PATH_MAX];
+    char repo_abs[PATH_MAX];
+    const char *skip[GC_MAX_SKIP];
+    size_t skip_count;
+    char skip_buffer[PATH_MAX];
+    const char *scan_root;
+    size_t scan_root_len;
+#ifndef _WIN32
+    dev_t device;
+    dev_t repo_device;
+    ino_t repo_inode;
+#endif
+    PathStack pending;
+    size_t active;
+    GcLink *links;
+    size_t link_count;
+    size_t link_capacity;
+    size_t directories;
+    bool failed;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} GcRun;
+
+static bool stack_push(PathStack *stack, char *path) {
+    if (stack->count == stack->capacity) {
+        size_t capacity = stack->capacity ? stack->capacity * 2 : 64;
+        char **grown = realloc(stack->items, capacity * sizeof(char *));
+        if (!grown) {
+            return false;
+        }
+        stack->items = grown;
+        stack->capacity = capacity;
+    }
+    stack->items[stack->count++] = path;
+    return true;
+}
+
+static void stack_free(PathStack *stack) {
+    for (size_t i = 0; i < stack->count; ++i) {
+        free(stack->items[i]);
+    }
+    free(stack->items);
+    memset(stack, 0, sizeof(*stack));
+}
+
+static char *path_child(const char *dir, const char *name) {
+    size_t dir_len = strlen(dir);
+    size_t name_len = strlen(name);
+    bool slash = dir_len > 0 && dir[dir_len - 1] == '/';
+    char *path = malloc(dir_len + name_len + 2);
+    if (path) {
+        memcpy(path, dir, dir_len);
+        if (!slash) {
+            path[dir_len++] = '/';
+        }
+        memcpy(path + dir_len, name, name_len + 1);
+    }
+    return path;
+}
+
+bool gc_clean_path(const char *path, char *output, size_t len) {
+    size_t used = 0;
+    const char *cursor = path;
+    while (*cursor) {
+        while (*cursor == '/') {
+            ++cursor;
+        }
+        const char *end = strchr(cursor, '/');
+        size_t part = end ? (size_t)(end - cursor) : strlen(cursor);
+        if (part == 0 || (part == 1 && cursor[0] == '.')) {
+            /* nada */
+        } else if (part == 2 && cursor[0] == '.' && cursor[1] == '.') {
+            while (used > 0 && output[used - 1] != '/') {
+                --used;
+            }
+            if (used > 0) {
+                --used;
+            }
+        } else {
+            if (used + part + 2 > len) {
+                return false;
+            }
+            output[used++] = '/';
+            memcpy(output + used, cursor, part);
+            used += part;
+        }
+        cursor += part;
+    }
+    if (used == 0) {
+        if (len < 2) {
+            return false;
+        }
+        output[used++] = '/';
+    }
+    output[used] = '\0';
+    return true;
+}
+
+static bool under_prefix(const char *path, const char *prefix) {
+    size_t len = strlen(prefix);
+    return len > 0 && strncmp(path, prefix, len) == 0 && (path[len] == '/' || path[len] == '\0');
+}
+
+static bool parse_skip_list(GcRun *run) {
+    for (size_t i = 0; i < sizeof(default_skip) / sizeof(default_skip[0]); ++i) {
+        run->skip[run->skip_count++] = default_skip[i];
+    }
+    snprintf(run->skip_buffer, sizeof(run->skip_buffer), "%s", run->opts->gc_skip);
+    char *save = NULL;
+    for (char *term = strtok_r(run->skip_buffer, ",", &save); term; term = strtok_r(NULL, ",", &save)) {
+        while (*term == '/') {
+            ++term;
+        }
+        size_t len = strlen(term);
+        while (len > 0 && term[len - 1] == '/') {
+            term[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+        if (run->skip_count == GC_MAX_SKIP) {
+            log_error("Muitos diretórios em --skip-dir");
+            return false;
+        }
+        run->skip[run->skip_count++] = term;
+    }
+    return true;
+}
+
+bool gc_skip_matches(const char *term, const char *relative, const char *name) {
+    return strchr(term, '/') ? strcmp(relative, term) == 0 : strcmp(name, term) == 0;
+}
+
+static bool skip_directory(const GcRun *run, const char *path, const char *name) {
+    const char *relative = path + run->scan_root_len;
+    while (*relative == '/') {
+        ++relative;
+    }
+    for (size_t i = 0; i < run->skip_count; ++i) {
+        if (gc_skip_matches(run->skip[i], relative, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* O caminho que a config usaria para este link: a raiz varrida corresponde ao HOME. */
+static bool managed_key(const GcRun *run, const char *path, char *output, size_t len) {
+    return snprintf(output, len, "%s%s", run->home, path + run->scan_root_len) < (int)len;
+}
+
+static void record_link(GcRun *run, const char *path, const char *destination, bool broken) {
+    GcLink link;
+    link.path = malloc(strlen(path) + 1);
+    link.destination = malloc(strlen(destination) + 1);
+    link.broken = broken;
+    pthread_mutex_lock(&run->lock);
+    bool ok = link.path && link.destination;
+    if (ok && run->link_count == run->link_capacity) {
+        size_t capacity = run->link_capacity ? run->link_capacity * 2 : 32;
+        GcLink *grown = realloc(run->links, capacity * sizeof(GcLink));
+        ok = grown != NULL;
+        if (ok) {
+            run->links = grown;
+            run->link_capacity = capacity;
+        }
+    }
+    if (ok) {
+        strcpy(link.path, path);
+        strcpy(link.destination, destination);
+        run->links[run->link_count++] = link;
+    } else {
+        run->failed = true;
+        free(link.path);
+        free(link.destination);
+    }
+    pthread_mutex_unlock(&run->lock);
+}
+
+#ifndef _WIN32
+static void mark_failed(GcRun *run) {
+    pthread_mutex_lock(&run->lock);
+    run->failed = true;
+    pthread_mutex_unlock(&run->lock);
+}
+
+/* Só links reais chegam aqui: um readlink, e um stat apenas para os que apontam para o repositório. */
+static void inspect_link(GcRun *run, int dir_fd, const char *dir, const char *name) {
+    char text[PATH_MAX];
+    fs_op(PROFILE_FS_READLINK);
+    ssize_t len = readlinkat(dir_fd, name, text, sizeof(text) - 1);
+    if (len < 0) {
+        return;
+    }
+    text[len] = '\0';
+    char joined[2 * PATH_MAX];
+    if (text[0] == '/') {
+        snprintf(joined, sizeof(joined), "%s", text);
+    } else {
+        snprintf(joined, sizeof(joined), "%s/%s", dir, text);
+    }
+    char destination[PATH_MAX];
+    if (!gc_clean_path(joined, destination, sizeof(destination)) ||
+        (!under_prefix(destination, run->repo_real) && !under_prefix(destination, run->repo_abs))) {
+        return;
+    }
+    char *path = path_child(dir, name);
+    if (!path) {
+        mark_failed(run);
+        return;
+    }
+    struct stat st;
+    fs_op(PROFILE_FS_STAT);
+    bool broken = fstatat(dir_fd, name, &st, 0) != 0;
+    char key[PATH_MAX];
+    size_t unused;
+    if (broken || !managed_key(run, path, key, sizeof(key)) || !strmap_get(run->managed, key, &unused)) {
+        record_link(run, path, destination, broken);
+    }
+    free(path);
+}
+
+static bool visit_entry(GcRun *run, int dir_fd, const char *dir, const char *name, unsigned char type,
+                        PathStack *children) {
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+        return true;
+    }
+    if (type == DT_UNKNOWN) {
+        struct stat st;
+        fs_op(PROFILE_FS_LSTAT);
+        if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            return true;
+        }
+        type = S_ISLNK(st.st_mode) ? DT_LNK : S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+    }
+    if (type == DT_LNK) {
+        inspect_link(run, dir_fd, dir, name);
+    } else if (type == DT_DIR) {
+        char *child = path_child(dir, name);
+        if (!child) {
+            return false;
+        }
+        if (skip_directory(run, child, name)) {
+            if (run->opts->verbose) {
+                log_info("Ignorando %s", child);
+            }
+            free(child);
+            return true;
+        }
+        if (!stack_push(children, child)) {
+            free(child);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* getdents64 devolve nome e d_type em lote, sem o stat por arquivo que o readdir+lstat custaria. */
+static bool scan_directory(GcRun *run, const char *dir, char *buffer, PathStack *children) {
+    fs_op(PROFILE_FS_OPENDIR);
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        if (run->opts->verbose) {
+            log_warn("Não foi possível abrir '%s': %s", dir, strerror(errno));
+        }
+        return true;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_dev != run->device ||
+        (st.st_dev == run->repo_device && st.st_ino == run->repo_inode)) {
+        close(fd);
+        return true;
+    }
+    bool ok = true;
+#ifdef __linux__
+    for (;;) {
+        long got = syscall(SYS_getdents64, fd, buffer, GC_DENTS_BUFFER);
+        if (got <= 0) {
+            break;
+        }
+        for (long offset = 0; ok && offset < got;) {
+            struct dirent64_record {
+                uint64_t d_ino;
+                int64_t d_off;
+                unsigned short d_reclen;
+                unsigned char d_type;
+                char d_name[];
+            } *entry = (struct dirent64_record *)(buffer + offset);
+            ok = visit_entry(run, fd, dir, entry->d_name, entry->d_type, children);
+            offset += entry->d_reclen;
+        }
+    }
+    close(fd);
+#else
+    (void)buffer;
+    DIR *handle = fdopendir(fd);
+    if (!handle) {
+        close(fd);
+        return true;
+    }
+    struct dirent *entry;
+    while (ok && (entry = readdir(handle)) != NULL) {
+        ok = visit_entry(run, fd, dir, entry->d_name, entry->d_type, children);
+    }
+    closedir(handle);
+#endif
+    return ok;
+}
+
+static void *gc_worker(void *arg) {
+    GcRun *run = arg;
+    char *buffer = malloc(GC_DENTS_BUFFER);
+    PathStack children;
+    memset(&children, 0, sizeof(children));
+    pthread_mutex_lock(&run->lock);
+    if (!buffer) {
+        run->failed = true;
+    }
+    for (;;) {
+        while (run->pending.count == 0 && run->active > 0) {
+            pthread_cond_wait(&run->ready, &run->lock);
+        }
+        if (run->pending.count == 0 || !buffer) {
+            break;
+        }
+        char *dir = run->pending.items[--run->pending.count];
+        ++run->active;
+        ++run->directories;
+        pthread_mutex_unlock(&run->lock);
+
+        bool ok = scan_directory(run, dir, buffer, &children);
+        free(dir);
+
+        pthread_mutex_lock(&run->lock);
+        for (size_t i = 0; i < children.count; ++i) {
+            if (!stack_push(&run->pending, children.items[i])) {
+                free(children.items[i]);
+                ok = false;
+            }
+        }
+        children.count = 0;
+        if (!ok) {
+            run->failed = true;
+        }
+        --run->active;
+        pthread_cond_broadcast(&run->ready);
+    }
+    pthread_cond_broadcast(&run->ready);
+    pthread_mutex_unlock(&run->lock);
+    stack_free(&children);
+    free(buffer);
+    return NULL;
+}
+
+static bool walk_root(GcRun *run, const char *root, int jobs) {
+    struct stat st;
+    fs_op(PROFILE_FS_STAT);
+    if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        log_error("Diretório inexistente para o gc: %s", root);
+        return false;
+    }
+    run->device = st.st_dev;
+    run->scan_root = root;
+    run->scan_root_len = strlen(root);
+    char *start = malloc(run->scan_root_len + 1);
+    if (!start || !stack_push(&run->pending, start)) {
+        free(start);
+        return false;
+    }
+    strcpy(start, root);
+    pthread_t *threads = calloc((size_t)jobs, sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; threads && i < jobs; ++i, ++started) {
+        if (pthread_create(&threads[i], NULL, gc_worker, run) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        gc_worker(run);
+    }
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    stack_free(&run->pending);
+    return !run->failed;
+}
+
+static int compare_links(const void *a, const void *b) {
+    return strcmp(((const GcLink *)a)->path, ((const GcLink *)b)->path);
+}
+
+/* Resolve o link de novo como inspect_link fez na varredura. */
+static bool still_points_to(const GcLink *link) {
+    char text[PATH_MAX];
+    if (!read_symlink_target(link->path, text, sizeof(text))) {
+        return false;
+    }
+    char joined[2 * PATH_MAX];
+    if (text[0] == '/') {
+        snprintf(joined, sizeof(joined), "%s", text);
+    } else {
+        const char *slash = strrchr(link->path, '/');
+        int dir_len = slash ? (int)(slash - link->path) : 0;
+        snprintf(joined, sizeof(joined), "%.*s/%s", dir_len, link->path, text);
+    }
+    char destination[PATH_MAX];
+    return gc_clean_path(joined, destination, sizeof(destination)) && strcmp(destination, link->destination) == 0;
+}
+
+/* Sob o lock do destino; o link é conferido de novo porque outra execução pode tê-lo trocado desde a varredura. */
+static bool remove_link(const AppOptions *opts, const GcLink *link) {
+    if (opts->dry_run) {
+        log_info("[dry-run] unlink %s", link->path);
+        return true;
+    }
+    TargetLock lock;
+    target_lock_acquire(opts, link->path, &lock);
+    bool ok = true;
+    if (!still_points_to(link)) {
+        log_warn("%s mudou desde a varredura, mantido", link->path);
+    } else {
+        fs_op(PROFILE_FS_UNLINK);
+        if (unlink(link->path) == 0) {
+            log_info("Removido: %s", link->path);
+            state_db_forget(opts, link->path);
+        } else {
+            log_error("Falha ao remover symlink '%s': %s", link->path, strerror(errno));
+            ok = false;
+        }
+    }
+    target_lock_release(&lock);
+    return ok;
+}
+
+static bool scan_path(const GcRun *run, const RootSpec *root, char *output, size_t len) {
+    if (!root) {
+        return snprintf(output, len, "%s", run->home) < (int)len;
+    }
+    if (root->kind == ROOT_HOME) {
+        return snprintf(output, len, "%s", root->path) < (int)len;
+    }
+    const char *prefix = strcmp(root->path, "/") == 0 ? "" : root->path;
+    return snprintf(output, len, "%s%s", prefix, run->home) < (int)len;
+}
+#endif
+
+bool run_gc(const AppOptions *opts, const DotfileConfig *config, const RootList *roots, RunSummary *summary) {
+#ifdef _WIN32
+    (void)opts;
+    (void)config;
+    (void)roots;
+    (void)summary;
+    log_error("gc não é suportado no Windows");
+    return false;
+#else
+    GcRun *run = calloc(1, sizeof(GcRun));
+    StrMap managed;
+    if (!run || !strmap_init(&managed, config->count)) {
+        free(run);
+        return false;
+    }
+    run->opts = opts;
+    run->managed = &managed;
+    pthread_mutex_init(&run->lock, NULL);
+    pthread_cond_init(&run->ready, NULL);
+    bool ok = parse_skip_list(run);
+    for (size_t i = 0; ok && i < config->count; ++i) {
+        ok = strmap_put(&managed, config->entries[i].target_path, i);
+    }
+    const char *home = getenv("HOME");
+    char cwd[PATH_MAX];
+    char joined[2 * PATH_MAX];
+    struct stat repo_st;
+    if (ok && (!home || !normalize_path(home, run->home, sizeof(run->home)))) {
+        log_error("HOME indefinido ou inacessível");
+        ok = false;
+    }
+    if (ok && (!normalize_path(opts->repo_path, run->repo_real, sizeof(run->repo_real)) ||
+               stat(run->repo_real, &repo_st) != 0)) {
+        log_error("Repositório inacessível: %s", opts->repo_path);
+        ok = false;
+    }
+    if (ok) {
+        run->repo_device = repo_st.st_dev;
+        run->repo_inode = repo_st.st_ino;
+        if (opts->repo_path[0] == '/' || !get_current_directory(cwd, sizeof(cwd))) {
+            snprintf(joined, sizeof(joined), "%s", opts->repo_path);
+        } else {
+            snprintf(joined, sizeof(joined), "%s/%s", cwd, opts->repo_path);
+        }
+        if (!gc_clean_path(joined, run->repo_abs, sizeof(run->repo_abs))) {
+            snprintf(run->repo_abs, sizeof(run->repo_abs), "%s", run->repo_real);
+        }
+    }
+
+    int jobs = opts->jobs > 0 ? opts->jobs : default_job_count();
+    uint64_t start = monotonic_ns();
+    size_t root_count = roots->count ? roots->count : 1;
+    for (size_t i = 0; ok && i < root_count; ++i) {
+        char root[PATH_MAX];
+        if (!scan_path(run, roots->count ? &roots->items[i] : NULL, root, sizeof(root))) {
+            log_error("Caminho muito longo para o gc");
+            ok = false;
+            break;
+        }
+        size_t before = run->link_count;
+        ok = walk_root(run, root, jobs);
+        if (opts->verbose) {
+            log_info("%s: %zu links órfãos", root, run->link_count - before);
+        }
+    }
+
+    qsort(run->links, run->link_count, sizeof(GcLink), compare_links);
+    size_t broken = 0;
+    for (size_t i = 0; i < run->link_count; ++i) {
+        const GcLink *link = &run->links[i];
+        broken += link->broken;
+        log_warn("[%s] %s -> %s", link->broken ? "BROKEN" : "UNMANAGED", link->path, link->destination);
+        ++summary->processed;
+        if (opts->gc_delete && !remove_link(opts, link)) {
+            ++summary->failed;
+            ok = false;
+        }
+        free(link->path);
+        free(link->destination);
+    }
+    log_info("gc: %zu diretórios em %.2fs, %zu links quebrados e %zu fora da config%s",
+             run->directories, (double)(monotonic_ns() - start) / 1e9, broken, run->link_count - broken,
+             run->link_count && !opts->gc_delete ? " (use --delete para remover)" : "");
+
+    free(run->links);
+    pthread_cond_destroy(&run->ready);
+    pthread_mutex_destroy(&run->lock);
+    free(run);
+    strmap_free(&managed);
+    return ok;
+#endif
+}
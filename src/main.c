@@ -1,13 +1,21 @@
-#include "collect.h"
-#include "config_parser.h"
-#include "git_helper.h"
-#include "symlink_engine.h"
-#include "utils.h"
+#define _DEFAULT_SOURCE
 
+#include "libdotmgr.h"
+#include "metrics.h"
+#include "profile.h"
+#include "trace.h"
+
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
 static void print_usage(const char *prog) {
     printf("Uso: %s <comando> [opções]\n", prog);
     printf("Comandos:\n");
@@ -15,33 +23,51 @@ static void print_usage(const char *prog) {
     printf("  uninstall   Remover symlinks criados\n");
     printf("  status      Mostrar situação dos symlinks\n");
     printf("  collect     Copiar arquivos do sistema para o repositório antes de linkar\n");
+    printf("  plan [cmd]  Gerar plano serializado de operações (install|uninstall|collect)\n");
+    printf("  apply <arq> Executar um plano gerado por 'plan' após validar pré-condições\n");
+    printf("  batch       Ler um comando por linha de stdin (opções da linha de comando viram defaults)\n");
+    printf("  reconcile   Instalar só o que mudou desde a última execução e remover o que saiu da config\n");
+    printf("  gc          Procurar no HOME links para o repositório quebrados ou fora da config\n");
     printf("Opções:\n");
     printf("  --config <arquivo>   Caminho para arquivo de configuração (default configs/dotfiles.conf)\n");
     printf("  --repo <dir>         Diretório raiz do repositório de dotfiles (default dotfiles_repo)\n");
     printf("  --machine <nome>     Força uso de configuração específica da máquina\n");
-    printf("  --mode <backup|force|interactive>  Estratégia de conflito (default backup)\n");
+    printf("  --mode <backup|force|interactive|batch>  Estratégia de conflito (default backup)\n");
     printf("  --dry-run            Apenas simula operações\n");
     printf("  --verbose            Saída detalhada\n");
     printf("  --git-auto           Executa git add/commit após operações\n");
     printf("  --git-message <msg>  Mensagem para git commit (com --git-auto)\n");
+    printf("  --output <arquivo>   Destino do plano gerado por 'plan' (default stdout)\n");
+    printf("  --jobs <n>           Operações independentes em paralelo no 'apply'\n");
+    printf("  --state-dir <dir>    Diretório de estado local (default $XDG_STATE_HOME/dotmgr)\n");
+    printf("  --restore            No uninstall, restaura os backups catalogados\n");
+    printf("  --stream             Executa as entradas enquanto a config é lida, sem carregá-la inteira\n");
+    printf("  --resume             No install/collect, pula o que uma execução interrompida já concluiu\n");
+    printf("  --root <dir>         Aplica a config sob outra raiz (repetível, ex.: rootfs de container)\n");
+    printf("  --home-list <arq>    Aplica a config em cada HOME listado no arquivo (um por linha)\n");
+    printf("  --on-root-failure <continue|abort>  Política de isolamento entre raízes (default continue)\n");
+    printf("  --profile            Mostra tempo por fase, chamadas ao sistema de arquivos e entradas mais lentas\n");
+    printf("  --trace <arquivo>    Grava spans por entrada em JSON trace-event (Chrome/Perfetto)\n");
+    printf("  --only <tag|destino>     Só entradas com a tag ou sob o prefixo de destino (repetível, vírgulas)\n");
+    printf("  --except <tag|destino>   Ignora entradas com a tag ou sob o prefixo de destino\n");
+    printf("  --max-size <n[K|M|G]>  Ao copiar diretórios (collect), pula arquivos maiores que isso\n");
+    printf("  --io-rate <MB/s>     Limita os bytes copiados por segundo (collect, copy)\n");
+    printf("  --iops <n>           Limita as chamadas ao sistema de arquivos por segundo\n");
+    printf("  --max-load <carga>   Acima dessa carga média (1 min), reduz o ritmo de I/O proporcionalmente\n");
+    printf("  --skip-dir <nome>    No 'gc', não desce em diretórios com esse nome ou caminho relativo (repetível)\n");
+    printf("  --delete             No 'gc', remove os links encontrados\n");
+    printf("  --prom <arquivo>     No 'status', grava métricas Prometheus (textfile collector) de forma atômica\n");
+    printf("  --format <text|json|tsv>  Saída do 'status' (json/tsv em stdout, código de saída = pior estado)\n");
 }
 
+static const char *command_names[] = {"install", "uninstall", "status", "collect", "plan", "apply", "batch", "reconcile", "gc"};
+
 static bool parse_command(const char *value, CommandType *cmd) {
-    if (strcmp(value, "install") == 0) {
-        *cmd = CMD_INSTALL;
-        return true;
-    }
-    if (strcmp(value, "uninstall") == 0) {
-        *cmd = CMD_UNINSTALL;
-        return true;
-    }
-    if (strcmp(value, "status") == 0) {
-        *cmd = CMD_STATUS;
-        return true;
-    }
-    if (strcmp(value, "collect") == 0) {
-        *cmd = CMD_COLLECT;
-        return true;
+    for (size_t i = 0; i < sizeof(command_names) / sizeof(command_names[0]); ++i) {
+        if (strcmp(value, command_names[i]) == 0) {
+            *cmd = (CommandType)i;
+            return true;
+        }
     }
     return false;
 }
@@ -59,37 +85,101 @@ static bool parse_mode(const char *value, ConflictMode *mode) {
         *mode = CONFLICT_INTERACTIVE;
         return true;
     }
+    if (strcmp(value, "batch") == 0) {
+        *mode = CONFLICT_BATCH;
+        return true;
+    }
     return false;
 }
 
-static bool parse_arguments(int argc, char **argv, AppOptions *opts) {
-    if (argc < 2) {
-        print_usage(argv[0]);
+static bool parse_status_format(const char *value, StatusFormat *format) {
+    if (strcmp(value, "text") == 0) {
+        *format = STATUS_FORMAT_TEXT;
+        return true;
+    }
+    if (strcmp(value, "json") == 0) {
+        *format = STATUS_FORMAT_JSON;
+        return true;
+    }
+    if (strcmp(value, "tsv") == 0) {
+        *format = STATUS_FORMAT_TSV;
+        return true;
+    }
+    return false;
+}
+
+/* Bytes com sufixo opcional K, M ou G (potências de 1024). */
+static bool parse_size(const char *value, long long *size) {
+    char *end = NULL;
+    errno = 0;
+    long long parsed = strtoll(value, &end, 10);
+    if (errno != 0 || end == value || parsed <= 0) {
         return false;
     }
-    if (!parse_command(argv[1], &opts->command)) {
-        log_error("Comando desconhecido: %s", argv[1]);
-        print_usage(argv[0]);
+    int shift = 0;
+    if (*end == 'K' || *end == 'k') {
+        shift = 10;
+    } else if (*end == 'M' || *end == 'm') {
+        shift = 20;
+    } else if (*end == 'G' || *end == 'g') {
+        shift = 30;
+    }
+    if (shift && *++end == 'B') {
+        ++end;
+    }
+    if (*end != '\0' || parsed > (LLONG_MAX >> shift)) {
         return false;
     }
-    // Defaults
-    if (!get_current_directory(opts->project_root, sizeof(opts->project_root))) {
-        log_error("Não foi possível obter diretório atual");
+    *size = parsed << shift;
+    return true;
+}
+
+static bool parse_positive(const char *value, double *result) {
+    char *end = NULL;
+    errno = 0;
+    double parsed = strtod(value, &end);
+    if (errno != 0 || end == value || *end != '\0' || !(parsed > 0.0)) {
         return false;
     }
-    if (!get_machine_name(opts->machine_name, sizeof(opts->machine_name))) {
-        opts->machine_name[0] = '\0';
+    *result = parsed;
+    return true;
+}
+
+static bool append_filter(char *filter, const char *value) {
+    size_t used = strlen(filter);
+    int written = snprintf(filter + used, PATH_MAX - used, used ? ",%s" : "%s", value);
+    return written >= 0 && (size_t)written < PATH_MAX - used;
+}
+
+/* argv[0] é o comando; prog é NULL nas linhas do batch (sem texto de uso a cada erro). */
+static bool parse_invocation(int argc, char **argv, const char *prog, AppOptions *opts, RootList *roots) {
+    if (!parse_command(argv[0], &opts->command)) {
+        log_error("Comando desconhecido: %s", argv[0]);
+        if (prog) {
+            print_usage(prog);
+        }
+        return false;
+    }
+
+    int first_option = 1;
+    if (opts->command == CMD_PLAN && argc > 1 && strncmp(argv[1], "--", 2) != 0) {
+        if (!parse_command(argv[1], &opts->plan_command) ||
+            opts->plan_command == CMD_STATUS || opts->plan_command >= CMD_PLAN) {
+            log_error("Comando inválido para plan: %s", argv[1]);
+            return false;
+        }
+        first_option = 2;
+    }
+    if (opts->command == CMD_APPLY) {
+        if (argc < 2 || strncmp(argv[1], "--", 2) == 0) {
+            log_error("apply requer o caminho de um plano");
+            return false;
+        }
+        snprintf(opts->plan_path, sizeof(opts->plan_path), "%s", argv[1]);
+        first_option = 2;
     }
-    snprintf(opts->config_path, sizeof(opts->config_path), "configs/dotfiles.conf");
-    snprintf(opts->repo_path, sizeof(opts->repo_path), "dotfiles_repo");
-    opts->conflict_mode = CONFLICT_BACKUP;
-    opts->dry_run = false;
-    opts->verbose = false;
-    opts->git_auto = false;
-    snprintf(opts->git_message, sizeof(opts->git_message), "dotmgr sync");
-    opts->config_explicit = false;
 
-    for (int i = 2; i < argc; ++i) {
+    for (int i = first_option; i < argc; ++i) {
         const char *arg = argv[i];
         if (strcmp(arg, "--config") == 0) {
             if (i + 1 >= argc) {
@@ -148,8 +238,207 @@ static bool parse_arguments(int argc, char **argv, AppOptions *opts) {
             snprintf(opts->git_message, sizeof(opts->git_message), "%s", argv[++i]);
             continue;
         }
+        if (strcmp(arg, "--state-dir") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--state-dir requer um valor");
+                return false;
+            }
+            snprintf(opts->state_dir, sizeof(opts->state_dir), "%s", argv[++i]);
+            continue;
+        }
+        if (strcmp(arg, "--profile") == 0) {
+            opts->profile = true;
+            continue;
+        }
+        if (strcmp(arg, "--trace") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--trace requer um arquivo");
+                return false;
+            }
+            snprintf(opts->trace_path, sizeof(opts->trace_path), "%s", argv[++i]);
+            continue;
+        }
+        if (strcmp(arg, "--format") == 0 || strncmp(arg, "--format=", 9) == 0) {
+            const char *format = arg[8] == '=' ? arg + 9 : NULL;
+            if (!format) {
+                if (i + 1 >= argc) {
+                    log_error("--format requer um valor");
+                    return false;
+                }
+                format = argv[++i];
+            }
+            if (!parse_status_format(format, &opts->status_format)) {
+                log_error("Formato inválido: %s", format);
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--prom") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--prom requer um arquivo");
+                return false;
+            }
+            snprintf(opts->prom_path, sizeof(opts->prom_path), "%s", argv[++i]);
+            continue;
+        }
+        if (strcmp(arg, "--only") == 0 || strcmp(arg, "--except") == 0) {
+            if (i + 1 >= argc) {
+                log_error("%s requer um valor", arg);
+                return false;
+            }
+            if (!append_filter(arg[2] == 'o' ? opts->only_filter : opts->except_filter, argv[++i])) {
+                log_error("Filtro muito longo: %s", argv[i]);
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--skip-dir") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--skip-dir requer um valor");
+                return false;
+            }
+            if (!append_filter(opts->gc_skip, argv[++i])) {
+                log_error("Lista de --skip-dir muito longa: %s", argv[i]);
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--max-size") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--max-size requer um valor");
+                return false;
+            }
+            if (!parse_size(argv[++i], &opts->collect_max_size)) {
+                log_error("Tamanho inválido: %s", argv[i]);
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--io-rate") == 0 || strcmp(arg, "--max-load") == 0) {
+            if (i + 1 >= argc) {
+                log_error("%s requer um valor", arg);
+                return false;
+            }
+            if (!parse_positive(argv[++i], strcmp(arg, "--io-rate") == 0 ? &opts->io_rate : &opts->max_load)) {
+                log_error("Valor inválido para %s: %s", arg, argv[i]);
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--iops") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--iops requer um valor");
+                return false;
+            }
+            opts->iops = atoi(argv[++i]);
+            if (opts->iops < 1) {
+                log_error("--iops deve ser maior que zero");
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--delete") == 0) {
+            opts->gc_delete = true;
+            continue;
+        }
+        if (strcmp(arg, "--stream") == 0) {
+            opts->stream = true;
+            continue;
+        }
+        if (strcmp(arg, "--resume") == 0) {
+            opts->resume = true;
+            continue;
+        }
+        if (strcmp(arg, "--restore") == 0) {
+            opts->restore_backups = true;
+            continue;
+        }
+        if (strcmp(arg, "--root") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--root requer um valor");
+                return false;
+            }
+            if (!root_list_add(roots, argv[++i], ROOT_PREFIX)) {
+                log_error("Raiz inválida: %s", argv[i]);
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--home-list") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--home-list requer um valor");
+                return false;
+            }
+            if (!root_list_load(roots, argv[++i])) {
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--on-root-failure") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--on-root-failure requer um valor");
+                return false;
+            }
+            const char *policy = argv[++i];
+            if (strcmp(policy, "continue") == 0) {
+                opts->root_failure_policy = ROOT_FAILURE_CONTINUE;
+            } else if (strcmp(policy, "abort") == 0) {
+                opts->root_failure_policy = ROOT_FAILURE_ABORT;
+            } else {
+                log_error("Política inválida: %s", policy);
+                return false;
+            }
+            continue;
+        }
+        if (strcmp(arg, "--output") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--output requer um valor");
+                return false;
+            }
+            snprintf(opts->plan_path, sizeof(opts->plan_path), "%s", argv[++i]);
+            continue;
+        }
+        if (strcmp(arg, "--jobs") == 0) {
+            if (i + 1 >= argc) {
+                log_error("--jobs requer um valor");
+                return false;
+            }
+            opts->jobs = atoi(argv[++i]);
+            if (opts->jobs < 1) {
+                log_error("--jobs deve ser maior que zero");
+                return false;
+            }
+            continue;
+        }
         log_error("Opção desconhecida: %s", arg);
-        print_usage(argv[0]);
+        if (prog) {
+            print_usage(prog);
+        }
+        return false;
+    }
+
+    if ((opts->only_filter[0] || opts->except_filter[0]) && opts->command == CMD_APPLY) {
+        log_error("--only/--except valem no 'plan', não no 'apply'");
+        return false;
+    }
+
+    if ((opts->only_filter[0] || opts->except_filter[0]) && opts->command == CMD_GC) {
+        log_error("--only/--except não valem no 'gc': links das entradas excluídas pareceriam órfãos");
+        return false;
+    }
+
+    if ((opts->gc_skip[0] || opts->gc_delete) && opts->command != CMD_GC) {
+        log_error("--skip-dir e --delete só podem ser usados com 'gc'");
+        return false;
+    }
+
+    if (opts->resume && opts->command != CMD_INSTALL && opts->command != CMD_COLLECT) {
+        log_error("--resume só pode ser usado com 'install' ou 'collect'");
+        return false;
+    }
+
+    if (opts->prom_path[0] && opts->command != CMD_STATUS) {
+        log_error("--prom só pode ser usado com 'status'");
         return false;
     }
 
@@ -165,58 +454,360 @@ static bool parse_arguments(int argc, char **argv, AppOptions *opts) {
     return true;
 }
 
-static bool run_command(const AppOptions *opts, const DotfileConfig *config) {
-    bool success = true;
-    for (size_t i = 0; i < config->count; ++i) {
-        const DotfileEntry *entry = &config->entries[i];
-        bool result = false;
-        switch (opts->command) {
-            case CMD_INSTALL:
-                result = install_entry(opts, entry);
-                break;
-            case CMD_UNINSTALL:
-                result = uninstall_entry(opts, entry);
-                break;
-            case CMD_STATUS:
-                result = status_entry(opts, entry);
-                break;
-            case CMD_COLLECT:
-                result = collect_entry(opts, entry);
-                break;
-            default:
-                result = false;
-                break;
+
+static bool parse_arguments(int argc, char **argv, AppOptions *opts, RootList *roots) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return false;
+    }
+    if (!dotmgr_options_init(opts)) {
+        return false;
+    }
+    return parse_invocation(argc - 1, argv + 1, argv[0], opts, roots);
+}
+
+#define BATCH_LINE_MAX (4 * PATH_MAX)
+#define BATCH_MAX_ARGS 64
+#define BATCH_MAX_CONTEXTS 8
+
+typedef struct {
+    DotmgrContext *ctx;
+    unsigned long last_used;
+} BatchSlot;
+
+/* Separa a linha em argumentos no próprio buffer; aspas simples ou duplas agrupam espaços. */
+static int split_line(char *line, char **argv, int max) {
+    int argc = 0;
+    char *in = line;
+    while (*in) {
+        while (*in == ' ' || *in == '\t') {
+            ++in;
+        }
+        if (!*in) {
+            break;
         }
-        if (!result) {
-            success = false;
-            if (!opts->verbose) {
-                log_error("Falha ao processar entrada %zu", i + 1);
+        if (argc == max) {
+            return -1;
+        }
+        char *out = in;
+        argv[argc++] = out;
+        char quote = '\0';
+        while (*in && (quote || (*in != ' ' && *in != '\t'))) {
+            if (quote && *in == quote) {
+                quote = '\0';
+            } else if (!quote && (*in == '"' || *in == '\'')) {
+                quote = *in;
+            } else {
+                *out++ = *in;
             }
+            ++in;
+        }
+        if (quote) {
+            return -1;
         }
+        if (*in) {
+            ++in;
+        }
+        *out = '\0';
     }
-    return success;
+    return argc;
 }
 
+static bool same_config_source(const AppOptions *a, const AppOptions *b) {
+    return strcmp(a->config_path, b->config_path) == 0 && strcmp(a->repo_path, b->repo_path) == 0 &&
+           strcmp(a->machine_name, b->machine_name) == 0;
+}
+
+/* Um contexto por config/repo/máquina mantém a config parseada entre linhas; o menos usado sai. */
+static DotmgrContext *batch_context(BatchSlot *slots, const AppOptions *opts, unsigned long seq) {
+    BatchSlot *victim = &slots[0];
+    for (size_t i = 0; i < BATCH_MAX_CONTEXTS; ++i) {
+        BatchSlot *slot = &slots[i];
+        if (slot->ctx && same_config_source(dotmgr_options(slot->ctx), opts)) {
+            slot->last_used = seq;
+            return slot->ctx;
+        }
+        if (victim->ctx && (!slot->ctx || slot->last_used < victim->last_used)) {
+            victim = slot;
+        }
+    }
+    dotmgr_close(victim->ctx);
+    victim->ctx = dotmgr_open(opts);
+    victim->last_used = seq;
+    return victim->ctx;
+}
+
+static bool batch_line_options(const AppOptions *base, char *line, AppOptions *opts, RootList *roots) {
+    char *argv[BATCH_MAX_ARGS];
+    int argc = split_line(line, argv, BATCH_MAX_ARGS);
+    if (argc <= 0) {
+        log_error("Linha inválida (aspas sem fechar ou argumentos demais)");
+        return false;
+    }
+    *opts = *base;
+    if (!parse_invocation(argc, argv, NULL, opts, roots)) {
+        return false;
+    }
+    if (opts->command == CMD_BATCH) {
+        log_error("batch não pode ser aninhado");
+        return false;
+    }
+    if (opts->conflict_mode == CONFLICT_INTERACTIVE || opts->conflict_mode == CONFLICT_BATCH) {
+        log_error("--mode %s lê stdin e não pode ser usado no batch",
+                  opts->conflict_mode == CONFLICT_BATCH ? "batch" : "interactive");
+        return false;
+    }
+    if (opts->profile != base->profile || strcmp(opts->trace_path, base->trace_path) != 0) {
+        log_error("--profile e --trace valem para o batch inteiro; passe-os em 'dotmgr batch'");
+        return false;
+    }
+    return true;
+}
+
+/* Lê um comando por linha de stdin e escreve uma linha JSON de resultado por comando, na ordem. */
+static int run_batch(const AppOptions *base) {
+    BatchSlot slots[BATCH_MAX_CONTEXTS];
+    memset(slots, 0, sizeof(slots));
+    char line[BATCH_LINE_MAX];
+    unsigned long number = 0;
+    int exit_code = EXIT_SUCCESS;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        ++number;
+        size_t len = strlen(line);
+        bool truncated = len == sizeof(line) - 1 && line[len - 1] != '\n';
+        if (truncated) {
+            int c;
+            while ((c = getchar()) != EOF && c != '\n') {
+            }
+        }
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        const char *start = line + strspn(line, " \t");
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+
+        uint64_t started = monotonic_ns();
+        AppOptions opts;
+        RootList roots;
+        memset(&roots, 0, sizeof(roots));
+        DotmgrResult result;
+        memset(&result, 0, sizeof(result));
+        result.exit_code = EXIT_FAILURE;
+        DotmgrContext *ctx = NULL;
+        bool parsed = false;
+        if (truncated) {
+            log_error("Linha %lu maior que %d bytes", number, BATCH_LINE_MAX - 1);
+        } else {
+            parsed = batch_line_options(base, line, &opts, &roots);
+        }
+        if (parsed) {
+            ctx = batch_context(slots, &opts, number);
+            if (!ctx) {
+                log_error("Memória insuficiente");
+            }
+        }
+        if (ctx) {
+            *dotmgr_options(ctx) = opts;
+            root_list_free(dotmgr_roots(ctx));
+            *dotmgr_roots(ctx) = roots;
+            dotmgr_run(ctx, opts.command, &result);
+            profile_report(stderr);
+        } else {
+            root_list_free(&roots);
+        }
+
+        if (result.exit_code != EXIT_SUCCESS) {
+            exit_code = EXIT_FAILURE;
+        }
+        printf("{\"line\":%lu,\"command\":", number);
+        if (parsed) {
+            printf("\"%s\"", command_names[opts.command]);
+        } else {
+            printf("null");
+        }
+        printf(",\"exit_code\":%d,\"processed\":%zu,\"failed\":%zu,\"duration_ns\":%llu}\n",
+               result.exit_code, result.processed, result.failed,
+               (unsigned long long)(monotonic_ns() - started));
+        fflush(stdout);
+    }
+
+    for (size_t i = 0; i < BATCH_MAX_CONTEXTS; ++i) {
+        dotmgr_close(slots[i].ctx);
+    }
+    return exit_code;
+}
+
+
+#ifndef _WIN32
+#define PROGRESS_TICK_NS 200000000L
+
+/* Linha de progresso em stderr quando é um terminal. Mensagens de log apagam a linha, saem como de
+ * costume e a linha volta por baixo; uma thread a redesenha a cada PROGRESS_TICK_NS. */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t ticker;
+    bool ticking;
+    bool stop;
+    bool drawn;
+    size_t done;
+    size_t failed;
+    uint64_t started;
+} ProgressLine;
+
+static void progress_draw(ProgressLine *line) {
+    double seconds = (double)(monotonic_ns() - line->started) / 1e9;
+    if (seconds <= 0.0) {
+        seconds = 1e-9;
+    }
+    double megabytes = (double)metrics_copied_bytes() / (1024.0 * 1024.0);
+    fprintf(stderr, "\r\033[K%zu entradas, %zu falhas | %.1f itens/s | %.1f MB/s", line->done, line->failed,
+            (double)line->done / seconds, megabytes / seconds);
+    fflush(stderr);
+    line->drawn = true;
+}
+
+static void progress_clear(ProgressLine *line) {
+    if (line->drawn) {
+        fputs("\r\033[K", stderr);
+        line->drawn = false;
+    }
+}
+
+static void progress_entry(const DotfileEntry *entry, bool ok, void *user) {
+    (void)entry;
+    ProgressLine *line = user;
+    pthread_mutex_lock(&line->lock);
+    ++line->done;
+    if (!ok) {
+        ++line->failed;
+    }
+    pthread_mutex_unlock(&line->lock);
+}
+
+static void progress_log(LogLevel level, const char *message, void *user) {
+    static const char *colors[] = {LOG_COLOR_INFO, LOG_COLOR_WARN, LOG_COLOR_ERROR};
+    ProgressLine *line = user;
+    pthread_mutex_lock(&line->lock);
+    bool redraw = line->drawn;
+    progress_clear(line);
+    fprintf(stderr, "%s%s%s\n", colors[level], message, LOG_COLOR_RESET);
+    if (redraw) {
+        progress_draw(line);
+    }
+    pthread_mutex_unlock(&line->lock);
+}
+
+static void *progress_ticker(void *arg) {
+    ProgressLine *line = arg;
+    pthread_mutex_lock(&line->lock);
+    while (!line->stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += PROGRESS_TICK_NS;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_nsec -= 1000000000L;
+            ++deadline.tv_sec;
+        }
+        pthread_cond_timedwait(&line->wake, &line->lock, &deadline);
+        if (!line->stop) {
+            progress_draw(line);
+        }
+    }
+    pthread_mutex_unlock(&line->lock);
+    return NULL;
+}
+
+/* Só para comandos que percorrem entradas e sem prompts (interactive/batch leem o terminal). */
+static bool progress_wanted(const AppOptions *opts) {
+    bool walks = opts->command == CMD_INSTALL || opts->command == CMD_COLLECT || opts->command == CMD_RECONCILE;
+    return walks && opts->conflict_mode != CONFLICT_INTERACTIVE && opts->conflict_mode != CONFLICT_BATCH &&
+           isatty(STDERR_FILENO);
+}
+
+static void progress_start(ProgressLine *line, DotmgrContext *ctx) {
+    memset(line, 0, sizeof(*line));
+    pthread_mutex_init(&line->lock, NULL);
+    pthread_cond_init(&line->wake, NULL);
+    line->started = monotonic_ns();
+    line->ticking = pthread_create(&line->ticker, NULL, progress_ticker, line) == 0;
+    dotmgr_set_log(ctx, progress_log, line);
+    dotmgr_set_progress(ctx, progress_entry, line);
+}
+
+static void progress_finish(ProgressLine *line) {
+    pthread_mutex_lock(&line->lock);
+    line->stop = true;
+    pthread_cond_signal(&line->wake);
+    pthread_mutex_unlock(&line->lock);
+    if (line->ticking) {
+        pthread_join(line->ticker, NULL);
+    }
+    progress_clear(line);
+    pthread_cond_destroy(&line->wake);
+    pthread_mutex_destroy(&line->lock);
+}
+#endif
+
 int main(int argc, char **argv) {
     AppOptions opts;
     memset(&opts, 0, sizeof(opts));
-    if (!parse_arguments(argc, argv, &opts)) {
+    RootList roots;
+    memset(&roots, 0, sizeof(roots));
+    if (!parse_arguments(argc, argv, &opts, &roots)) {
+        root_list_free(&roots);
         return EXIT_FAILURE;
     }
-
-    DotfileConfig config;
-    if (!load_config(&opts, &config)) {
+    if (opts.command == CMD_BATCH) {
+        if (roots.count > 0) {
+            log_error("--root/--home-list devem ir em cada linha do batch");
+            root_list_free(&roots);
+            return EXIT_FAILURE;
+        }
+        profile_enable(opts.profile);
+        if (opts.trace_path[0] && !trace_open(opts.trace_path)) {
+            return EXIT_FAILURE;
+        }
+        int exit_code = run_batch(&opts);
+        if (!trace_close()) {
+            exit_code = EXIT_FAILURE;
+        }
+        return exit_code;
+    }
+    DotmgrContext *ctx = dotmgr_open(&opts);
+    if (!ctx) {
+        log_error("Memória insuficiente");
+        root_list_free(&roots);
         return EXIT_FAILURE;
     }
+    *dotmgr_roots(ctx) = roots;
 
-    bool ok = run_command(&opts, &config);
-    free_config(&config);
-
-    if (ok && opts.git_auto) {
-        if (!git_auto_sync(&opts)) {
-            log_warn("Git auto-commit falhou");
-        }
+    profile_enable(opts.profile);
+    if (opts.trace_path[0] && !trace_open(opts.trace_path)) {
+        dotmgr_close(ctx);
+        return EXIT_FAILURE;
     }
-
-    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    DotmgrResult result;
+#ifndef _WIN32
+    ProgressLine progress;
+    bool show_progress = progress_wanted(&opts);
+    if (show_progress) {
+        progress_start(&progress, ctx);
+    }
+    dotmgr_run(ctx, opts.command, &result);
+    if (show_progress) {
+        progress_finish(&progress);
+    }
+#else
+    dotmgr_run(ctx, opts.command, &result);
+#endif
+    dotmgr_close(ctx);
+    if (!trace_close() && result.exit_code == EXIT_SUCCESS) {
+        result.exit_code = EXIT_FAILURE;
+    }
+    profile_report(stderr);
+    return result.exit_code;
 }
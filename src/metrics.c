@@ -0,0 +1,269 @@
+#include "metrics.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "bufwriter.h"
+#include "profile.h"
+#include "status_report.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <process.h>
+#define getpid _getpid
+#endif
+
+#define LAST_RUN_FILE "last-run.tsv"
+#define MAX_RUN_RECORDS 512
+#define GIT_SYNC_COMMAND "git-sync"
+
+typedef struct {
+    char command[16];
+    char key[48];
+    char value[32];
+} RunRecord;
+
+typedef struct {
+    const char *key;
+    const char *metric;
+    const char *help;
+} MetricFamily;
+
+static const char *command_names[] = {"install", "uninstall", "status", "collect", "plan", "apply", "batch", "reconcile", "gc"};
+
+static const MetricFamily run_families[] = {
+    {"duration_seconds", "dotmgr_last_run_duration_seconds", "Duração da última execução do comando."},
+    {"success", "dotmgr_last_run_success", "1 se a última execução do comando terminou sem falhas."},
+    {"timestamp", "dotmgr_last_run_timestamp_seconds", "Horário (epoch) da última execução do comando."},
+    {"phase_seconds.", "dotmgr_last_run_phase_seconds", "Tempo total por fase na última execução do comando."},
+    {"phase_calls.", "dotmgr_last_run_phase_calls", "Spans por fase na última execução do comando."},
+    {"copied_bytes", "dotmgr_collect_copied_bytes", "Bytes copiados para o repositório na última execução."},
+};
+
+static atomic_uint_least64_t copied_bytes;
+static int git_outcome = -1;
+static bool have_status;
+static size_t status_counts[STATUS_STATE_COUNT];
+static RunRecord records[MAX_RUN_RECORDS];
+static size_t record_count;
+static bool records_loaded;
+
+void metrics_reset(void) {
+    atomic_store(&copied_bytes, 0);
+    git_outcome = -1;
+    have_status = false;
+    record_count = 0;
+    records_loaded = false;
+}
+
+void metrics_add_copied_bytes(uint64_t bytes) {
+    atomic_fetch_add(&copied_bytes, bytes);
+}
+
+uint64_t metrics_copied_bytes(void) {
+    return atomic_load(&copied_bytes);
+}
+
+void metrics_git_sync(bool ok) {
+    git_outcome = ok ? 1 : 0;
+}
+
+void metrics_status_counts(const size_t counts[STATUS_STATE_COUNT]) {
+    memcpy(status_counts, counts, sizeof(status_counts));
+    have_status = true;
+}
+
+static const char *command_name(CommandType command) {
+    size_t index = (size_t)command;
+    return index < sizeof(command_names) / sizeof(command_names[0]) ? command_names[index] : "unknown";
+}
+
+static void load_records(const AppOptions *opts) {
+    if (records_loaded) {
+        return;
+    }
+    records_loaded = true;
+    char path[PATH_MAX];
+    if (!join_paths(opts->state_dir, LAST_RUN_FILE, path, sizeof(path))) {
+        return;
+    }
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return;
+    }
+    char line[160];
+    while (record_count < MAX_RUN_RECORDS && fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *key = strchr(line, '\t');
+        char *value = key ? strchr(key + 1, '\t') : NULL;
+        if (!value) {
+            continue;
+        }
+        *key++ = '\0';
+        *value++ = '\0';
+        RunRecord *record = &records[record_count++];
+        snprintf(record->command, sizeof(record->command), "%.15s", line);
+        snprintf(record->key, sizeof(record->key), "%.47s", key);
+        snprintf(record->value, sizeof(record->value), "%.31s", value);
+    }
+    fclose(fp);
+}
+
+static void drop_command(const char *command) {
+    size_t kept = 0;
+    for (size_t i = 0; i < record_count; ++i) {
+        if (strcmp(records[i].command, command) != 0) {
+            records[kept++] = records[i];
+        }
+    }
+    record_count = kept;
+}
+
+static void put_record(const char *command, const char *key, const char *fmt, ...) {
+    if (record_count == MAX_RUN_RECORDS) {
+        return;
+    }
+    RunRecord *record = &records[record_count++];
+    snprintf(record->command, sizeof(record->command), "%s", command);
+    snprintf(record->key, sizeof(record->key), "%s", key);
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(record->value, sizeof(record->value), fmt, args);
+    va_end(args);
+}
+
+static bool write_records(const AppOptions *opts) {
+    char path[PATH_MAX];
+    char tmp_path[PATH_MAX + 8];
+    if (!make_dirs(opts->state_dir) || !join_paths(opts->state_dir, LAST_RUN_FILE, path, sizeof(path))) {
+        return false;
+    }
+    FILE *fp = open_sibling_temp(path, tmp_path, sizeof(tmp_path));
+    if (!fp) {
+        log_warn("Não foi possível gravar métricas '%s': %s", path, strerror(errno));
+        return false;
+    }
+    for (size_t i = 0; i < record_count; ++i) {
+        fprintf(fp, "%s\t%s\t%s\n", records[i].command, records[i].key, records[i].value);
+    }
+    if (fclose(fp) != 0 || rename(tmp_path, path) != 0) {
+        log_warn("Não foi possível gravar métricas '%s'", path);
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+/* Substitui as métricas do comando atual em <state_dir>/last-run.tsv, mantendo as dos demais comandos.
+ * Chamado sob o lock de estado; o arquivo é relido para manter o que outra execução gravou. */
+bool metrics_record_run(const AppOptions *opts, bool ok) {
+    if (!opts || opts->dry_run) {
+        return true;
+    }
+    records_loaded = false;
+    record_count = 0;
+    load_records(opts);
+    const char *command = command_name(opts->command);
+    drop_command(command);
+    long long now = (long long)time(NULL);
+    uint64_t count;
+    uint64_t total_ns;
+    put_record(command, "timestamp", "%lld", now);
+    put_record(command, "success", "%d", ok ? 1 : 0);
+    if (profile_phase_totals(PROFILE_MAIN, &count, &total_ns)) {
+        put_record(command, "duration_seconds", "%.6f", (double)total_ns / 1e9);
+    }
+    for (int phase = PROFILE_MAIN + 1; phase < PROFILE_PHASE_COUNT; ++phase) {
+        if (!profile_phase_totals((ProfilePhase)phase, &count, &total_ns)) {
+            continue;
+        }
+        char key[48];
+        snprintf(key, sizeof(key), "phase_seconds.%s", profile_phase_name((ProfilePhase)phase));
+        put_record(command, key, "%.6f", (double)total_ns / 1e9);
+        snprintf(key, sizeof(key), "phase_calls.%s", profile_phase_name((ProfilePhase)phase));
+        put_record(command, key, "%llu", (unsigned long long)count);
+    }
+    if (opts->command == CMD_COLLECT || opts->command == CMD_APPLY) {
+        put_record(command, "copied_bytes", "%llu", (unsigned long long)atomic_load(&copied_bytes));
+    }
+    if (git_outcome >= 0) {
+        drop_command(GIT_SYNC_COMMAND);
+        put_record(GIT_SYNC_COMMAND, "timestamp", "%lld", now);
+        put_record(GIT_SYNC_COMMAND, "success", "%d", git_outcome);
+    }
+    return write_records(opts);
+}
+
+static void write_family_header(BufWriter *out, const char *metric, const char *help) {
+    bufwriter_printf(out, "# HELP %s %s\n# TYPE %s gauge\n", metric, help, metric);
+}
+
+static void write_run_family(BufWriter *out, const MetricFamily *family) {
+    size_t key_len = strlen(family->key);
+    bool prefix = family->key[key_len - 1] == '.';
+    bool header = false;
+    for (size_t i = 0; i < record_count; ++i) {
+        const RunRecord *record = &records[i];
+        if (strcmp(record->command, GIT_SYNC_COMMAND) == 0 ||
+            (prefix ? strncmp(record->key, family->key, key_len) != 0 : strcmp(record->key, family->key) != 0)) {
+            continue;
+        }
+        if (!header) {
+            write_family_header(out, family->metric, family->help);
+            header = true;
+        }
+        bufwriter_printf(out, "%s{command=\"%s\"", family->metric, record->command);
+        if (prefix) {
+            bufwriter_printf(out, ",phase=\"%s\"", record->key + key_len);
+        }
+        bufwriter_printf(out, "} %s\n", record->value);
+    }
+}
+
+static void write_git_family(BufWriter *out, const char *key, const char *metric, const char *help) {
+    for (size_t i = 0; i < record_count; ++i) {
+        if (strcmp(records[i].command, GIT_SYNC_COMMAND) == 0 && strcmp(records[i].key, key) == 0) {
+            write_family_header(out, metric, help);
+            bufwriter_printf(out, "%s %s\n", metric, records[i].value);
+            return;
+        }
+    }
+}
+
+/* Arquivo para o textfile collector do node_exporter: escrito num temporário e renomeado por cima. */
+bool metrics_write_prom(const AppOptions *opts, const char *path) {
+    if (!opts || !path || !path[0]) {
+        return false;
+    }
+    load_records(opts);
+    char tmp_path[PATH_MAX + 32];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", path, (long)getpid());
+    BufWriter out;
+    if (!bufwriter_open(&out, tmp_path, BUFWRITER_DEFAULT_CAPACITY)) {
+        return false;
+    }
+    if (have_status) {
+        write_family_header(&out, "dotmgr_entries", "Entradas por estado no último status.");
+        for (int state = 0; state < STATUS_STATE_COUNT; ++state) {
+            bufwriter_printf(&out, "dotmgr_entries{state=\"%s\"} %zu\n", entry_status_name((EntryStatus)state),
+                             status_counts[state]);
+        }
+    }
+    for (size_t i = 0; i < sizeof(run_families) / sizeof(run_families[0]); ++i) {
+        write_run_family(&out, &run_families[i]);
+    }
+    write_git_family(&out, "success", "dotmgr_git_sync_success", "1 se o último git auto-sync funcionou.");
+    write_git_family(&out, "timestamp", "dotmgr_git_sync_timestamp_seconds", "Horário (epoch) do último git auto-sync.");
+    if (!bufwriter_close(&out) || rename(tmp_path, path) != 0) {
+        log_error("Não foi possível gravar métricas em '%s': %s", path, strerror(errno));
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
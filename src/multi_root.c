@@ -0,0 +1,297 @@
+#include "multi_root.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "runner.h"
+#include "state_db.h"
+#include "utils.h"
+
+typedef enum {
+    ROOT_PENDING,
+    ROOT_DONE,
+    ROOT_FAILED,
+    ROOT_SKIPPED
+} RootState;
+
+typedef struct {
+    RootState state;
+    RunSummary summary;
+    size_t outside_home;
+    uint64_t elapsed_ns;
+} RootResult;
+
+typedef struct {
+    const AppOptions *opts;
+    const DotfileConfig *config;
+    const RootList *roots;
+    RootResult *results;
+    char home[PATH_MAX];
+    char home_norm[PATH_MAX];
+    atomic_size_t next;
+    atomic_bool aborted;
+} MultiRootRun;
+
+bool root_list_add(RootList *list, const char *path, RootKind kind) {
+    if (!list || !path || !*path) {
+        return false;
+    }
+    if (list->count == list->capacity) {
+        size_t next = list->capacity ? list->capacity * 2 : 8;
+        RootSpec *tmp = realloc(list->items, next * sizeof(RootSpec));
+        if (!tmp) {
+            return false;
+        }
+        list->items = tmp;
+        list->capacity = next;
+    }
+    RootSpec *spec = &list->items[list->count];
+    if (!normalize_path(path, spec->path, sizeof(spec->path)) &&
+        snprintf(spec->path, sizeof(spec->path), "%s", path) >= (int)sizeof(spec->path)) {
+        return false;
+    }
+    spec->kind = kind;
+    ++list->count;
+    return true;
+}
+
+bool root_list_load(RootList *list, const char *file) {
+    FILE *fp = fopen(file, "r");
+    if (!fp) {
+        log_error("Não foi possível abrir lista de homes '%s'", file);
+        return false;
+    }
+    char line[PATH_MAX];
+    bool ok = true;
+    while (fgets(line, sizeof(line), fp)) {
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        char *start = line;
+        while (*start == ' ' || *start == '\t') {
+            ++start;
+        }
+        size_t len = strlen(start);
+        while (len > 0 && (start[len - 1] == ' ' || start[len - 1] == '\t')) {
+            start[--len] = '\0';
+        }
+        if (len == 0) {
+            continue;
+        }
+        if (!root_list_add(list, start, ROOT_HOME)) {
+            ok = false;
+            break;
+        }
+    }
+    fclose(fp);
+    return ok;
+}
+
+void root_list_free(RootList *list) {
+    if (!list) {
+        return;
+    }
+    free(list->items);
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+static const char *strip_prefix(const char *path, const char *prefix) {
+    size_t len = strlen(prefix);
+    if (len == 0 || strncmp(path, prefix, len) != 0) {
+        return NULL;
+    }
+    if (path[len] == '\0' || path[len] == '/' || path[len] == '\\') {
+        return path + len;
+    }
+    return NULL;
+}
+
+bool root_rebase_target(const RootSpec *root, const char *home, const char *home_norm, const char *target,
+                        char *output, size_t len, bool *outside) {
+    *outside = false;
+    if (root->kind == ROOT_PREFIX) {
+        const char *prefix = strcmp(root->path, "/") == 0 ? "" : root->path;
+        return snprintf(output, len, "%s%s", prefix, target) < (int)len;
+    }
+    const char *rest = strip_prefix(target, home_norm);
+    if (!rest) {
+        rest = strip_prefix(target, home);
+    }
+    if (!rest) {
+        *outside = true;
+        return true;
+    }
+    return snprintf(output, len, "%s%s", root->path, rest) < (int)len;
+}
+
+static bool run_root(MultiRootRun *run, size_t index, DotfileConfig *scratch) {
+    const RootSpec *root = &run->roots->items[index];
+    RootResult *result = &run->results[index];
+    if (!path_exists(root->path)) {
+        log_error("Raiz inexistente: %s", root->path);
+        return false;
+    }
+    scratch->count = 0;
+    for (size_t i = 0; i < run->config->count; ++i) {
+        const DotfileEntry *entry = &run->config->entries[i];
+        DotfileEntry *rebased = &scratch->entries[scratch->count];
+        bool outside = false;
+        if (!root_rebase_target(root, run->home, run->home_norm, entry->target_path, rebased->target_path,
+                                sizeof(rebased->target_path), &outside)) {
+            log_error("Destino muito longo ao rebasear %s em %s", entry->target_path, root->path);
+            return false;
+        }
+        if (outside) {
+            ++result->outside_home;
+            if (run->opts->verbose) {
+                log_info("Fora do HOME, ignorado em %s: %s", root->path, entry->target_path);
+            }
+            continue;
+        }
+        memcpy(rebased->source_path, entry->source_path, sizeof(rebased->source_path));
+        rebased->is_directory = entry->is_directory;
+        rebased->mode = entry->mode;
+        ++scratch->count;
+    }
+    if (run->opts->verbose) {
+        log_info("Aplicando %zu entradas em %s", scratch->count, root->path);
+    }
+    return run_command(run->opts, scratch, &result->summary);
+}
+
+static void *root_worker(void *arg) {
+    MultiRootRun *run = arg;
+    DotfileConfig scratch;
+    memset(&scratch, 0, sizeof(scratch));
+    scratch.entries = calloc(run->config->count ? run->config->count : 1, sizeof(DotfileEntry));
+    scratch.vars = run->config->vars;
+    for (;;) {
+        size_t index = atomic_fetch_add(&run->next, 1);
+        if (index >= run->roots->count) {
+            break;
+        }
+        RootResult *result = &run->results[index];
+        if (!scratch.entries) {
+            result->state = ROOT_FAILED;
+            continue;
+        }
+        if (atomic_load(&run->aborted)) {
+            result->state = ROOT_SKIPPED;
+            continue;
+        }
+        uint64_t start = monotonic_ns();
+        state_db_set_scope(run->roots->items[index].path);
+        bool ok = run_root(run, index, &scratch);
+        state_db_set_scope(NULL);
+        result->elapsed_ns = monotonic_ns() - start;
+        result->state = ok ? ROOT_DONE : ROOT_FAILED;
+        if (!ok && run->opts->root_failure_policy == ROOT_FAILURE_ABORT) {
+            atomic_store(&run->aborted, true);
+        }
+    }
+    free(scratch.entries);
+    return NULL;
+}
+
+static const char *state_label(RootState state) {
+    switch (state) {
+        case ROOT_DONE:
+            return "ok";
+        case ROOT_FAILED:
+            return "falhou";
+        case ROOT_SKIPPED:
+            return "não executada";
+        default:
+            return "pendente";
+    }
+}
+
+static void print_summary(const MultiRootRun *run) {
+    size_t failed = 0;
+    size_t skipped = 0;
+    log_info("Resumo por raiz (%zu):", run->roots->count);
+    for (size_t i = 0; i < run->roots->count; ++i) {
+        const RootResult *result = &run->results[i];
+        if (result->state == ROOT_FAILED) {
+            ++failed;
+        } else if (result->state == ROOT_SKIPPED) {
+            ++skipped;
+        }
+        void (*log_fn)(const char *, ...) = result->state == ROOT_DONE ? log_info :
+            (result->state == ROOT_FAILED ? log_error : log_warn);
+        log_fn("  %-14s %s: %zu entradas, %zu falhas, %zu fora do HOME, %.1f ms",
+               state_label(result->state), run->roots->items[i].path,
+               result->summary.processed, result->summary.failed, result->outside_home,
+               (double)result->elapsed_ns / 1e6);
+    }
+    log_info("Raízes: %zu ok, %zu com falha, %zu não executadas",
+             run->roots->count - failed - skipped, failed, skipped);
+}
+
+bool run_multi_root(const AppOptions *opts, const DotfileConfig *config, const RootList *roots) {
+    if (!opts || !config || !roots || roots->count == 0) {
+        return false;
+    }
+    MultiRootRun run;
+    memset(&run, 0, sizeof(run));
+    run.opts = opts;
+    run.config = config;
+    run.roots = roots;
+    run.results = calloc(roots->count, sizeof(RootResult));
+    if (!run.results) {
+        return false;
+    }
+    const char *home = getenv("HOME");
+#ifdef _WIN32
+    if (!home) {
+        home = getenv("USERPROFILE");
+    }
+#endif
+    if (home) {
+        snprintf(run.home, sizeof(run.home), "%s", home);
+        if (!normalize_path(home, run.home_norm, sizeof(run.home_norm))) {
+            snprintf(run.home_norm, sizeof(run.home_norm), "%s", home);
+        }
+    }
+    atomic_init(&run.next, 0);
+    atomic_init(&run.aborted, false);
+
+    int jobs = opts->jobs > 0 ? opts->jobs : default_job_count();
+    if (opts->conflict_mode == CONFLICT_INTERACTIVE || opts->conflict_mode == CONFLICT_BATCH) {
+        jobs = 1;
+    }
+    if ((size_t)jobs > roots->count) {
+        jobs = (int)roots->count;
+    }
+    pthread_t *threads = calloc((size_t)jobs, sizeof(pthread_t));
+    int started = 0;
+    for (; threads && started < jobs; ++started) {
+        if (pthread_create(&threads[started], NULL, root_worker, &run) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        root_worker(&run);
+    }
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    print_summary(&run);
+    bool ok = true;
+    for (size_t i = 0; i < roots->count; ++i) {
+        if (run.results[i].state != ROOT_DONE) {
+            ok = false;
+        }
+    }
+    free(run.results);
+    return ok;
+}
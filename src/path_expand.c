@@ -0,0 +1,481 @@
+#include "path_expand.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+static char *dup_range(const char *start, size_t len) {
+    char *copy = malloc(len + 1);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, start, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+static bool push_token(PathTemplate *tpl, size_t *capacity, PathTokenKind kind, char *text, PathTemplate *fallback) {
+    if (tpl->count == *capacity) {
+        size_t next = *capacity ? *capacity * 2 : 4;
+        PathToken *tmp = realloc(tpl->tokens, next * sizeof(PathToken));
+        if (!tmp) {
+            return false;
+        }
+        tpl->tokens = tmp;
+        *capacity = next;
+    }
+    tpl->tokens[tpl->count].kind = kind;
+    tpl->tokens[tpl->count].text = text;
+    tpl->tokens[tpl->count].fallback = fallback;
+    ++tpl->count;
+    return true;
+}
+
+static bool push_literal(PathTemplate *tpl, size_t *capacity, const char *start, size_t len) {
+    if (len == 0) {
+        return true;
+    }
+    PathToken *last = tpl->count ? &tpl->tokens[tpl->count - 1] : NULL;
+    if (last && last->kind == PATH_TOKEN_LITERAL) {
+        size_t old_len = strlen(last->text);
+        char *tmp = realloc(last->text, old_len + len + 1);
+        if (!tmp) {
+            return false;
+        }
+        memcpy(tmp + old_len, start, len);
+        tmp[old_len + len] = '\0';
+        last->text = tmp;
+        return true;
+    }
+    char *text = dup_range(start, len);
+    if (!text) {
+        return false;
+    }
+    if (!push_token(tpl, capacity, PATH_TOKEN_LITERAL, text, NULL)) {
+        free(text);
+        return false;
+    }
+    return true;
+}
+
+static bool is_name_char(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+static const char *find_closing_brace(const char *p) {
+    int depth = 1;
+    for (; *p; ++p) {
+        if (*p == '{') {
+            ++depth;
+        } else if (*p == '}' && --depth == 0) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static bool compile_env_braced(PathTemplate *tpl, size_t *capacity, const char *body, size_t len) {
+    const char *sep = NULL;
+    for (size_t i = 0; i + 1 < len; ++i) {
+        if (body[i] == ':' && body[i + 1] == '-') {
+            sep = body + i;
+            break;
+        }
+    }
+    size_t name_len = sep ? (size_t)(sep - body) : len;
+    if (name_len == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < name_len; ++i) {
+        if (!is_name_char(body[i])) {
+            return false;
+        }
+    }
+    char *name = dup_range(body, name_len);
+    if (!name) {
+        return false;
+    }
+    PathTemplate *fallback = NULL;
+    if (sep) {
+        char *raw_default = dup_range(sep + 2, len - name_len - 2);
+        fallback = calloc(1, sizeof(PathTemplate));
+        if (!raw_default || !fallback || !path_template_compile(raw_default, fallback)) {
+            free(raw_default);
+            free(fallback);
+            free(name);
+            return false;
+        }
+        free(raw_default);
+    }
+    if (!push_token(tpl, capacity, PATH_TOKEN_ENV, name, fallback)) {
+        path_template_free(fallback);
+        free(fallback);
+        free(name);
+        return false;
+    }
+    return true;
+}
+
+bool path_template_compile(const char *raw, PathTemplate *tpl) {
+    if (!raw || !tpl) {
+        return false;
+    }
+    memset(tpl, 0, sizeof(*tpl));
+    size_t capacity = 0;
+    const char *p = raw;
+
+    if (p[0] == '~' && (p[1] == '\0' || p[1] == '/' || p[1] == '\\')) {
+        if (!push_token(tpl, &capacity, PATH_TOKEN_HOME, NULL, NULL)) {
+            goto fail;
+        }
+        ++p;
+    }
+
+    const char *literal = p;
+    while (*p) {
+        if (p[0] == '$' && p[1] == '$') {
+            if (!push_literal(tpl, &capacity, literal, (size_t)(p - literal) + 1)) {
+                goto fail;
+            }
+            p += 2;
+            literal = p;
+            continue;
+        }
+        if (p[0] == '$' && p[1] == '{') {
+            const char *close = find_closing_brace(p + 2);
+            if (!close) {
+                goto fail;
+            }
+            if (!push_literal(tpl, &capacity, literal, (size_t)(p - literal)) ||
+                !compile_env_braced(tpl, &capacity, p + 2, (size_t)(close - p - 2))) {
+                goto fail;
+            }
+            p = close + 1;
+            literal = p;
+            continue;
+        }
+        if (p[0] == '$' && is_name_char(p[1]) && !isdigit((unsigned char)p[1])) {
+            const char *name_start = p + 1;
+            const char *name_end = name_start;
+            while (is_name_char(*name_end)) {
+                ++name_end;
+            }
+            char *name = dup_range(name_start, (size_t)(name_end - name_start));
+            if (!name || !push_literal(tpl, &capacity, literal, (size_t)(p - literal)) ||
+                !push_token(tpl, &capacity, PATH_TOKEN_ENV, name, NULL)) {
+                free(name);
+                goto fail;
+            }
+            p = name_end;
+            literal = p;
+            continue;
+        }
+        if (p[0] == '{' && p[1] == '{') {
+            const char *close = strstr(p + 2, "}}");
+            if (!close) {
+                goto fail;
+            }
+            const char *name_start = p + 2;
+            const char *name_end = close;
+            while (name_start < name_end && isspace((unsigned char)*name_start)) {
+                ++name_start;
+            }
+            while (name_end > name_start && isspace((unsigned char)name_end[-1])) {
+                --name_end;
+            }
+            if (name_start == name_end) {
+                goto fail;
+            }
+            for (const char *c = name_start; c < name_end; ++c) {
+                if (!is_name_char(*c) && *c != '.' && *c != '-') {
+                    goto fail;
+                }
+            }
+            char *name = dup_range(name_start, (size_t)(name_end - name_start));
+            if (!name || !push_literal(tpl, &capacity, literal, (size_t)(p - literal)) ||
+                !push_token(tpl, &capacity, PATH_TOKEN_VAR, name, NULL)) {
+                free(name);
+                goto fail;
+            }
+            p = close + 2;
+            literal = p;
+            continue;
+        }
+        ++p;
+    }
+    if (!push_literal(tpl, &capacity, literal, (size_t)(p - literal))) {
+        goto fail;
+    }
+    return true;
+
+fail:
+    path_template_free(tpl);
+    return false;
+}
+
+void path_template_free(PathTemplate *tpl) {
+    if (!tpl) {
+        return;
+    }
+    for (size_t i = 0; i < tpl->count; ++i) {
+        free(tpl->tokens[i].text);
+        if (tpl->tokens[i].fallback) {
+            path_template_free(tpl->tokens[i].fallback);
+            free(tpl->tokens[i].fallback);
+        }
+    }
+    free(tpl->tokens);
+    tpl->tokens = NULL;
+    tpl->count = 0;
+}
+
+static bool append_text(char *output, size_t len, size_t *pos, const char *text) {
+    size_t text_len = strlen(text);
+    if (*pos + text_len >= len) {
+        return false;
+    }
+    memcpy(output + *pos, text, text_len);
+    *pos += text_len;
+    output[*pos] = '\0';
+    return true;
+}
+
+bool path_template_render(const PathTemplate *tpl, PathVars *vars, char *output, size_t len) {
+    if (!tpl || !vars || !output || len == 0) {
+        return false;
+    }
+    size_t pos = 0;
+    output[0] = '\0';
+    for (size_t i = 0; i < tpl->count; ++i) {
+        const PathToken *token = &tpl->tokens[i];
+        const char *value = NULL;
+        switch (token->kind) {
+            case PATH_TOKEN_LITERAL:
+                value = token->text;
+                break;
+            case PATH_TOKEN_HOME:
+                value = path_vars_lookup(vars, "home", false);
+                if (!value) {
+                    log_error("Não foi possível determinar o diretório HOME");
+                    return false;
+                }
+                break;
+            case PATH_TOKEN_ENV:
+                value = path_vars_lookup(vars, token->text, true);
+                if ((!value || !*value) && token->fallback) {
+                    char fallback[PATH_MAX];
+                    if (!path_template_render(token->fallback, vars, fallback, sizeof(fallback)) ||
+                        !append_text(output, len, &pos, fallback)) {
+                        return false;
+                    }
+                    continue;
+                }
+                if (!value) {
+                    log_error("Variável de ambiente '%s' não definida", token->text);
+                    return false;
+                }
+                break;
+            case PATH_TOKEN_VAR:
+                value = path_vars_lookup(vars, token->text, false);
+                if (!value) {
+                    log_error("Variável '{{%s}}' não definida", token->text);
+                    return false;
+                }
+                break;
+        }
+        if (!append_text(output, len, &pos, value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void path_vars_init(PathVars *vars, const AppOptions *opts) {
+    if (!vars) {
+        return;
+    }
+    memset(vars, 0, sizeof(*vars));
+    if (opts) {
+        snprintf(vars->machine_name, sizeof(vars->machine_name), "%s", opts->machine_name);
+    }
+}
+
+void path_vars_free(PathVars *vars) {
+    if (!vars) {
+        return;
+    }
+    for (size_t i = 0; i < vars->count; ++i) {
+        free(vars->vars[i].name);
+        free(vars->vars[i].value);
+    }
+    free(vars->vars);
+    vars->vars = NULL;
+    vars->count = 0;
+    vars->capacity = 0;
+}
+
+static PathVar *find_var(PathVars *vars, const char *name, bool is_env) {
+    for (size_t i = 0; i < vars->count; ++i) {
+        if (vars->vars[i].from_env == is_env && strcmp(vars->vars[i].name, name) == 0) {
+            return &vars->vars[i];
+        }
+    }
+    return NULL;
+}
+
+static PathVar *add_var(PathVars *vars, const char *name, const char *value, bool is_env, bool builtin) {
+    if (vars->count == vars->capacity) {
+        size_t next = vars->capacity ? vars->capacity * 2 : 8;
+        PathVar *tmp = realloc(vars->vars, next * sizeof(PathVar));
+        if (!tmp) {
+            return NULL;
+        }
+        vars->vars = tmp;
+        vars->capacity = next;
+    }
+    PathVar *var = &vars->vars[vars->count];
+    var->name = dup_range(name, strlen(name));
+    var->value = value ? dup_range(value, strlen(value)) : NULL;
+    var->from_env = is_env;
+    var->builtin = builtin;
+    if (!var->name || (value && !var->value)) {
+        free(var->name);
+        free(var->value);
+        return NULL;
+    }
+    ++vars->count;
+    return var;
+}
+
+static const char *home_directory(void) {
+    const char *home = getenv("HOME");
+#ifdef _WIN32
+    if (!home) {
+        home = getenv("USERPROFILE");
+    }
+#endif
+    return home;
+}
+
+static bool builtin_value(const PathVars *vars, const char *name, char *buffer, size_t len) {
+    const char *value = NULL;
+    if (strcmp(name, "machine") == 0) {
+        value = vars->machine_name;
+    } else if (strcmp(name, "hostname") == 0) {
+        return get_machine_name(buffer, len);
+    } else if (strcmp(name, "home") == 0) {
+        value = home_directory();
+    } else if (strcmp(name, "user") == 0) {
+        value = getenv("USER");
+        if (!value) {
+            value = getenv("LOGNAME");
+        }
+        if (!value) {
+            value = getenv("USERNAME");
+        }
+    } else if (strcmp(name, "os") == 0) {
+#if defined(_WIN32)
+        value = "windows";
+#elif defined(__APPLE__)
+        value = "darwin";
+#elif defined(__linux__)
+        value = "linux";
+#else
+        value = "unix";
+#endif
+    }
+    if (!value) {
+        return false;
+    }
+    return snprintf(buffer, len, "%s", value) < (int)len;
+}
+
+bool path_vars_define(PathVars *vars, const char *name, const char *value) {
+    if (!vars || !name || !value) {
+        return false;
+    }
+    PathVar *existing = find_var(vars, name, false);
+    if (existing) {
+        char *copy = dup_range(value, strlen(value));
+        if (!copy) {
+            return false;
+        }
+        free(existing->value);
+        existing->value = copy;
+        existing->builtin = false;
+        return true;
+    }
+    return add_var(vars, name, value, false, false) != NULL;
+}
+
+const char *path_vars_lookup(PathVars *vars, const char *name, bool is_env) {
+    if (!vars || !name) {
+        return NULL;
+    }
+    PathVar *var = find_var(vars, name, is_env);
+    if (var) {
+        return var->value;
+    }
+    if (is_env) {
+        var = add_var(vars, name, getenv(name), true, false);
+        return var ? var->value : getenv(name);
+    }
+    char buffer[PATH_MAX];
+    if (!builtin_value(vars, name, buffer, sizeof(buffer))) {
+        return NULL;
+    }
+    var = add_var(vars, name, buffer, false, true);
+    return var ? var->value : NULL;
+}
+
+uint64_t path_vars_fingerprint(const PathVars *vars) {
+    uint64_t hash = HASH_FNV1A64_SEED;
+    if (!vars) {
+        return hash;
+    }
+    for (size_t i = 0; i < vars->count; ++i) {
+        const PathVar *var = &vars->vars[i];
+        char kind = var->from_env ? 'e' : (var->builtin ? 'b' : 'd');
+        hash = hash_fnv1a64(&kind, 1, hash);
+        hash = hash_fnv1a64(var->name, strlen(var->name) + 1, hash);
+        if (var->value) {
+            hash = hash_fnv1a64(var->value, strlen(var->value) + 1, hash);
+        } else {
+            hash = hash_fnv1a64("\x01", 1, hash);
+        }
+    }
+    return hash;
+}
+
+bool path_vars_stale(const PathVars *vars) {
+    if (!vars) {
+        return true;
+    }
+    for (size_t i = 0; i < vars->count; ++i) {
+        const PathVar *var = &vars->vars[i];
+        if (var->from_env) {
+            const char *current = getenv(var->name);
+            if ((current == NULL) != (var->value == NULL)) {
+                return true;
+            }
+            if (current && strcmp(current, var->value) != 0) {
+                return true;
+            }
+            continue;
+        }
+        if (!var->builtin) {
+            continue;
+        }
+        char buffer[PATH_MAX];
+        if (!builtin_value(vars, var->name, buffer, sizeof(buffer))) {
+            return true;
+        }
+        if (!var->value || strcmp(buffer, var->value) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
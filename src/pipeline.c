@@ -0,0 +1,254 @@
+#include "pipeline.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "collect.h"
+#include "config_index.h"
+#include "config_parser.h"
+#include "path_expand.h"
+#include "profile.h"
+#include "strmap.h"
+#include "utils.h"
+
+#define PIPELINE_QUEUE 64
+
+typedef struct {
+    DotfileEntry entry;
+    size_t line;
+} QueueItem;
+
+/* Fila circular entre a thread do parser (produtor) e o executor; cheia, o parser espera. */
+typedef struct {
+    const AppOptions *opts;
+    PathVars vars;
+    QueueItem items[PIPELINE_QUEUE];
+    size_t head;
+    size_t count;
+    bool closed;
+    bool cancelled;
+    bool parsed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} EntryQueue;
+
+/* Entradas render ficam para depois do parse: o template pode usar variáveis definidas mais abaixo. */
+typedef struct {
+    DotfileEntry *entries;
+    size_t *numbers;
+    size_t count;
+    size_t capacity;
+} DeferredEntries;
+
+static bool queue_push(const DotfileEntry *entry, size_t line_number, void *user) {
+    EntryQueue *queue = user;
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == PIPELINE_QUEUE && !queue->cancelled) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    }
+    bool accepted = !queue->cancelled;
+    if (accepted) {
+        QueueItem *item = &queue->items[(queue->head + queue->count) % PIPELINE_QUEUE];
+        item->entry = *entry;
+        item->line = line_number;
+        ++queue->count;
+        pthread_cond_signal(&queue->not_empty);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return accepted;
+}
+
+static bool queue_pop(EntryQueue *queue, QueueItem *item) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->closed) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+    bool got = queue->count > 0;
+    if (got) {
+        *item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % PIPELINE_QUEUE;
+        --queue->count;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return got;
+}
+
+static void queue_cancel(EntryQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->cancelled = true;
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void *parser_thread(void *arg) {
+    EntryQueue *queue = arg;
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_LOAD_CONFIG);
+    bool parsed = config_stream(queue->opts, &queue->vars, queue_push, queue);
+    profile_end(&span);
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = true;
+    queue->parsed = parsed;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+/* Só avisa: a execução segue como no modo normal, em que a última entrada para um destino prevalece. */
+unsigned pipeline_check_target(PipelineTargetIndex *index, const char *target, size_t line) {
+    unsigned found = 0;
+    size_t previous;
+    if (strmap_get(&index->targets, target, &previous)) {
+        log_warn("Config linha %zu: destino repetido (linha %zu): %s", line, previous, target);
+        found |= PIPELINE_TARGET_REPEATED;
+    } else if (strmap_get(&index->parents, target, &previous)) {
+        log_warn("Config linha %zu: destino contém o da linha %zu: %s", line, previous, target);
+        found |= PIPELINE_TARGET_CONTAINS;
+    }
+    char prefix[PATH_MAX];
+    snprintf(prefix, sizeof(prefix), "%s", target);
+    bool nested = false;
+    for (char *slash = strrchr(prefix, '/'); slash && slash > prefix; slash = strrchr(prefix, '/')) {
+        *slash = '\0';
+        if (!nested && strmap_get(&index->targets, prefix, &previous)) {
+            log_warn("Config linha %zu: destino dentro do da linha %zu: %s", line, previous, target);
+            found |= PIPELINE_TARGET_NESTED;
+            nested = true;
+        }
+        if (!strmap_get(&index->parents, prefix, &previous)) {
+            strmap_put(&index->parents, prefix, line);
+        }
+    }
+    strmap_put(&index->targets, target, line);
+    return found;
+}
+
+static bool defer_entry(DeferredEntries *deferred, const DotfileEntry *entry, size_t number) {
+    if (deferred->count == deferred->capacity) {
+        size_t next = deferred->capacity ? deferred->capacity * 2 : 8;
+        DotfileEntry *entries = realloc(deferred->entries, next * sizeof(DotfileEntry));
+        if (!entries) {
+            return false;
+        }
+        deferred->entries = entries;
+        size_t *numbers = realloc(deferred->numbers, next * sizeof(size_t));
+        if (!numbers) {
+            return false;
+        }
+        deferred->numbers = numbers;
+        deferred->capacity = next;
+    }
+    deferred->entries[deferred->count] = *entry;
+    deferred->numbers[deferred->count++] = number;
+    return true;
+}
+
+bool pipeline_supported(const AppOptions *opts, bool has_roots) {
+    const char *reason = NULL;
+    if (opts->command != CMD_INSTALL && opts->command != CMD_UNINSTALL && opts->command != CMD_COLLECT &&
+        opts->command != CMD_STATUS) {
+        reason = "só vale para install, uninstall, collect e status";
+    } else if (opts->command == CMD_STATUS && (opts->status_format != STATUS_FORMAT_TEXT || opts->prom_path[0])) {
+        reason = "não combina com --format json|tsv ou --prom";
+    } else if (config_has_filter(opts)) {
+        reason = "não combina com --only/--except, que usam o índice da config inteira";
+    } else if (opts->conflict_mode == CONFLICT_BATCH) {
+        reason = "não combina com --mode batch, que analisa todos os conflitos antes";
+    } else if (has_roots) {
+        reason = "não suporta múltiplas raízes";
+    }
+    if (reason) {
+        log_error("--stream %s", reason);
+        return false;
+    }
+    return true;
+}
+
+bool run_pipeline(const AppOptions *opts, RunSummary *summary) {
+    memset(summary, 0, sizeof(*summary));
+    EntryQueue *queue = calloc(1, sizeof(EntryQueue));
+    PipelineTargetIndex index;
+    memset(&index, 0, sizeof(index));
+    if (!queue || !strmap_init(&index.targets, 64) || !strmap_init(&index.parents, 64)) {
+        log_error("Memória insuficiente para --stream");
+        strmap_free(&index.targets);
+        free(queue);
+        return false;
+    }
+    queue->opts = opts;
+    path_vars_init(&queue->vars, opts);
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+
+    uint64_t started = monotonic_ns();
+    pthread_t parser;
+    bool running = pthread_create(&parser, NULL, parser_thread, queue) == 0;
+    if (!running) {
+        log_error("Não foi possível iniciar a leitura da config");
+    }
+    bool success = running;
+    DeferredEntries deferred;
+    memset(&deferred, 0, sizeof(deferred));
+    DotfileConfig single;
+    memset(&single, 0, sizeof(single));
+    size_t number = 0;
+    QueueItem item;
+    while (running && queue_pop(queue, &item)) {
+        ++number;
+        pipeline_check_target(&index, item.entry.target_path, item.line);
+        if (item.entry.mode == DEPLOY_RENDER) {
+            if (!defer_entry(&deferred, &item.entry, number)) {
+                log_error("Memória insuficiente ao adiar entrada %zu", number);
+                success = false;
+                queue_cancel(queue);
+                break;
+            }
+            continue;
+        }
+        if (opts->verbose && number - deferred.count == 1) {
+            log_info("Primeira operação %.1f ms após o início da leitura da config",
+                     (double)(monotonic_ns() - started) / 1e6);
+        }
+        single.entries = &item.entry;
+        single.count = 1;
+        if (!run_single_entry(opts, &single, &item.entry, number, summary)) {
+            success = false;
+        }
+    }
+    if (running) {
+        pthread_join(parser, NULL);
+        success = success && queue->parsed;
+    }
+
+    if (success && deferred.count > 0) {
+        DotfileConfig view;
+        memset(&view, 0, sizeof(view));
+        view.entries = deferred.entries;
+        view.count = deferred.count;
+        view.vars = &queue->vars;
+        view.vars_fingerprint = path_vars_fingerprint(&queue->vars);
+        for (size_t i = 0; i < deferred.count; ++i) {
+            if (!run_single_entry(opts, &view, &deferred.entries[i], deferred.numbers[i], summary)) {
+                success = false;
+            }
+        }
+    }
+    if (opts->command == CMD_COLLECT && !collect_sync(opts)) {
+        success = false;
+    }
+
+    free(deferred.entries);
+    free(deferred.numbers);
+    strmap_free(&index.targets);
+    strmap_free(&index.parents);
+    path_vars_free(&queue->vars);
+    pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue);
+    return success;
+}
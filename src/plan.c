@@ -0,0 +1,788 @@
+#define _DEFAULT_SOURCE
+
+#include "plan.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "backup_catalog.h"
+#include "collect.h"
+#include "conflict_manager.h"
+#include "state_db.h"
+#include "strmap.h"
+#include "symlink_engine.h"
+#include "target_lock.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define PLAN_HEADER "# dotmgr plan v1"
+#define PLAN_NO_OP SIZE_MAX
+
+typedef enum {
+    OP_PENDING,
+    OP_DONE,
+    OP_FAILED,
+    OP_SKIPPED
+} OpState;
+
+typedef struct {
+    Plan *plan;
+    StrMap dirs;
+} PlanBuilder;
+
+static const char *op_names[] = {"mkdir", "backup", "unlink", "symlink", "copy", "restore"};
+
+static char *dup_string(const char *value) {
+    if (!value) {
+        return NULL;
+    }
+    size_t len = strlen(value);
+    char *copy = malloc(len + 1);
+    if (copy) {
+        memcpy(copy, value, len + 1);
+    }
+    return copy;
+}
+
+static void free_expect(PlanExpect *expect) {
+    free(expect->link_target);
+    expect->link_target = NULL;
+}
+
+void plan_free(Plan *plan) {
+    if (!plan) {
+        return;
+    }
+    for (size_t i = 0; i < plan->count; ++i) {
+        free(plan->ops[i].path);
+        free(plan->ops[i].arg);
+        free(plan->ops[i].deps);
+        free_expect(&plan->ops[i].expect);
+    }
+    free(plan->ops);
+    plan->ops = NULL;
+    plan->count = 0;
+    plan->capacity = 0;
+}
+
+static size_t plan_add(Plan *plan, PlanOpType type, const char *path, const char *arg, const PlanExpect *expect) {
+    if (plan->count == plan->capacity) {
+        size_t next = plan->capacity ? plan->capacity * 2 : 16;
+        PlanOp *tmp = realloc(plan->ops, next * sizeof(PlanOp));
+        if (!tmp) {
+            return PLAN_NO_OP;
+        }
+        plan->ops = tmp;
+        plan->capacity = next;
+    }
+    PlanOp *op = &plan->ops[plan->count];
+    memset(op, 0, sizeof(*op));
+    op->type = type;
+    op->path = dup_string(path);
+    op->arg = dup_string(arg);
+    if (expect) {
+        op->expect = *expect;
+    }
+    if (!op->path || (arg && !op->arg)) {
+        free(op->path);
+        free(op->arg);
+        return PLAN_NO_OP;
+    }
+    return plan->count++;
+}
+
+static bool plan_add_dep(Plan *plan, size_t id, size_t dep) {
+    if (dep == PLAN_NO_OP) {
+        return true;
+    }
+    PlanOp *op = &plan->ops[id];
+    size_t *tmp = realloc(op->deps, (op->dep_count + 1) * sizeof(size_t));
+    if (!tmp) {
+        return false;
+    }
+    op->deps = tmp;
+    op->deps[op->dep_count++] = dep;
+    return true;
+}
+
+static bool capture_expect(const char *path, PlanExpect *expect) {
+    memset(expect, 0, sizeof(*expect));
+#ifndef _WIN32
+    struct stat st;
+    if (lstat(path, &st) != 0) {
+        if (errno == ENOENT) {
+            expect->kind = PLAN_EXPECT_ABSENT;
+            return true;
+        }
+        log_error("Erro ao verificar '%s': %s", path, strerror(errno));
+        return false;
+    }
+    if (S_ISLNK(st.st_mode)) {
+        char buffer[PATH_MAX];
+        if (!read_symlink_target(path, buffer, sizeof(buffer))) {
+            return false;
+        }
+        expect->kind = PLAN_EXPECT_LINK;
+        expect->link_target = dup_string(buffer);
+        return expect->link_target != NULL;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        expect->kind = PLAN_EXPECT_DIR;
+        return true;
+    }
+    expect->kind = PLAN_EXPECT_FILE;
+    expect->size = (long long)st.st_size;
+    expect->mtime = (long long)st.st_mtime;
+    return true;
+#else
+    char buffer[PATH_MAX];
+    if (read_symlink_target(path, buffer, sizeof(buffer))) {
+        expect->kind = PLAN_EXPECT_LINK;
+        expect->link_target = dup_string(buffer);
+        return expect->link_target != NULL;
+    }
+    struct _stat64i32 st;
+    if (_stat(path, &st) != 0) {
+        expect->kind = PLAN_EXPECT_ABSENT;
+        return true;
+    }
+    if (st.st_mode & _S_IFDIR) {
+        expect->kind = PLAN_EXPECT_DIR;
+        return true;
+    }
+    expect->kind = PLAN_EXPECT_FILE;
+    expect->size = (long long)st.st_size;
+    expect->mtime = (long long)st.st_mtime;
+    return true;
+#endif
+}
+
+static bool expect_matches(const char *path, const PlanExpect *expected) {
+    if (expected->kind == PLAN_EXPECT_ANY) {
+        return true;
+    }
+    PlanExpect current;
+    if (!capture_expect(path, &current)) {
+        return false;
+    }
+    bool ok = current.kind == expected->kind;
+    if (ok && expected->kind == PLAN_EXPECT_FILE) {
+        ok = current.size == expected->size && current.mtime == expected->mtime;
+    }
+    if (ok && expected->kind == PLAN_EXPECT_LINK) {
+        ok = expected->link_target && strcmp(current.link_target, expected->link_target) == 0;
+    }
+    free_expect(&current);
+    return ok;
+}
+
+/* Em *parent_op fica o mkdir do diretório mais próximo criado pelo plano, ou PLAN_NO_OP se todos já existem. */
+static bool plan_parent_dirs(PlanBuilder *builder, const char *path, size_t *parent_op) {
+    char buffer[PATH_MAX];
+    if (snprintf(buffer, sizeof(buffer), "%s", path) >= (int)sizeof(buffer)) {
+        log_error("Caminho muito longo: %s", path);
+        return false;
+    }
+    size_t last = PLAN_NO_OP;
+    for (size_t i = 1; buffer[i]; ++i) {
+        if (buffer[i] != '/' && buffer[i] != '\\') {
+            continue;
+        }
+        char saved = buffer[i];
+        buffer[i] = '\0';
+        size_t known;
+        if (strmap_get(&builder->dirs, buffer, &known)) {
+            last = known;
+        } else if (path_exists(buffer)) {
+            if (!strmap_put(&builder->dirs, buffer, PLAN_NO_OP)) {
+                return false;
+            }
+            last = PLAN_NO_OP;
+        } else {
+            PlanExpect expect = {PLAN_EXPECT_ABSENT, 0, 0, NULL};
+            size_t id = plan_add(builder->plan, PLAN_OP_MKDIR, buffer, NULL, &expect);
+            if (id == PLAN_NO_OP || !plan_add_dep(builder->plan, id, last) ||
+                !strmap_put(&builder->dirs, buffer, id)) {
+                return false;
+            }
+            last = id;
+        }
+        buffer[i] = saved;
+    }
+    *parent_op = last;
+    return true;
+}
+
+static bool plan_install_entry(PlanBuilder *builder, const AppOptions *opts, const DotfileEntry *entry, size_t after) {
+    Plan *plan = builder->plan;
+    PlanExpect current;
+    if (!capture_expect(entry->target_path, &current)) {
+        return false;
+    }
+    if (current.kind == PLAN_EXPECT_LINK && strcmp(current.link_target, entry->source_path) == 0) {
+        if (opts->verbose) {
+            log_info("Symlink já atualizado: %s", entry->target_path);
+        }
+        free_expect(&current);
+        return true;
+    }
+
+    size_t clear_op = PLAN_NO_OP;
+    if (current.kind != PLAN_EXPECT_ABSENT) {
+        if (current.kind == PLAN_EXPECT_FILE && conflict_same_content(entry->target_path, entry->source_path)) {
+            clear_op = plan_add(plan, PLAN_OP_UNLINK, entry->target_path, NULL, &current);
+        } else if (opts->conflict_mode == CONFLICT_BACKUP) {
+            char backup[PATH_MAX];
+            if (snprintf(backup, sizeof(backup), "%s.bak", entry->target_path) >= (int)sizeof(backup)) {
+                log_error("Caminho de backup muito longo para '%s'", entry->target_path);
+                free_expect(&current);
+                return false;
+            }
+            if (path_exists(backup)) {
+                log_warn("Backup já existe para '%s', pulando", entry->target_path);
+                free_expect(&current);
+                return false;
+            }
+            clear_op = plan_add(plan, PLAN_OP_BACKUP, entry->target_path, backup, &current);
+        } else if (opts->conflict_mode == CONFLICT_FORCE) {
+            clear_op = plan_add(plan, PLAN_OP_UNLINK, entry->target_path, NULL, &current);
+        } else {
+            log_error("Modos interativo e batch não podem ser planejados: %s", entry->target_path);
+            free_expect(&current);
+            return false;
+        }
+        if (clear_op == PLAN_NO_OP) {
+            free_expect(&current);
+            return false;
+        }
+        if (!plan_add_dep(plan, clear_op, after)) {
+            return false;
+        }
+    }
+
+    size_t parent_op;
+    if (!plan_parent_dirs(builder, entry->target_path, &parent_op)) {
+        return false;
+    }
+    PlanExpect absent = {PLAN_EXPECT_ABSENT, 0, 0, NULL};
+    size_t link_op = plan_add(plan, PLAN_OP_SYMLINK, entry->target_path, entry->source_path, &absent);
+    if (link_op == PLAN_NO_OP) {
+        return false;
+    }
+    plan->ops[link_op].is_directory = entry->is_directory;
+    return plan_add_dep(plan, link_op, parent_op) &&
+        plan_add_dep(plan, link_op, clear_op != PLAN_NO_OP ? clear_op : after);
+}
+
+/* Com --restore, o backup catalogado volta ao destino depois do unlink (ou já, se o destino não existe). */
+static bool plan_restore(Plan *plan, const AppOptions *opts, const DotfileEntry *entry, size_t after) {
+    char backup[PATH_MAX];
+    if (!opts->restore_backups || !backup_catalog_lookup(opts, entry->target_path, backup, sizeof(backup))) {
+        return true;
+    }
+    if (!path_exists(backup)) {
+        log_warn("Backup catalogado não existe mais: %s", backup);
+        return true;
+    }
+    PlanExpect absent = {PLAN_EXPECT_ABSENT, 0, 0, NULL};
+    size_t id = plan_add(plan, PLAN_OP_RESTORE, entry->target_path, backup, &absent);
+    if (id == PLAN_NO_OP) {
+        return false;
+    }
+    plan->ops[id].is_directory = entry->is_directory;
+    return plan_add_dep(plan, id, after);
+}
+
+static bool plan_uninstall_entry(Plan *plan, const AppOptions *opts, const DotfileEntry *entry) {
+    PlanExpect current;
+    if (!capture_expect(entry->target_path, &current)) {
+        return false;
+    }
+    if (current.kind == PLAN_EXPECT_ABSENT) {
+        if (opts->verbose) {
+            log_info("Destino inexistente: %s", entry->target_path);
+        }
+        return plan_restore(plan, opts, entry, PLAN_NO_OP);
+    }
+    if (current.kind != PLAN_EXPECT_LINK) {
+        log_warn("Destino %s não é symlink, pulando", entry->target_path);
+        free_expect(&current);
+        return true;
+    }
+    if (strcmp(current.link_target, entry->source_path) != 0) {
+        log_warn("Symlink %s aponta para outro target, pulando", entry->target_path);
+        free_expect(&current);
+        return true;
+    }
+    size_t id = plan_add(plan, PLAN_OP_UNLINK, entry->target_path, NULL, &current);
+    if (id == PLAN_NO_OP) {
+        free_expect(&current);
+        return false;
+    }
+    plan->ops[id].is_directory = entry->is_directory;
+    return plan_restore(plan, opts, entry, id);
+}
+
+static bool plan_collect_entry(PlanBuilder *builder, const AppOptions *opts, const DotfileEntry *entry) {
+    if (!path_exists(entry->target_path)) {
+        log_warn("Destino ausente ao coletar: %s", entry->target_path);
+        return true;
+    }
+    if (is_same_symlink_target(entry->target_path, entry->source_path)) {
+        if (opts->verbose) {
+            log_info("Symlink já atualizado: %s", entry->target_path);
+        }
+        return true;
+    }
+    PlanExpect any = {PLAN_EXPECT_ANY, 0, 0, NULL};
+    size_t copy_op = plan_add(builder->plan, PLAN_OP_COPY, entry->source_path, entry->target_path, &any);
+    if (copy_op == PLAN_NO_OP) {
+        return false;
+    }
+    builder->plan->ops[copy_op].is_directory = entry->is_directory;
+    return plan_install_entry(builder, opts, entry, copy_op);
+}
+
+bool plan_build(const AppOptions *opts, const DotfileConfig *config, CommandType command, Plan *plan) {
+    if (!opts || !config || !plan) {
+        return false;
+    }
+    memset(plan, 0, sizeof(*plan));
+    PlanBuilder builder;
+    builder.plan = plan;
+    if (!strmap_init(&builder.dirs, config->count)) {
+        return false;
+    }
+    bool success = true;
+    for (size_t i = 0; i < config->count; ++i) {
+        const DotfileEntry *entry = &config->entries[i];
+        bool result = false;
+        if (entry->mode != DEPLOY_LINK) {
+            log_warn("Entrada %zu (%s) não é symlink e não entra no plano", i + 1, entry->target_path);
+            continue;
+        }
+        switch (command) {
+            case CMD_INSTALL:
+                result = plan_install_entry(&builder, opts, entry, PLAN_NO_OP);
+                break;
+            case CMD_UNINSTALL:
+                result = plan_uninstall_entry(plan, opts, entry);
+                break;
+            case CMD_COLLECT:
+                result = plan_collect_entry(&builder, opts, entry);
+                break;
+            default:
+                log_error("Comando não suportado em plan");
+                strmap_free(&builder.dirs);
+                return false;
+        }
+        if (!result) {
+            success = false;
+            log_error("Falha ao planejar entrada %zu", i + 1);
+        }
+    }
+    strmap_free(&builder.dirs);
+    return success;
+}
+
+static bool has_separator(const char *value) {
+    return value && strpbrk(value, "\t\n") != NULL;
+}
+
+static void write_expect(const PlanExpect *expect, FILE *out) {
+    switch (expect->kind) {
+        case PLAN_EXPECT_ANY:
+            fputs("any", out);
+            break;
+        case PLAN_EXPECT_ABSENT:
+            fputs("absent", out);
+            break;
+        case PLAN_EXPECT_DIR:
+            fputs("dir", out);
+            break;
+        case PLAN_EXPECT_FILE:
+            fprintf(out, "file:%lld:%lld", expect->size, expect->mtime);
+            break;
+        case PLAN_EXPECT_LINK:
+            fprintf(out, "link:%s", expect->link_target ? expect->link_target : "");
+            break;
+    }
+}
+
+bool plan_write(const Plan *plan, FILE *out) {
+    if (!plan || !out) {
+        return false;
+    }
+    fprintf(out, "%s\n", PLAN_HEADER);
+    for (size_t i = 0; i < plan->count; ++i) {
+        const PlanOp *op = &plan->ops[i];
+        if (has_separator(op->path) || has_separator(op->arg) || has_separator(op->expect.link_target)) {
+            log_error("Caminho com tab/quebra de linha não pode ser serializado: %s", op->path);
+            return false;
+        }
+        fprintf(out, "%zu\t%s\t", i, op_names[op->type]);
+        if (op->dep_count == 0) {
+            fputc('-', out);
+        }
+        for (size_t d = 0; d < op->dep_count; ++d) {
+            fprintf(out, d ? ",%zu" : "%zu", op->deps[d]);
+        }
+        fprintf(out, "\t%c\t", op->is_directory ? 'd' : '-');
+        write_expect(&op->expect, out);
+        fprintf(out, "\t%s\t%s\n", op->path, op->arg ? op->arg : "-");
+    }
+    return fflush(out) == 0 && !ferror(out);
+}
+
+static bool parse_op_type(const char *value, PlanOpType *type) {
+    for (size_t i = 0; i < sizeof(op_names) / sizeof(op_names[0]); ++i) {
+        if (strcmp(value, op_names[i]) == 0) {
+            *type = (PlanOpType)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_expect(const char *value, PlanExpect *expect) {
+    memset(expect, 0, sizeof(*expect));
+    if (strcmp(value, "any") == 0) {
+        expect->kind = PLAN_EXPECT_ANY;
+        return true;
+    }
+    if (strcmp(value, "absent") == 0) {
+        expect->kind = PLAN_EXPECT_ABSENT;
+        return true;
+    }
+    if (strcmp(value, "dir") == 0) {
+        expect->kind = PLAN_EXPECT_DIR;
+        return true;
+    }
+    if (strncmp(value, "file:", 5) == 0) {
+        expect->kind = PLAN_EXPECT_FILE;
+        return sscanf(value + 5, "%lld:%lld", &expect->size, &expect->mtime) == 2;
+    }
+    if (strncmp(value, "link:", 5) == 0) {
+        expect->kind = PLAN_EXPECT_LINK;
+        expect->link_target = dup_string(value + 5);
+        return expect->link_target != NULL;
+    }
+    return false;
+}
+
+static size_t split_fields(char *line, char **fields, size_t max_fields) {
+    size_t count = 0;
+    char *cursor = line;
+    while (count < max_fields) {
+        fields[count++] = cursor;
+        char *tab = strchr(cursor, '\t');
+        if (!tab) {
+            break;
+        }
+        *tab = '\0';
+        cursor = tab + 1;
+    }
+    return count;
+}
+
+static bool parse_deps(Plan *plan, size_t id, char *value) {
+    if (strcmp(value, "-") == 0) {
+        return true;
+    }
+    char *cursor = value;
+    while (*cursor) {
+        char *end = NULL;
+        unsigned long long dep = strtoull(cursor, &end, 10);
+        if (end == cursor || dep >= id) {
+            return false;
+        }
+        if (!plan_add_dep(plan, id, (size_t)dep)) {
+            return false;
+        }
+        cursor = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+bool plan_read(FILE *in, Plan *plan) {
+    if (!in || !plan) {
+        return false;
+    }
+    memset(plan, 0, sizeof(*plan));
+    char line[3 * PATH_MAX + 128];
+    size_t line_number = 0;
+    bool header_seen = false;
+    while (fgets(line, sizeof(line), in)) {
+        ++line_number;
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (!header_seen) {
+            if (strcmp(line, PLAN_HEADER) != 0) {
+                log_error("Arquivo de plano inválido (cabeçalho ausente)");
+                return false;
+            }
+            header_seen = true;
+            continue;
+        }
+        if (len == 0) {
+            continue;
+        }
+        char *fields[7];
+        PlanOpType type;
+        PlanExpect expect;
+        if (split_fields(line, fields, 7) != 7 ||
+            strtoull(fields[0], NULL, 10) != plan->count ||
+            !parse_op_type(fields[1], &type) ||
+            !parse_expect(fields[4], &expect)) {
+            log_error("Plano inválido na linha %zu", line_number);
+            plan_free(plan);
+            return false;
+        }
+        const char *arg = strcmp(fields[6], "-") == 0 ? NULL : fields[6];
+        size_t id = plan_add(plan, type, fields[5], arg, &expect);
+        if (id == PLAN_NO_OP) {
+            free_expect(&expect);
+            plan_free(plan);
+            return false;
+        }
+        plan->ops[id].is_directory = fields[3][0] == 'd';
+        if (!parse_deps(plan, id, fields[2])) {
+            log_error("Dependências inválidas na linha %zu", line_number);
+            plan_free(plan);
+            return false;
+        }
+    }
+    if (!header_seen) {
+        log_error("Arquivo de plano vazio");
+        return false;
+    }
+    return true;
+}
+
+static bool verify_preconditions(const Plan *plan, bool *first_touch) {
+    StrMap touched;
+    if (!strmap_init(&touched, plan->count)) {
+        return false;
+    }
+    bool ok = true;
+    for (size_t i = 0; i < plan->count; ++i) {
+        const PlanOp *op = &plan->ops[i];
+        first_touch[i] = !strmap_get(&touched, op->path, NULL);
+        strmap_put(&touched, op->path, i);
+        if (op->type == PLAN_OP_RESTORE && (!op->arg || !path_exists(op->arg))) {
+            log_error("Backup a restaurar não existe mais: %s", op->arg ? op->arg : "-");
+            ok = false;
+        }
+        if (!first_touch[i]) {
+            continue;
+        }
+        if (!expect_matches(op->path, &op->expect)) {
+            log_error("Pré-condição mudou desde o plano: %s %s", op_names[op->type], op->path);
+            ok = false;
+            continue;
+        }
+        if (op->type == PLAN_OP_BACKUP && op->arg && !strmap_get(&touched, op->arg, NULL) && path_exists(op->arg)) {
+            log_error("Backup já existe: %s", op->arg);
+            ok = false;
+        }
+        if (op->type == PLAN_OP_COPY && (!op->arg || !path_exists(op->arg))) {
+            log_error("Origem da cópia não existe mais: %s", op->arg ? op->arg : "-");
+            ok = false;
+        }
+    }
+    strmap_free(&touched);
+    return ok;
+}
+
+static bool execute_op(const AppOptions *opts, const PlanOp *op, bool first_touch) {
+    if (!first_touch && !opts->dry_run && !expect_matches(op->path, &op->expect)) {
+        log_error("Estado inesperado ao executar %s %s", op_names[op->type], op->path);
+        return false;
+    }
+    DotfileEntry entry;
+    switch (op->type) {
+        case PLAN_OP_MKDIR:
+            if (opts->dry_run) {
+                log_info("[dry-run] mkdir %s", op->path);
+                return true;
+            }
+            return create_dir_if_missing(op->path);
+        case PLAN_OP_BACKUP:
+            return conflict_backup(opts, op->path);
+        case PLAN_OP_UNLINK:
+            if (op->expect.kind != PLAN_EXPECT_LINK) {
+                return conflict_remove(opts, op->path);
+            }
+            /* fallthrough */
+        case PLAN_OP_SYMLINK:
+            memset(&entry, 0, sizeof(entry));
+            snprintf(entry.target_path, sizeof(entry.target_path), "%s", op->path);
+            snprintf(entry.source_path, sizeof(entry.source_path), "%s", op->arg ? op->arg : "");
+            entry.is_directory = op->is_directory;
+            if (op->type == PLAN_OP_UNLINK) {
+                if (!remove_entry_symlink(&entry, opts->dry_run)) {
+                    return false;
+                }
+                state_db_forget(opts, op->path);
+                return true;
+            }
+            if (!create_entry_symlink(&entry, opts->dry_run)) {
+                return false;
+            }
+            state_db_record(opts, STATE_LINK, op->path, entry.source_path);
+            return true;
+        case PLAN_OP_COPY:
+            return collect_copy_tree(opts, op->arg, op->path);
+        case PLAN_OP_RESTORE:
+            return op->arg && backup_catalog_restore_from(opts, op->path, op->arg);
+    }
+    return false;
+}
+
+typedef struct {
+    const AppOptions *opts;
+    const Plan *plan;
+    const bool *first_touch;
+    unsigned char *state;
+    const size_t *batch;
+    size_t batch_count;
+    atomic_size_t next;
+} ApplyBatch;
+
+static void *apply_worker(void *arg) {
+    ApplyBatch *batch = arg;
+    for (;;) {
+        size_t index = atomic_fetch_add(&batch->next, 1);
+        if (index >= batch->batch_count) {
+            break;
+        }
+        size_t id = batch->batch[index];
+        const PlanOp *op = &batch->plan->ops[id];
+        bool blocked = false;
+        for (size_t d = 0; d < op->dep_count; ++d) {
+            if (batch->state[op->deps[d]] != OP_DONE) {
+                blocked = true;
+                break;
+            }
+        }
+        if (blocked) {
+            log_warn("Pulando %s %s (dependência falhou)", op_names[op->type], op->path);
+            batch->state[id] = OP_SKIPPED;
+            continue;
+        }
+        TargetLock lock;
+        target_lock_acquire(batch->opts, op->path, &lock);
+        batch->state[id] = execute_op(batch->opts, op, batch->first_touch[id]) ? OP_DONE : OP_FAILED;
+        target_lock_release(&lock);
+    }
+    return NULL;
+}
+
+static void run_batch(ApplyBatch *batch, int jobs) {
+    if (jobs > (int)batch->batch_count) {
+        jobs = (int)batch->batch_count;
+    }
+    atomic_init(&batch->next, 0);
+    if (jobs <= 1) {
+        apply_worker(batch);
+        return;
+    }
+    pthread_t *threads = calloc((size_t)jobs, sizeof(pthread_t));
+    int started = 0;
+    if (threads) {
+        for (; started < jobs; ++started) {
+            if (pthread_create(&threads[started], NULL, apply_worker, batch) != 0) {
+                break;
+            }
+        }
+    }
+    if (started == 0) {
+        apply_worker(batch);
+    }
+    for (int i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
+
+bool plan_apply(const AppOptions *opts, const Plan *plan) {
+    if (!opts || !plan) {
+        return false;
+    }
+    if (plan->count == 0) {
+        log_info("Plano vazio, nada a fazer");
+        return true;
+    }
+    bool *first_touch = calloc(plan->count, sizeof(bool));
+    unsigned char *state = calloc(plan->count, 1);
+    size_t *level = calloc(plan->count, sizeof(size_t));
+    size_t *order = calloc(plan->count, sizeof(size_t));
+    if (!first_touch || !state || !level || !order) {
+        free(first_touch);
+        free(state);
+        free(level);
+        free(order);
+        return false;
+    }
+
+    bool ok = verify_preconditions(plan, first_touch);
+    if (!ok) {
+        log_error("Plano desatualizado; gere um novo com 'dotmgr plan'");
+    }
+
+    size_t max_level = 0;
+    for (size_t i = 0; ok && i < plan->count; ++i) {
+        for (size_t d = 0; d < plan->ops[i].dep_count; ++d) {
+            size_t dep_level = level[plan->ops[i].deps[d]] + 1;
+            if (dep_level > level[i]) {
+                level[i] = dep_level;
+            }
+        }
+        if (level[i] > max_level) {
+            max_level = level[i];
+        }
+    }
+
+    int jobs = opts->jobs > 0 ? opts->jobs : default_job_count();
+    for (size_t current = 0; ok && current <= max_level; ++current) {
+        size_t count = 0;
+        for (size_t i = 0; i < plan->count; ++i) {
+            if (level[i] == current) {
+                order[count++] = i;
+            }
+        }
+        ApplyBatch batch;
+        batch.opts = opts;
+        batch.plan = plan;
+        batch.first_touch = first_touch;
+        batch.state = state;
+        batch.batch = order;
+        batch.batch_count = count;
+        run_batch(&batch, jobs);
+        /* Cópias deste nível ficam duráveis antes que o próximo substitua os originais por elas. */
+        if (!collect_sync(opts)) {
+            ok = false;
+        }
+    }
+
+    for (size_t i = 0; ok && i < plan->count; ++i) {
+        if (state[i] != OP_DONE) {
+            ok = false;
+        }
+    }
+    free(first_touch);
+    free(state);
+    free(level);
+    free(order);
+    return ok;
+}
@@ -0,0 +1,341 @@
+#include "profile.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dotmgr.h"
+#include "trace.h"
+#include "utils.h"
+
+#define HISTOGRAM_BUCKETS 64
+#define HISTOGRAM_BAR 30
+#define NO_PHASE PROFILE_PHASE_COUNT
+
+typedef struct {
+    atomic_uint_least64_t count;
+    atomic_uint_least64_t total_ns;
+    atomic_uint_least64_t max_ns;
+    atomic_uint_least64_t buckets[HISTOGRAM_BUCKETS];
+} PhaseStats;
+
+typedef struct {
+    uint64_t ns;
+    char target[PATH_MAX];
+} SlowEntry;
+
+static const char *phase_names[PROFILE_PHASE_COUNT] = {
+    "main",
+    "load_config",
+    "normalize_path",
+    "entry",
+    "install_entry",
+    "collect_entry",
+    "resolve_conflict",
+    "mkdir",
+    "symlink",
+    "copy",
+    "sync",
+    "git_auto_sync",
+    "git",
+};
+
+static const char *phase_categories[PROFILE_PHASE_COUNT] = {
+    "run",
+    "config",
+    "fs",
+    "entry",
+    "entry",
+    "entry",
+    "conflict",
+    "fs",
+    "fs",
+    "fs",
+    "fs",
+    "git",
+    "git",
+};
+
+static const char *fs_names[PROFILE_FS_COUNT] = {
+    "access",
+    "stat",
+    "lstat",
+    "readlink",
+    "realpath",
+    "mkdir",
+    "symlink",
+    "unlink",
+    "rename",
+    "open",
+    "opendir",
+};
+
+static bool profiling;
+static bool recording;
+static PhaseStats phases[PROFILE_PHASE_COUNT];
+static atomic_uint_least64_t fs_counts[PROFILE_PHASE_COUNT + 1][PROFILE_FS_COUNT];
+static SlowEntry slowest[PROFILE_SLOWEST_ENTRIES];
+static size_t slowest_count;
+static pthread_mutex_t slowest_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local ProfilePhase current_phase = NO_PHASE;
+
+void profile_enable(bool enabled) {
+    profiling = enabled;
+}
+
+bool profile_enabled(void) {
+    return profiling;
+}
+
+void profile_reset(void) {
+    for (int i = 0; i < PROFILE_PHASE_COUNT; ++i) {
+        PhaseStats *stats = &phases[i];
+        atomic_store(&stats->count, 0);
+        atomic_store(&stats->total_ns, 0);
+        atomic_store(&stats->max_ns, 0);
+        for (unsigned b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+            atomic_store(&stats->buckets[b], 0);
+        }
+    }
+    for (int i = 0; i <= PROFILE_PHASE_COUNT; ++i) {
+        for (int c = 0; c < PROFILE_FS_COUNT; ++c) {
+            atomic_store(&fs_counts[i][c], 0);
+        }
+    }
+    pthread_mutex_lock(&slowest_lock);
+    slowest_count = 0;
+    pthread_mutex_unlock(&slowest_lock);
+}
+
+void profile_record(bool enabled) {
+    recording = enabled;
+}
+
+const char *profile_phase_name(ProfilePhase phase) {
+    return phase < PROFILE_PHASE_COUNT ? phase_names[phase] : "?";
+}
+
+bool profile_phase_totals(ProfilePhase phase, uint64_t *count, uint64_t *total_ns) {
+    if (phase >= PROFILE_PHASE_COUNT) {
+        return false;
+    }
+    *count = atomic_load(&phases[phase].count);
+    *total_ns = atomic_load(&phases[phase].total_ns);
+    return *count > 0;
+}
+
+static unsigned bucket_for(uint64_t ns) {
+    unsigned bucket = 0;
+    while (ns > 1) {
+        ns >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+void profile_begin(ProfileSpan *span, ProfilePhase phase) {
+    span->phase = phase;
+    span->parent = current_phase;
+    span->start = 0;
+    if (!profiling && !recording && !trace_enabled()) {
+        return;
+    }
+    current_phase = phase;
+    span->start = monotonic_ns();
+}
+
+static uint64_t finish_span(ProfileSpan *span, const char *name, const char *detail) {
+    if (!span->start) {
+        return 0;
+    }
+    uint64_t elapsed = monotonic_ns() - span->start;
+    current_phase = span->parent;
+    if (trace_enabled()) {
+        trace_complete(name ? name : phase_names[span->phase], phase_categories[span->phase], span->start, elapsed,
+                       detail);
+    }
+    span->start = 0;
+    if (!profiling && !recording) {
+        return elapsed;
+    }
+
+    PhaseStats *stats = &phases[span->phase];
+    atomic_fetch_add(&stats->count, 1);
+    atomic_fetch_add(&stats->total_ns, elapsed);
+    atomic_fetch_add(&stats->buckets[bucket_for(elapsed)], 1);
+    uint64_t max = atomic_load(&stats->max_ns);
+    while (elapsed > max && !atomic_compare_exchange_weak(&stats->max_ns, &max, elapsed)) {
+    }
+    return elapsed;
+}
+
+uint64_t profile_end(ProfileSpan *span) {
+    return finish_span(span, NULL, NULL);
+}
+
+void profile_end_detail(ProfileSpan *span, const char *detail) {
+    finish_span(span, NULL, detail);
+}
+
+void profile_end_entry(ProfileSpan *span, const char *target) {
+    uint64_t elapsed = finish_span(span, target, NULL);
+    if (!elapsed || !target || !profiling) {
+        return;
+    }
+    pthread_mutex_lock(&slowest_lock);
+    size_t slot = slowest_count;
+    if (slowest_count < PROFILE_SLOWEST_ENTRIES) {
+        ++slowest_count;
+    } else {
+        slot = 0;
+        for (size_t i = 1; i < slowest_count; ++i) {
+            if (slowest[i].ns < slowest[slot].ns) {
+                slot = i;
+            }
+        }
+        if (slowest[slot].ns >= elapsed) {
+            slot = PROFILE_SLOWEST_ENTRIES;
+        }
+    }
+    if (slot < PROFILE_SLOWEST_ENTRIES) {
+        slowest[slot].ns = elapsed;
+        snprintf(slowest[slot].target, sizeof(slowest[slot].target), "%s", target);
+    }
+    pthread_mutex_unlock(&slowest_lock);
+}
+
+/* Só conta; chamado por fs_op, que também cobra o --iops. */
+void profile_fs(ProfileFsCall call) {
+    if (profiling) {
+        atomic_fetch_add(&fs_counts[current_phase][call], 1);
+    }
+}
+
+static const char *format_ns(uint64_t ns, char *buffer, size_t len) {
+    if (ns < 1000ULL) {
+        snprintf(buffer, len, "%lluns", (unsigned long long)ns);
+    } else if (ns < 1000000ULL) {
+        snprintf(buffer, len, "%.1fus", (double)ns / 1e3);
+    } else if (ns < 1000000000ULL) {
+        snprintf(buffer, len, "%.2fms", (double)ns / 1e6);
+    } else {
+        snprintf(buffer, len, "%.2fs", (double)ns / 1e9);
+    }
+    return buffer;
+}
+
+static uint64_t percentile(const PhaseStats *stats, uint64_t count, double fraction) {
+    uint64_t wanted = (uint64_t)((double)count * fraction);
+    if (wanted == 0) {
+        wanted = 1;
+    }
+    uint64_t seen = 0;
+    uint64_t max = atomic_load(&stats->max_ns);
+    for (unsigned b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+        seen += atomic_load(&stats->buckets[b]);
+        if (seen >= wanted) {
+            uint64_t upper = b >= 63 ? UINT64_MAX : (1ULL << (b + 1));
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+static void report_phases(FILE *out) {
+    char total[32], avg[32], p50[32], p99[32], max[32];
+    fprintf(out, "%-17s %8s %10s %11s %10s %10s %11s\n", "fase", "chamadas", "total", "média", "p50", "p99", "máx");
+    for (int i = 0; i < PROFILE_PHASE_COUNT; ++i) {
+        const PhaseStats *stats = &phases[i];
+        uint64_t count = atomic_load(&stats->count);
+        if (count == 0) {
+            continue;
+        }
+        uint64_t total_ns = atomic_load(&stats->total_ns);
+        fprintf(out, "%-17s %8llu %10s %10s %10s %10s %10s\n", phase_names[i], (unsigned long long)count,
+                format_ns(total_ns, total, sizeof(total)),
+                format_ns(total_ns / count, avg, sizeof(avg)),
+                format_ns(percentile(stats, count, 0.5), p50, sizeof(p50)),
+                format_ns(percentile(stats, count, 0.99), p99, sizeof(p99)),
+                format_ns(atomic_load(&stats->max_ns), max, sizeof(max)));
+    }
+}
+
+static void report_fs_calls(FILE *out) {
+    fprintf(out, "\nChamadas ao sistema de arquivos por fase:\n");
+    for (int i = 0; i <= PROFILE_PHASE_COUNT; ++i) {
+        bool any = false;
+        for (int c = 0; c < PROFILE_FS_COUNT; ++c) {
+            uint64_t count = atomic_load(&fs_counts[i][c]);
+            if (count == 0) {
+                continue;
+            }
+            if (!any) {
+                fprintf(out, "  %-17s", i == NO_PHASE ? "(fora de fase)" : phase_names[i]);
+                any = true;
+            }
+            fprintf(out, " %s=%llu", fs_names[c], (unsigned long long)count);
+        }
+        if (any) {
+            fputc('\n', out);
+        }
+    }
+}
+
+static void report_histograms(FILE *out) {
+    char low[32], high[32];
+    for (int i = 0; i < PROFILE_PHASE_COUNT; ++i) {
+        const PhaseStats *stats = &phases[i];
+        if (atomic_load(&stats->count) < 2) {
+            continue;
+        }
+        uint64_t peak = 0;
+        for (unsigned b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+            uint64_t n = atomic_load(&stats->buckets[b]);
+            peak = n > peak ? n : peak;
+        }
+        fprintf(out, "\nLatência de %s:\n", phase_names[i]);
+        for (unsigned b = 0; b < HISTOGRAM_BUCKETS - 1; ++b) {
+            uint64_t n = atomic_load(&stats->buckets[b]);
+            if (n == 0) {
+                continue;
+            }
+            int width = (int)((n * HISTOGRAM_BAR + peak - 1) / peak);
+            fprintf(out, "  [%9s, %9s) %8llu %.*s\n",
+                    format_ns(b ? 1ULL << b : 0, low, sizeof(low)),
+                    format_ns(1ULL << (b + 1), high, sizeof(high)),
+                    (unsigned long long)n, width, "##############################");
+        }
+    }
+}
+
+static int compare_slow(const void *a, const void *b) {
+    const SlowEntry *x = a;
+    const SlowEntry *y = b;
+    return x->ns < y->ns ? 1 : (x->ns > y->ns ? -1 : 0);
+}
+
+static void report_slowest(FILE *out) {
+    pthread_mutex_lock(&slowest_lock);
+    if (slowest_count > 0) {
+        qsort(slowest, slowest_count, sizeof(SlowEntry), compare_slow);
+        char elapsed[32];
+        fprintf(out, "\nEntradas mais lentas:\n");
+        for (size_t i = 0; i < slowest_count; ++i) {
+            fprintf(out, "  %10s  %s\n", format_ns(slowest[i].ns, elapsed, sizeof(elapsed)), slowest[i].target);
+        }
+    }
+    pthread_mutex_unlock(&slowest_lock);
+}
+
+void profile_report(FILE *out) {
+    if (!profiling || !out) {
+        return;
+    }
+    fprintf(out, "\n== Perfil de execução ==\n");
+    report_phases(out);
+    report_fs_calls(out);
+    report_histograms(out);
+    report_slowest(out);
+    fflush(out);
+}
@@ -0,0 +1,171 @@
+#define _DEFAULT_SOURCE
+
+#include "reconcile.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backup_catalog.h"
+#include "config_index.h"
+#include "state_db.h"
+#include "strmap.h"
+#include "target_lock.h"
+#include "utils.h"
+
+typedef struct {
+    char *target;
+    StateRecord record;
+} Orphan;
+
+typedef struct {
+    const StrMap *desired;
+    char repo[PATH_MAX];
+    size_t repo_len;
+    Orphan *items;
+    size_t count;
+    size_t capacity;
+    bool ok;
+} OrphanList;
+
+/* Link cujo registro bate com a origem e com o lstat atual: nada mudou desde a última instalação. */
+static bool link_unchanged(const AppOptions *opts, const DotfileEntry *entry) {
+    StateRecord record;
+    char buffer[3 * PATH_MAX];
+    return entry->mode == DEPLOY_LINK && state_db_lookup(opts, entry->target_path, &record, buffer, sizeof(buffer)) &&
+           record.kind == STATE_LINK && strcmp(record.source, entry->source_path) == 0 &&
+           state_db_matches_disk(&record);
+}
+
+static bool under_repo(const OrphanList *list, const char *source) {
+    return strncmp(source, list->repo, list->repo_len) == 0 &&
+           (source[list->repo_len] == '/' || source[list->repo_len] == '\\');
+}
+
+/* Roda com o lock do state_db: só copia os candidatos, a remoção fica para depois. */
+static bool collect_orphan(const StateRecord *record, void *user) {
+    OrphanList *list = user;
+    size_t unused;
+    if (record->kind == STATE_BACKUP || record->scope[0] || strmap_get(list->desired, record->target, &unused) ||
+        !under_repo(list, record->source)) {
+        return true;
+    }
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        Orphan *grown = realloc(list->items, capacity * sizeof(Orphan));
+        if (!grown) {
+            list->ok = false;
+            return false;
+        }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    size_t target_len = strlen(record->target) + 1;
+    size_t source_len = strlen(record->source) + 1;
+    char *copy = malloc(target_len + source_len);
+    if (!copy) {
+        list->ok = false;
+        return false;
+    }
+    memcpy(copy, record->target, target_len);
+    memcpy(copy + target_len, record->source, source_len);
+    Orphan *orphan = &list->items[list->count++];
+    orphan->target = copy;
+    orphan->record = *record;
+    orphan->record.target = copy;
+    orphan->record.source = copy + target_len;
+    orphan->record.scope = "";
+    return true;
+}
+
+/* Sob o lock do destino, como uma entrada do runner: outra execução não o recria entre a checagem e a remoção. */
+static bool prune_locked(const AppOptions *opts, const Orphan *orphan) {
+    const StateRecord *record = &orphan->record;
+    if (!state_db_matches_disk(record)) {
+        if (path_exists(record->target)) {
+            log_warn("%s mudou desde a instalação e não é mais gerenciado, mantido", record->target);
+        } else if (opts->verbose) {
+            log_info("Destino já removido: %s", record->target);
+        }
+        state_db_forget(opts, record->target);
+        return true;
+    }
+    if (opts->dry_run) {
+        log_info("[dry-run] remover %s (%s de entrada removida)", record->target, state_kind_name(record->kind));
+        return true;
+    }
+    if (remove(record->target) != 0) {
+        log_error("Falha ao remover '%s': %s", record->target, strerror(errno));
+        return false;
+    }
+    log_info("Removido (entrada saiu da config): %s", record->target);
+    state_db_forget(opts, record->target);
+    return !opts->restore_backups || backup_catalog_restore(opts, record->target);
+}
+
+static bool prune_orphan(const AppOptions *opts, const Orphan *orphan) {
+    TargetLock lock;
+    target_lock_acquire(opts, orphan->target, &lock);
+    bool ok = prune_locked(opts, orphan);
+    target_lock_release(&lock);
+    return ok;
+}
+
+static bool prune_removed(const AppOptions *opts, const StrMap *desired, RunSummary *summary) {
+    OrphanList list;
+    memset(&list, 0, sizeof(list));
+    list.desired = desired;
+    list.ok = true;
+    if (!normalize_path(opts->repo_path, list.repo, sizeof(list.repo))) {
+        log_warn("Repositório %s inacessível, poda ignorada", opts->repo_path);
+        return true;
+    }
+    list.repo_len = strlen(list.repo);
+    bool ok = state_db_each(opts, collect_orphan, &list) && list.ok;
+    for (size_t i = 0; i < list.count; ++i) {
+        ++summary->processed;
+        if (!prune_orphan(opts, &list.items[i])) {
+            ++summary->failed;
+            ok = false;
+        }
+        free(list.items[i].target);
+    }
+    free(list.items);
+    return ok;
+}
+
+bool run_reconcile(const AppOptions *opts, const DotfileConfig *config, RunSummary *summary) {
+    AppOptions install = *opts;
+    install.command = CMD_INSTALL;
+    StrMap desired;
+    if (!strmap_init(&desired, config->count)) {
+        return false;
+    }
+    bool ok = true;
+    size_t unchanged = 0;
+    for (size_t i = 0; i < config->count; ++i) {
+        const DotfileEntry *entry = &config->entries[i];
+        if (!strmap_put(&desired, entry->target_path, i)) {
+            ok = false;
+        }
+        if (link_unchanged(opts, entry)) {
+            ++unchanged;
+            ++summary->processed;
+            continue;
+        }
+        if (!run_entry(&install, config, i, summary)) {
+            ok = false;
+        }
+    }
+    if (opts->verbose) {
+        log_info("%zu de %zu entradas sem mudanças desde a última instalação", unchanged, config->count);
+    }
+    if (config_has_filter(opts)) {
+        log_warn("Com --only/--except a poda de entradas removidas não é feita");
+    } else if (ok && !prune_removed(opts, &desired, summary)) {
+        ok = false;
+    }
+    strmap_free(&desired);
+    return ok;
+}
@@ -0,0 +1,143 @@
+#include "runner.h"
+
+#include <string.h>
+
+#include "checkpoint.h"
+#include "collect.h"
+#include "conflict_batch.h"
+#include "deploy_copy.h"
+#include "profile.h"
+#include "status_report.h"
+#include "symlink_engine.h"
+#include "target_lock.h"
+#include "template_render.h"
+#include "utils.h"
+
+static RunProgress progress_fn;
+static void *progress_user;
+
+void runner_set_progress(RunProgress progress, void *user) {
+    progress_fn = progress;
+    progress_user = user;
+}
+
+static bool run_render_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry) {
+    switch (opts->command) {
+        case CMD_INSTALL:
+            return render_install_entry(opts, config, entry);
+        case CMD_UNINSTALL:
+            return render_uninstall_entry(opts, config, entry);
+        case CMD_STATUS:
+            return render_status_entry(opts, config, entry);
+        case CMD_COLLECT:
+            return render_collect_entry(opts, config, entry);
+        default:
+            return false;
+    }
+}
+
+static bool run_deploy_entry(const AppOptions *opts, const DotfileEntry *entry) {
+    switch (opts->command) {
+        case CMD_INSTALL:
+            return deploy_install_entry(opts, entry);
+        case CMD_UNINSTALL:
+            return deploy_uninstall_entry(opts, entry);
+        case CMD_STATUS:
+            return deploy_status_entry(opts, entry);
+        case CMD_COLLECT:
+            return deploy_collect_entry(opts, entry);
+        default:
+            return false;
+    }
+}
+
+static bool run_link_entry(const AppOptions *opts, const DotfileEntry *entry) {
+    switch (opts->command) {
+        case CMD_INSTALL:
+            return install_entry(opts, entry);
+        case CMD_UNINSTALL:
+            return uninstall_entry(opts, entry);
+        case CMD_STATUS:
+            return status_entry(opts, entry);
+        case CMD_COLLECT:
+            return collect_entry(opts, entry);
+        default:
+            return false;
+    }
+}
+
+bool run_entry(const AppOptions *opts, const DotfileConfig *config, size_t index, RunSummary *summary) {
+    return run_single_entry(opts, config, &config->entries[index], index + 1, summary);
+}
+
+bool run_single_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry, size_t number,
+                      RunSummary *summary) {
+    if (checkpoint_done(entry->target_path)) {
+        if (opts->verbose) {
+            log_info("Concluído na execução interrompida: %s", entry->target_path);
+        }
+        if (progress_fn) {
+            progress_fn(entry, true, progress_user);
+        }
+        ++summary->processed;
+        return true;
+    }
+    TargetLock lock;
+    target_lock_acquire(opts, entry->target_path, &lock);
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_ENTRY);
+    bool result;
+    switch (entry->mode) {
+        case DEPLOY_RENDER:
+            result = run_render_entry(opts, config, entry);
+            break;
+        case DEPLOY_COPY:
+        case DEPLOY_HARDLINK:
+            result = run_deploy_entry(opts, entry);
+            break;
+        default:
+            result = run_link_entry(opts, entry);
+            break;
+    }
+    profile_end_entry(&span, entry->target_path);
+    target_lock_release(&lock);
+    if (result) {
+        checkpoint_mark_done(entry->target_path);
+    }
+    if (progress_fn) {
+        progress_fn(entry, result, progress_user);
+    }
+    ++summary->processed;
+    if (!result) {
+        ++summary->failed;
+        if (!opts->verbose) {
+            log_error("Falha ao processar entrada %zu", number);
+        }
+    }
+    return result;
+}
+
+bool run_command(const AppOptions *opts, const DotfileConfig *config, RunSummary *summary) {
+    RunSummary local;
+    if (!summary) {
+        summary = &local;
+    }
+    memset(summary, 0, sizeof(*summary));
+    if (opts->command == CMD_STATUS && (opts->status_format != STATUS_FORMAT_TEXT || opts->prom_path[0])) {
+        return run_status_report(opts, config, summary);
+    }
+    bool success = true;
+    if (opts->conflict_mode == CONFLICT_BATCH && (opts->command == CMD_INSTALL || opts->command == CMD_COLLECT)) {
+        success = run_batch(opts, config, summary);
+    } else {
+        for (size_t i = 0; i < config->count; ++i) {
+            if (!run_entry(opts, config, i, summary)) {
+                success = false;
+            }
+        }
+    }
+    if (opts->command == CMD_COLLECT && !collect_sync(opts)) {
+        success = false;
+    }
+    return success;
+}
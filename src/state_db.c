@@ -0,0 +1,831 @@
+#define _DEFAULT_SOURCE
+
+#include "state_db.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "io_sched.h"
+#include "strmap.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define STATE_LOG "state.log"
+#define STATE_INDEX "state.idx"
+#define STATE_LOCK "state.lock"
+#define STATE_MAGIC "DMSTIDX1"
+#define STATE_VERSION 1
+#define STATE_OVERLAY_LIMIT 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t log_size;
+    uint64_t log_records;
+    uint64_t strings_size;
+} StateIndexHeader;
+
+typedef struct {
+    uint64_t hash;
+    int64_t size;
+    int64_t mtime_ns;
+    uint64_t inode;
+    uint32_t target;
+    uint32_t source;
+    uint32_t scope;
+    uint32_t kind;
+} StateIndexRecord;
+
+/* Mudanças posteriores ao snapshot; removed marca um tombstone. */
+typedef struct {
+    char *target;
+    char *source;
+    char *scope;
+    StateKind kind;
+    long long size;
+    long long mtime_ns;
+    unsigned long long inode;
+    bool removed;
+    bool pending;
+} OverlayRecord;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} ByteBuffer;
+
+typedef struct {
+    char dir[PATH_MAX];
+    bool loaded;
+    bool dirty;
+    unsigned char *map;
+    size_t map_len;
+    bool mapped;
+    const StateIndexHeader *header;
+    const StateIndexRecord *records;
+    const char *strings;
+    uint64_t log_records;
+    uint64_t log_offset;
+    unsigned long long log_inode;
+    OverlayRecord *overlay;
+    size_t overlay_count;
+    size_t overlay_capacity;
+    StrMap overlay_index;
+} StateDb;
+
+static const char *kind_names[STATE_KIND_COUNT] = {"link", "copy", "hardlink", "render", "backup"};
+
+static StateDb db;
+static pthread_mutex_t db_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local const char *current_scope = "";
+
+const char *state_kind_name(StateKind kind) {
+    return kind < STATE_KIND_COUNT ? kind_names[kind] : "unknown";
+}
+
+static bool parse_kind(const char *name, StateKind *kind) {
+    for (size_t i = 0; i < STATE_KIND_COUNT; ++i) {
+        if (strcmp(name, kind_names[i]) == 0) {
+            *kind = (StateKind)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void state_db_set_scope(const char *scope) {
+    current_scope = scope ? scope : "";
+}
+
+static uint64_t target_hash(const char *target) {
+    return hash_fnv1a64(target, strlen(target), HASH_FNV1A64_SEED);
+}
+
+static char *copy_string(const char *value) {
+    size_t len = strlen(value) + 1;
+    char *copy = malloc(len);
+    if (copy) {
+        memcpy(copy, value, len);
+    }
+    return copy;
+}
+
+static void free_overlay_record(OverlayRecord *record) {
+    free(record->target);
+    free(record->source);
+    free(record->scope);
+}
+
+static void unmap_index(void) {
+    if (db.map) {
+#ifndef _WIN32
+        if (db.mapped) {
+            munmap(db.map, db.map_len);
+        } else {
+            free(db.map);
+        }
+#else
+        free(db.map);
+#endif
+    }
+    db.map = NULL;
+    db.map_len = 0;
+    db.mapped = false;
+    db.header = NULL;
+    db.records = NULL;
+    db.strings = NULL;
+}
+
+static void db_reset(void) {
+    unmap_index();
+    for (size_t i = 0; i < db.overlay_count; ++i) {
+        free_overlay_record(&db.overlay[i]);
+    }
+    free(db.overlay);
+    strmap_free(&db.overlay_index);
+    memset(&db, 0, sizeof(db));
+}
+
+static bool db_file(const char *dir, const char *name, char *output, size_t len) {
+    return join_paths(dir, name, output, len);
+}
+
+/* Lock consultivo em state.lock: leitura ao carregar, escrita ao gravar. Assim uma execução não lê o log
+ * no meio da compactação de outra, nem reescreve o log sem as linhas que outra acabou de acrescentar.
+ * Só é tomado com db_lock em mãos, então um fd por vez no processo basta para os locks POSIX. */
+static int lock_state(const char *dir, bool exclusive) {
+#ifndef _WIN32
+    char path[PATH_MAX];
+    if (!db_file(dir, STATE_LOCK, path, sizeof(path))) {
+        return -1;
+    }
+    int fd = exclusive ? open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644) : open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct flock range;
+    memset(&range, 0, sizeof(range));
+    range.l_type = exclusive ? F_WRLCK : F_RDLCK;
+    range.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &range) != 0) {
+        if (errno != EINTR) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+#else
+    (void)dir;
+    (void)exclusive;
+    return -1;
+#endif
+}
+
+static void unlock_state(int fd) {
+#ifndef _WIN32
+    if (fd >= 0) {
+        close(fd);
+    }
+#else
+    (void)fd;
+#endif
+}
+
+static bool overlay_put(const char *target, const char *source, const char *scope, StateKind kind,
+                        long long size, long long mtime_ns, unsigned long long inode, bool removed, bool pending) {
+    size_t slot;
+    OverlayRecord *record;
+    if (strmap_get(&db.overlay_index, target, &slot)) {
+        record = &db.overlay[slot];
+        char *new_source = copy_string(source);
+        char *new_scope = copy_string(scope);
+        if (!new_source || !new_scope) {
+            free(new_source);
+            free(new_scope);
+            return false;
+        }
+        free(record->source);
+        free(record->scope);
+        record->source = new_source;
+        record->scope = new_scope;
+    } else {
+        if (db.overlay_count == db.overlay_capacity) {
+            size_t capacity = db.overlay_capacity ? db.overlay_capacity * 2 : 32;
+            OverlayRecord *grown = realloc(db.overlay, capacity * sizeof(OverlayRecord));
+            if (!grown) {
+                return false;
+            }
+            db.overlay = grown;
+            db.overlay_capacity = capacity;
+        }
+        record = &db.overlay[db.overlay_count];
+        memset(record, 0, sizeof(*record));
+        record->target = copy_string(target);
+        record->source = copy_string(source);
+        record->scope = copy_string(scope);
+        if (!record->target || !record->source || !record->scope ||
+            !strmap_put(&db.overlay_index, target, db.overlay_count)) {
+            free_overlay_record(record);
+            return false;
+        }
+        ++db.overlay_count;
+    }
+    record->kind = kind;
+    record->size = size;
+    record->mtime_ns = mtime_ns;
+    record->inode = inode;
+    record->removed = removed;
+    record->pending = record->pending || pending;
+    return true;
+}
+
+static bool map_index(const char *path) {
+#ifndef _WIN32
+    fs_op(PROFILE_FS_OPEN);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(StateIndexHeader)) {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    db.map = map;
+    db.map_len = (size_t)st.st_size;
+    db.mapped = true;
+#else
+    char *data = NULL;
+    size_t len = 0;
+    if (!read_file_contents(path, &data, &len) || len < sizeof(StateIndexHeader)) {
+        free(data);
+        return false;
+    }
+    db.map = (unsigned char *)data;
+    db.map_len = len;
+#endif
+    const StateIndexHeader *header = (const StateIndexHeader *)db.map;
+    size_t expected = sizeof(StateIndexHeader) + (size_t)header->count * sizeof(StateIndexRecord) +
+                      (size_t)header->strings_size;
+    if (memcmp(header->magic, STATE_MAGIC, sizeof(header->magic)) != 0 || header->version != STATE_VERSION ||
+        expected != db.map_len || (header->strings_size > 0 && db.map[db.map_len - 1] != '\0')) {
+        log_warn("Índice de estado inválido, reconstruindo a partir do log: %s", path);
+        unmap_index();
+        return false;
+    }
+    db.header = header;
+    db.records = (const StateIndexRecord *)(db.map + sizeof(StateIndexHeader));
+    db.strings = (const char *)(db.records + header->count);
+    return true;
+}
+
+/* Uma mudança local ainda não gravada será acrescentada depois das linhas lidas agora, então prevalece. */
+static bool has_pending(const char *target) {
+    size_t slot;
+    return strmap_get(&db.overlay_index, target, &slot) && db.overlay[slot].pending;
+}
+
+static bool apply_log_line(char *line) {
+    line[strcspn(line, "\r\n")] = '\0';
+    char *fields[8];
+    size_t count = 0;
+    char *cursor = line;
+    while (count < 8) {
+        fields[count++] = cursor;
+        char *tab = strchr(cursor, '\t');
+        if (!tab) {
+            break;
+        }
+        *tab = '\0';
+        cursor = tab + 1;
+    }
+    if (count == 2 && strcmp(fields[0], "-") == 0) {
+        return has_pending(fields[1]) || overlay_put(fields[1], "", "", STATE_LINK, 0, 0, 0, true, false);
+    }
+    StateKind kind;
+    if (count != 8 || strcmp(fields[0], "+") != 0 || !parse_kind(fields[1], &kind) || has_pending(fields[6])) {
+        return true;
+    }
+    return overlay_put(fields[6], fields[7], fields[5], kind, atoll(fields[2]), atoll(fields[3]),
+                       strtoull(fields[4], NULL, 10), false, false);
+}
+
+static bool replay_log(const char *path, uint64_t offset) {
+    fs_op(PROFILE_FS_OPEN);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return errno == ENOENT;
+    }
+    if (offset > 0 && fseek(fp, (long)offset, SEEK_SET) != 0) {
+        fclose(fp);
+        return false;
+    }
+    char line[3 * PATH_MAX + 128];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp)) {
+        ok = apply_log_line(line);
+        ++db.log_records;
+    }
+    long end = ftell(fp);
+    if (ok && end >= 0) {
+        db.log_offset = (uint64_t)end;
+    }
+    fclose(fp);
+    return ok;
+}
+
+static long long file_size(const char *path) {
+    struct stat st;
+    fs_op(PROFILE_FS_STAT);
+    return stat(path, &st) == 0 ? (long long)st.st_size : -1;
+}
+
+static unsigned long long file_inode(const char *path) {
+#ifndef _WIN32
+    struct stat st;
+    fs_op(PROFILE_FS_STAT);
+    return stat(path, &st) == 0 ? (unsigned long long)st.st_ino : 0;
+#else
+    (void)path;
+    return 0;
+#endif
+}
+
+/* Snapshot mapeado mais a cauda do log posterior a ele; db.dir já definido e o lock do arquivo tomado. */
+static bool load_files(void) {
+    char log_path[PATH_MAX];
+    char index_path[PATH_MAX];
+    if (!db_file(db.dir, STATE_LOG, log_path, sizeof(log_path)) ||
+        !db_file(db.dir, STATE_INDEX, index_path, sizeof(index_path))) {
+        return false;
+    }
+    long long log_size = file_size(log_path);
+    db.log_inode = file_inode(log_path);
+    uint64_t offset = 0;
+    if (map_index(index_path)) {
+        if (log_size >= 0 && db.header->log_size <= (uint64_t)log_size) {
+            offset = db.header->log_size;
+            db.log_records = db.header->log_records;
+        } else {
+            unmap_index();
+        }
+    }
+    db.log_offset = offset;
+    return replay_log(log_path, offset);
+}
+
+static bool db_load(const AppOptions *opts) {
+    if (db.loaded && strcmp(db.dir, opts->state_dir) == 0) {
+        return true;
+    }
+    db_reset();
+    snprintf(db.dir, sizeof(db.dir), "%s", opts->state_dir);
+    if (!strmap_init(&db.overlay_index, 64)) {
+        return false;
+    }
+    db.loaded = true;
+    int lock = lock_state(db.dir, false);
+    bool ok = load_files();
+    unlock_state(lock);
+    return ok;
+}
+
+/* Outra execução compactou o log desde o carregamento: o offset guardado não vale mais para ele. Recarrega
+ * do disco mantendo só as mudanças locais ainda não gravadas. */
+static bool reload_keeping_pending(void) {
+    OverlayRecord *saved = malloc((db.overlay_count ? db.overlay_count : 1) * sizeof(OverlayRecord));
+    if (!saved) {
+        return false;
+    }
+    size_t saved_count = 0;
+    for (size_t i = 0; i < db.overlay_count; ++i) {
+        if (db.overlay[i].pending) {
+            saved[saved_count++] = db.overlay[i];
+            memset(&db.overlay[i], 0, sizeof(OverlayRecord));
+        }
+    }
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", db.dir);
+    db_reset();
+    snprintf(db.dir, sizeof(db.dir), "%s", dir);
+    bool ok = strmap_init(&db.overlay_index, 64);
+    db.loaded = ok;
+    ok = ok && load_files();
+    for (size_t i = 0; i < saved_count; ++i) {
+        const OverlayRecord *record = &saved[i];
+        ok = ok && overlay_put(record->target, record->source, record->scope, record->kind, record->size,
+                               record->mtime_ns, record->inode, record->removed, true);
+        free_overlay_record(&saved[i]);
+    }
+    free(saved);
+    db.dirty = true;
+    return ok;
+}
+
+static const StateIndexRecord *index_find(const char *target) {
+    if (!db.header) {
+        return NULL;
+    }
+    uint64_t hash = target_hash(target);
+    size_t low = 0;
+    size_t high = db.header->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (db.records[mid].hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    for (size_t i = low; i < db.header->count && db.records[i].hash == hash; ++i) {
+        if (strcmp(db.strings + db.records[i].target, target) == 0) {
+            return &db.records[i];
+        }
+    }
+    return NULL;
+}
+
+static void from_index(const StateIndexRecord *in, StateRecord *out) {
+    out->target = db.strings + in->target;
+    out->source = db.strings + in->source;
+    out->scope = db.strings + in->scope;
+    out->kind = in->kind < STATE_KIND_COUNT ? (StateKind)in->kind : STATE_LINK;
+    out->size = in->size;
+    out->mtime_ns = in->mtime_ns;
+    out->inode = in->inode;
+}
+
+static void from_overlay(const OverlayRecord *in, StateRecord *out) {
+    out->target = in->target;
+    out->source = in->source;
+    out->scope = in->scope;
+    out->kind = in->kind;
+    out->size = in->size;
+    out->mtime_ns = in->mtime_ns;
+    out->inode = in->inode;
+}
+
+/* Visão atual de um destino: overlay (inclusive tombstones) tem precedência sobre o snapshot. */
+static bool find_record(const char *target, StateRecord *out) {
+    size_t slot;
+    if (strmap_get(&db.overlay_index, target, &slot)) {
+        if (db.overlay[slot].removed) {
+            return false;
+        }
+        from_overlay(&db.overlay[slot], out);
+        return true;
+    }
+    const StateIndexRecord *record = index_find(target);
+    if (!record) {
+        return false;
+    }
+    from_index(record, out);
+    return true;
+}
+
+static bool stat_target(const char *target, long long *size, long long *mtime_ns, unsigned long long *inode) {
+#ifndef _WIN32
+    struct stat st;
+    fs_op(PROFILE_FS_LSTAT);
+    if (lstat(target, &st) != 0) {
+        return false;
+    }
+    *mtime_ns = stat_mtime_ns(&st);
+    *inode = (unsigned long long)st.st_ino;
+#else
+    struct _stat64i32 st;
+    if (_stat(target, &st) != 0) {
+        return false;
+    }
+    *mtime_ns = (long long)st.st_mtime * 1000000000LL;
+    *inode = 0;
+#endif
+    *size = (long long)st.st_size;
+    return true;
+}
+
+bool state_db_record(const AppOptions *opts, StateKind kind, const char *target, const char *source) {
+    if (!opts || !target || opts->dry_run) {
+        return false;
+    }
+    long long size = 0;
+    long long mtime_ns = 0;
+    unsigned long long inode = 0;
+    if (!stat_target(target, &size, &mtime_ns, &inode)) {
+        return false;
+    }
+    pthread_mutex_lock(&db_lock);
+    bool ok = db_load(opts);
+    if (ok) {
+        StateRecord existing;
+        bool same = find_record(target, &existing) && existing.kind == kind && existing.size == size &&
+                    existing.mtime_ns == mtime_ns && existing.inode == inode &&
+                    strcmp(existing.source, source ? source : "") == 0 && strcmp(existing.scope, current_scope) == 0;
+        if (!same) {
+            ok = overlay_put(target, source ? source : "", current_scope, kind, size, mtime_ns, inode, false, true);
+            db.dirty = db.dirty || ok;
+        }
+    }
+    pthread_mutex_unlock(&db_lock);
+    return ok;
+}
+
+void state_db_forget(const AppOptions *opts, const char *target) {
+    if (!opts || !target || opts->dry_run) {
+        return;
+    }
+    pthread_mutex_lock(&db_lock);
+    StateRecord existing;
+    if (db_load(opts) && find_record(target, &existing) &&
+        overlay_put(target, "", "", STATE_LINK, 0, 0, 0, true, true)) {
+        db.dirty = true;
+    }
+    pthread_mutex_unlock(&db_lock);
+}
+
+bool state_db_lookup(const AppOptions *opts, const char *target, StateRecord *record, char *buffer, size_t len) {
+    if (!opts || !target || !record || !buffer) {
+        return false;
+    }
+    pthread_mutex_lock(&db_lock);
+    StateRecord found;
+    bool ok = db_load(opts) && find_record(target, &found);
+    if (ok) {
+        size_t target_len = strlen(found.target) + 1;
+        size_t source_len = strlen(found.source) + 1;
+        size_t scope_len = strlen(found.scope) + 1;
+        ok = target_len + source_len + scope_len <= len;
+        if (ok) {
+            *record = found;
+            memcpy(buffer, found.target, target_len);
+            memcpy(buffer + target_len, found.source, source_len);
+            memcpy(buffer + target_len + source_len, found.scope, scope_len);
+            record->target = buffer;
+            record->source = buffer + target_len;
+            record->scope = buffer + target_len + source_len;
+        }
+    }
+    pthread_mutex_unlock(&db_lock);
+    return ok;
+}
+
+/* Visita os registros vivos; db_lock já tomado e o banco carregado. */
+static bool each_locked(StateVisitor visit, void *user) {
+    bool ok = true;
+    StateRecord record;
+    for (size_t i = 0; ok && db.header && i < db.header->count; ++i) {
+        const StateIndexRecord *in = &db.records[i];
+        size_t slot;
+        if (strmap_get(&db.overlay_index, db.strings + in->target, &slot)) {
+            continue;
+        }
+        from_index(in, &record);
+        ok = visit(&record, user);
+    }
+    for (size_t i = 0; ok && i < db.overlay_count; ++i) {
+        if (db.overlay[i].removed) {
+            continue;
+        }
+        from_overlay(&db.overlay[i], &record);
+        ok = visit(&record, user);
+    }
+    return ok;
+}
+
+/* Visita os registros vivos com o lock tomado: o visitante não pode chamar outras funções do state_db. */
+bool state_db_each(const AppOptions *opts, StateVisitor visit, void *user) {
+    if (!opts || !visit) {
+        return false;
+    }
+    pthread_mutex_lock(&db_lock);
+    bool ok = db_load(opts) && each_locked(visit, user);
+    pthread_mutex_unlock(&db_lock);
+    return ok;
+}
+
+bool state_db_matches_disk(const StateRecord *record) {
+    long long size = 0;
+    long long mtime_ns = 0;
+    unsigned long long inode = 0;
+    if (!stat_target(record->target, &size, &mtime_ns, &inode)) {
+        return false;
+    }
+    return size == record->size && mtime_ns == record->mtime_ns && inode == record->inode;
+}
+
+static bool buffer_append(ByteBuffer *buffer, const void *data, size_t len) {
+    if (buffer->len + len > buffer->capacity) {
+        size_t next = buffer->capacity ? buffer->capacity : 4096;
+        while (next < buffer->len + len) {
+            next *= 2;
+        }
+        char *grown = realloc(buffer->data, next);
+        if (!grown) {
+            return false;
+        }
+        buffer->data = grown;
+        buffer->capacity = next;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    return true;
+}
+
+static bool append_record_line(ByteBuffer *buffer, const StateRecord *record) {
+    char head[160];
+    int len = snprintf(head, sizeof(head), "+\t%s\t%lld\t%lld\t%llu\t", state_kind_name(record->kind),
+                       record->size, record->mtime_ns, record->inode);
+    return len > 0 && buffer_append(buffer, head, (size_t)len) &&
+           buffer_append(buffer, record->scope, strlen(record->scope)) && buffer_append(buffer, "\t", 1) &&
+           buffer_append(buffer, record->target, strlen(record->target)) && buffer_append(buffer, "\t", 1) &&
+           buffer_append(buffer, record->source, strlen(record->source)) && buffer_append(buffer, "\n", 1);
+}
+
+static bool append_pending(const char *log_path, size_t *lines) {
+    ByteBuffer buffer = {NULL, 0, 0};
+    bool ok = true;
+    *lines = 0;
+    for (size_t i = 0; ok && i < db.overlay_count; ++i) {
+        OverlayRecord *record = &db.overlay[i];
+        if (!record->pending) {
+            continue;
+        }
+        if (record->removed) {
+            ok = buffer_append(&buffer, "-\t", 2) && buffer_append(&buffer, record->target, strlen(record->target)) &&
+                 buffer_append(&buffer, "\n", 1);
+        } else {
+            StateRecord view;
+            from_overlay(record, &view);
+            ok = append_record_line(&buffer, &view);
+        }
+        ++*lines;
+    }
+    if (ok && buffer.len > 0) {
+        fs_op(PROFILE_FS_OPEN);
+        FILE *fp = fopen(log_path, "ab");
+        if (!fp) {
+            log_warn("Não foi possível abrir '%s': %s", log_path, strerror(errno));
+            ok = false;
+        } else {
+            ok = fwrite(buffer.data, 1, buffer.len, fp) == buffer.len;
+            ok = fclose(fp) == 0 && ok;
+        }
+    }
+    free(buffer.data);
+    return ok;
+}
+
+typedef struct {
+    StateIndexRecord *records;
+    size_t count;
+    ByteBuffer strings;
+    ByteBuffer log;
+    bool ok;
+} SnapshotBuilder;
+
+static bool add_string(ByteBuffer *strings, const char *value, uint32_t *offset) {
+    if (strings->len > UINT32_MAX) {
+        return false;
+    }
+    *offset = (uint32_t)strings->len;
+    return buffer_append(strings, value, strlen(value) + 1);
+}
+
+static bool snapshot_visit(const StateRecord *record, void *user) {
+    SnapshotBuilder *builder = user;
+    StateIndexRecord *out = &builder->records[builder->count];
+    memset(out, 0, sizeof(*out));
+    out->hash = target_hash(record->target);
+    out->size = record->size;
+    out->mtime_ns = record->mtime_ns;
+    out->inode = record->inode;
+    out->kind = (uint32_t)record->kind;
+    builder->ok = add_string(&builder->strings, record->target, &out->target) &&
+                  add_string(&builder->strings, record->source, &out->source) &&
+                  add_string(&builder->strings, record->scope, &out->scope) &&
+                  (!builder->log.capacity || append_record_line(&builder->log, record));
+    ++builder->count;
+    return builder->ok;
+}
+
+static int compare_index_records(const void *a, const void *b) {
+    const StateIndexRecord *left = a;
+    const StateIndexRecord *right = b;
+    return left->hash < right->hash ? -1 : left->hash > right->hash;
+}
+
+/* Regrava o snapshot (e, se o log tem muitas linhas mortas, também o log compactado). Chamado com db_lock e
+ * o lock exclusivo do arquivo, depois de aplicada a cauda do log: a memória tem tudo o que está no disco. */
+static bool write_snapshot(const char *log_path, const char *index_path) {
+    size_t capacity = db.overlay_count + (db.header ? db.header->count : 0);
+    SnapshotBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.ok = true;
+    builder.records = malloc((capacity ? capacity : 1) * sizeof(StateIndexRecord));
+    if (!builder.records) {
+        return false;
+    }
+    bool compact = db.log_records > 2 * capacity + 256;
+    if (compact) {
+        builder.log.capacity = 1;
+        builder.log.data = malloc(1);
+        compact = builder.log.data != NULL;
+        if (!compact) {
+            builder.log.capacity = 0;
+        }
+    }
+    bool ok = each_locked(snapshot_visit, &builder) && builder.ok;
+    if (ok && compact) {
+        ok = write_file_atomic(log_path, builder.log.data ? builder.log.data : "", builder.log.len, 0644);
+        db.log_records = builder.count;
+    }
+    long long log_size = ok ? file_size(log_path) : -1;
+    if (ok && log_size >= 0) {
+        qsort(builder.records, builder.count, sizeof(StateIndexRecord), compare_index_records);
+        StateIndexHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, STATE_MAGIC, sizeof(header.magic));
+        header.version = STATE_VERSION;
+        header.count = (uint32_t)builder.count;
+        header.log_size = (uint64_t)log_size;
+        header.log_records = db.log_records;
+        header.strings_size = builder.strings.len;
+        ByteBuffer out = {NULL, 0, 0};
+        ok = buffer_append(&out, &header, sizeof(header)) &&
+             buffer_append(&out, builder.records, builder.count * sizeof(StateIndexRecord)) &&
+             (builder.strings.len == 0 || buffer_append(&out, builder.strings.data, builder.strings.len)) &&
+             write_file_atomic(index_path, out.data, out.len, 0644);
+        free(out.data);
+    } else {
+        ok = false;
+    }
+    free(builder.records);
+    free(builder.strings.data);
+    free(builder.log.data);
+    return ok;
+}
+
+/* Sob o lock exclusivo: aplica o que outras execuções acrescentaram desde o carregamento, acrescenta as
+ * mudanças locais e, se for a hora, regrava snapshot e log a partir de uma memória completa. */
+bool state_db_flush(const AppOptions *opts) {
+    if (!opts) {
+        return false;
+    }
+    pthread_mutex_lock(&db_lock);
+    if (!db.loaded || !db.dirty || strcmp(db.dir, opts->state_dir) != 0) {
+        pthread_mutex_unlock(&db_lock);
+        return true;
+    }
+    char log_path[PATH_MAX];
+    char index_path[PATH_MAX];
+    bool ok = make_dirs(db.dir) && db_file(db.dir, STATE_LOG, log_path, sizeof(log_path)) &&
+              db_file(db.dir, STATE_INDEX, index_path, sizeof(index_path));
+    int lock = ok ? lock_state(db.dir, true) : -1;
+    if (ok) {
+        long long log_size = file_size(log_path);
+        unsigned long long inode = file_inode(log_path);
+        bool replaced = (db.log_inode != 0 && inode != db.log_inode) ||
+                        (log_size >= 0 && (uint64_t)log_size < db.log_offset);
+        ok = replaced ? reload_keeping_pending() : replay_log(log_path, db.log_offset);
+    }
+    size_t lines = 0;
+    if (ok) {
+        ok = append_pending(log_path, &lines);
+        db.log_records += lines;
+    }
+    for (size_t i = 0; ok && i < db.overlay_count; ++i) {
+        db.overlay[i].pending = false;
+    }
+    if (ok) {
+        long long log_size = file_size(log_path);
+        db.log_offset = log_size > 0 ? (uint64_t)log_size : 0;
+        db.log_inode = file_inode(log_path);
+    }
+    if (ok && (!db.header || db.overlay_count > STATE_OVERLAY_LIMIT || db.log_records > 2 * db.header->count + 256)) {
+        ok = write_snapshot(log_path, index_path);
+        db_reset();
+    } else if (ok) {
+        db.dirty = false;
+    }
+    unlock_state(lock);
+    pthread_mutex_unlock(&db_lock);
+    return ok;
+}
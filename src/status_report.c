@@ -0,0 +1,255 @@
+#include "status_report.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bufwriter.h"
+#include "deploy_copy.h"
+#include "metrics.h"
+#include "profile.h"
+#include "symlink_engine.h"
+#include "template_render.h"
+#include "utils.h"
+
+static const char *state_names[STATUS_STATE_COUNT] = {
+    "ok",
+    "stale",
+    "missing",
+    "divergent",
+    "conflict",
+    "error",
+};
+
+const char *entry_status_name(EntryStatus state) {
+    return state < STATUS_STATE_COUNT ? state_names[state] : "error";
+}
+
+/* 0 = tudo OK, 1 = erro ao inspecionar, 2.. = pior estado encontrado (stale < missing < divergent < conflict). */
+int entry_status_exit_code(EntryStatus state) {
+    if (state == STATUS_OK) {
+        return 0;
+    }
+    if (state == STATUS_ERROR) {
+        return 1;
+    }
+    return (int)state + 1;
+}
+
+void status_log_result(const DotfileEntry *entry, EntryStatus state, const char *actual) {
+    bool render = entry->mode == DEPLOY_RENDER;
+    bool copy = entry->mode == DEPLOY_COPY;
+    switch (state) {
+        case STATUS_OK:
+            log_info("[OK] %s", entry->target_path);
+            break;
+        case STATUS_STALE:
+            log_warn(copy ? "[STALE] %s precisa ser copiado novamente" :
+                     "[STALE] %s precisa ser renderizado novamente", entry->target_path);
+            break;
+        case STATUS_MISSING:
+            log_warn("[MISSING] %s", entry->target_path);
+            break;
+        case STATUS_DIVERGENT:
+            if (render) {
+                log_warn("[DIVERGENT] %s foi modificado desde a última renderização", entry->target_path);
+            } else if (copy) {
+                log_warn("[DIVERGENT] %s foi modificado desde a última cópia", entry->target_path);
+            } else if (entry->mode == DEPLOY_HARDLINK) {
+                log_warn("[DIVERGENT] %s não é mais hardlink do repositório", entry->target_path);
+            } else {
+                log_warn("[DIVERGENT] %s aponta para %s", entry->target_path, actual);
+            }
+            break;
+        case STATUS_CONFLICT:
+            log_warn(entry->mode != DEPLOY_LINK ? "[CONFLICT] %s existe mas não foi gerado pelo dotmgr" :
+                     "[CONFLICT] %s existe mas não é symlink", entry->target_path);
+            break;
+        default:
+            break;
+    }
+}
+
+static uint32_t intern_actual(StatusReport *report, const char *actual) {
+    if (!actual[0]) {
+        return STATUS_NO_ACTUAL;
+    }
+    size_t len = strlen(actual) + 1;
+    if (report->strings_len + len > report->strings_capacity) {
+        size_t next = report->strings_capacity ? report->strings_capacity * 2 : 4096;
+        while (next < report->strings_len + len) {
+            next *= 2;
+        }
+        char *grown = realloc(report->strings, next);
+        if (!grown) {
+            return STATUS_NO_ACTUAL;
+        }
+        report->strings = grown;
+        report->strings_capacity = next;
+    }
+    uint32_t offset = (uint32_t)report->strings_len;
+    memcpy(report->strings + offset, actual, len);
+    report->strings_len += len;
+    return offset;
+}
+
+bool status_report_build(const AppOptions *opts, const DotfileConfig *config, StatusReport *report) {
+    memset(report, 0, sizeof(*report));
+    report->results = calloc(config->count ? config->count : 1, sizeof(StatusResult));
+    if (!report->results) {
+        log_error("Memória insuficiente para o relatório de status");
+        return false;
+    }
+    char actual[PATH_MAX];
+    for (size_t i = 0; i < config->count; ++i) {
+        const DotfileEntry *entry = &config->entries[i];
+        ProfileSpan span;
+        profile_begin(&span, PROFILE_ENTRY);
+        uint64_t start = monotonic_ns();
+        EntryStatus state;
+        if (entry->mode == DEPLOY_RENDER) {
+            actual[0] = '\0';
+            state = render_inspect_status(opts, config, entry);
+        } else if (entry->mode == DEPLOY_COPY || entry->mode == DEPLOY_HARDLINK) {
+            actual[0] = '\0';
+            state = deploy_inspect_status(opts, entry);
+        } else {
+            state = inspect_entry_status(entry, actual, sizeof(actual));
+        }
+        StatusResult *result = &report->results[report->count++];
+        result->index = (uint32_t)i;
+        result->state = (uint8_t)state;
+        result->duration_ns = monotonic_ns() - start;
+        result->actual = intern_actual(report, actual);
+        profile_end_entry(&span, entry->target_path);
+        ++report->counts[state];
+        if (state > report->worst) {
+            report->worst = state;
+        }
+    }
+    return true;
+}
+
+const char *status_report_actual(const StatusReport *report, const StatusResult *result) {
+    return result->actual == STATUS_NO_ACTUAL ? "" : report->strings + result->actual;
+}
+
+void status_report_free(StatusReport *report) {
+    free(report->results);
+    free(report->strings);
+    memset(report, 0, sizeof(*report));
+}
+
+static void write_tsv_field(BufWriter *out, const char *text) {
+    for (const char *p = text; *p; ++p) {
+        switch (*p) {
+            case '\t':
+                bufwriter_puts(out, "\\t");
+                break;
+            case '\n':
+                bufwriter_puts(out, "\\n");
+                break;
+            case '\\':
+                bufwriter_puts(out, "\\\\");
+                break;
+            default:
+                bufwriter_write(out, p, 1);
+                break;
+        }
+    }
+}
+
+static const char *mode_name(const DotfileEntry *entry) {
+    switch (entry->mode) {
+        case DEPLOY_RENDER:
+            return "render";
+        case DEPLOY_COPY:
+            return "copy";
+        case DEPLOY_HARDLINK:
+            return "hardlink";
+        default:
+            return "link";
+    }
+}
+
+static void write_tsv(BufWriter *out, const DotfileConfig *config, const StatusReport *report) {
+    bufwriter_puts(out, "target\tsource\tmode\tstate\tactual\tduration_ns\n");
+    for (size_t i = 0; i < report->count; ++i) {
+        const StatusResult *result = &report->results[i];
+        const DotfileEntry *entry = &config->entries[result->index];
+        write_tsv_field(out, entry->target_path);
+        bufwriter_puts(out, "\t");
+        write_tsv_field(out, entry->source_path);
+        bufwriter_printf(out, "\t%s\t%s\t", mode_name(entry), entry_status_name((EntryStatus)result->state));
+        write_tsv_field(out, status_report_actual(report, result));
+        bufwriter_printf(out, "\t%llu\n", (unsigned long long)result->duration_ns);
+    }
+    bufwriter_printf(out, "# total=%zu", report->count);
+    for (int state = 0; state < STATUS_STATE_COUNT; ++state) {
+        bufwriter_printf(out, " %s=%zu", state_names[state], report->counts[state]);
+    }
+    bufwriter_printf(out, " worst=%s exit_code=%d\n", entry_status_name(report->worst),
+                     entry_status_exit_code(report->worst));
+}
+
+static void write_json(BufWriter *out, const DotfileConfig *config, const StatusReport *report) {
+    bufwriter_puts(out, "{\"entries\":[");
+    for (size_t i = 0; i < report->count; ++i) {
+        const StatusResult *result = &report->results[i];
+        const DotfileEntry *entry = &config->entries[result->index];
+        bufwriter_puts(out, i ? ",\n{\"target\":" : "\n{\"target\":");
+        bufwriter_json_string(out, entry->target_path);
+        bufwriter_puts(out, ",\"source\":");
+        bufwriter_json_string(out, entry->source_path);
+        bufwriter_printf(out, ",\"mode\":\"%s\",\"state\":\"%s\",\"actual\":", mode_name(entry),
+                         entry_status_name((EntryStatus)result->state));
+        if (result->actual == STATUS_NO_ACTUAL) {
+            bufwriter_puts(out, "null");
+        } else {
+            bufwriter_json_string(out, status_report_actual(report, result));
+        }
+        bufwriter_printf(out, ",\"duration_ns\":%llu}", (unsigned long long)result->duration_ns);
+    }
+    bufwriter_printf(out, "\n],\"summary\":{\"total\":%zu", report->count);
+    for (int state = 0; state < STATUS_STATE_COUNT; ++state) {
+        bufwriter_printf(out, ",\"%s\":%zu", state_names[state], report->counts[state]);
+    }
+    bufwriter_printf(out, "},\"worst\":\"%s\",\"exit_code\":%d}\n", entry_status_name(report->worst),
+                     entry_status_exit_code(report->worst));
+}
+
+bool run_status_report(const AppOptions *opts, const DotfileConfig *config, RunSummary *summary) {
+    StatusReport report;
+    if (!status_report_build(opts, config, &report)) {
+        return false;
+    }
+    metrics_status_counts(report.counts);
+    summary->processed += report.count;
+    summary->failed += report.counts[STATUS_ERROR];
+    if (opts->status_format == STATUS_FORMAT_TEXT) {
+        for (size_t i = 0; i < report.count; ++i) {
+            const StatusResult *result = &report.results[i];
+            status_log_result(&config->entries[result->index], (EntryStatus)result->state,
+                              status_report_actual(&report, result));
+        }
+        bool ok = report.counts[STATUS_ERROR] == 0;
+        status_report_free(&report);
+        return ok;
+    }
+    BufWriter out;
+    bool ok = bufwriter_attach(&out, stdout, BUFWRITER_DEFAULT_CAPACITY);
+    if (ok) {
+        if (opts->status_format == STATUS_FORMAT_TSV) {
+            write_tsv(&out, config, &report);
+        } else {
+            write_json(&out, config, &report);
+        }
+        ok = bufwriter_close(&out);
+    }
+    if (!ok) {
+        log_error("Falha ao escrever relatório de status");
+    }
+    summary->exit_code = entry_status_exit_code(report.worst);
+    status_report_free(&report);
+    return ok;
+}
@@ -0,0 +1,106 @@
+#include "strmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+static size_t round_capacity(size_t expected) {
+    size_t capacity = 16;
+    while (capacity < expected * 2) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+bool strmap_init(StrMap *map, size_t expected) {
+    if (!map) {
+        return false;
+    }
+    map->capacity = round_capacity(expected);
+    map->count = 0;
+    map->slots = calloc(map->capacity, sizeof(StrMapSlot));
+    return map->slots != NULL;
+}
+
+void strmap_free(StrMap *map) {
+    if (!map) {
+        return;
+    }
+    for (size_t i = 0; i < map->capacity; ++i) {
+        free(map->slots[i].key);
+    }
+    free(map->slots);
+    map->slots = NULL;
+    map->capacity = 0;
+    map->count = 0;
+}
+
+static StrMapSlot *find_slot(StrMapSlot *slots, size_t capacity, const char *key, uint64_t hash) {
+    size_t mask = capacity - 1;
+    size_t index = (size_t)hash & mask;
+    while (slots[index].key) {
+        if (slots[index].hash == hash && strcmp(slots[index].key, key) == 0) {
+            return &slots[index];
+        }
+        index = (index + 1) & mask;
+    }
+    return &slots[index];
+}
+
+static bool grow(StrMap *map) {
+    size_t capacity = map->capacity * 2;
+    StrMapSlot *slots = calloc(capacity, sizeof(StrMapSlot));
+    if (!slots) {
+        return false;
+    }
+    for (size_t i = 0; i < map->capacity; ++i) {
+        if (map->slots[i].key) {
+            *find_slot(slots, capacity, map->slots[i].key, map->slots[i].hash) = map->slots[i];
+        }
+    }
+    free(map->slots);
+    map->slots = slots;
+    map->capacity = capacity;
+    return true;
+}
+
+bool strmap_put(StrMap *map, const char *key, size_t value) {
+    if (!map || !map->slots || !key) {
+        return false;
+    }
+    if ((map->count + 1) * 4 > map->capacity * 3 && !grow(map)) {
+        return false;
+    }
+    uint64_t hash = hash_fnv1a64(key, strlen(key), HASH_FNV1A64_SEED);
+    StrMapSlot *slot = find_slot(map->slots, map->capacity, key, hash);
+    if (slot->key) {
+        slot->value = value;
+        return true;
+    }
+    size_t len = strlen(key);
+    slot->key = malloc(len + 1);
+    if (!slot->key) {
+        return false;
+    }
+    memcpy(slot->key, key, len + 1);
+    slot->hash = hash;
+    slot->value = value;
+    ++map->count;
+    return true;
+}
+
+bool strmap_get(const StrMap *map, const char *key, size_t *value) {
+    if (!map || !map->slots || !key) {
+        return false;
+    }
+    uint64_t hash = hash_fnv1a64(key, strlen(key), HASH_FNV1A64_SEED);
+    const StrMapSlot *slot = find_slot(map->slots, map->capacity, key, hash);
+    if (!slot->key) {
+        return false;
+    }
+    if (value) {
+        *value = slot->value;
+    }
+    return true;
+}
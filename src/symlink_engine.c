@@ -1,10 +1,17 @@
+#define _DEFAULT_SOURCE
+
 #include "symlink_engine.h"
 
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "backup_catalog.h"
 #include "conflict_manager.h"
+#include "io_sched.h"
+#include "profile.h"
+#include "state_db.h"
+#include "status_report.h"
 #include "utils.h"
 
 #ifndef _WIN32
@@ -62,6 +69,7 @@ static bool create_symlink(const DotfileEntry *entry, bool dry_run) {
         log_info("[dry-run] ln -s %s %s", entry->source_path, entry->target_path);
         return true;
     }
+    fs_op(PROFILE_FS_SYMLINK);
     if (symlink(entry->source_path, entry->target_path) != 0) {
         log_error("Falha ao criar symlink %s -> %s: %s", entry->target_path, entry->source_path, strerror(errno));
         return false;
@@ -71,7 +79,15 @@ static bool create_symlink(const DotfileEntry *entry, bool dry_run) {
 #endif
 }
 
-static bool remove_symlink(const DotfileEntry *entry, bool dry_run) {
+bool create_entry_symlink(const DotfileEntry *entry, bool dry_run) {
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_SYMLINK);
+    bool ok = create_symlink(entry, dry_run);
+    profile_end_detail(&span, entry->target_path);
+    return ok;
+}
+
+bool remove_entry_symlink(const DotfileEntry *entry, bool dry_run) {
 #ifdef _WIN32
     log_info("[dry-run] (Windows) unlink %s", entry->target_path);
     if (dry_run) {
@@ -99,6 +115,7 @@ static bool remove_symlink(const DotfileEntry *entry, bool dry_run) {
         log_info("[dry-run] unlink %s", entry->target_path);
         return true;
     }
+    fs_op(PROFILE_FS_UNLINK);
     if (unlink(entry->target_path) != 0) {
         log_error("Falha ao remover symlink '%s': %s", entry->target_path, strerror(errno));
         return false;
@@ -107,14 +124,11 @@ static bool remove_symlink(const DotfileEntry *entry, bool dry_run) {
 #endif
 }
 
-bool install_entry(const AppOptions *opts, const DotfileEntry *entry) {
-    if (!opts || !entry) {
-        return false;
-    }
+static bool install_link(const AppOptions *opts, const DotfileEntry *entry) {
 #ifdef _WIN32
     DWORD attrs = GetFileAttributesA(entry->target_path);
     if (attrs != INVALID_FILE_ATTRIBUTES) {
-        ConflictOutcome outcome = resolve_conflict(opts, entry->target_path);
+        ConflictOutcome outcome = resolve_conflict(opts, entry->target_path, entry->source_path);
         if (outcome == CONFLICT_SKIP) {
             log_warn("Pulando %s", entry->target_path);
             return true;
@@ -125,16 +139,18 @@ bool install_entry(const AppOptions *opts, const DotfileEntry *entry) {
     }
 #else
     StatBuffer st;
+    fs_op(PROFILE_FS_LSTAT);
     if (LSTAT(entry->target_path, &st) == 0) {
         if (S_ISLNK(st.st_mode)) {
             if (is_same_symlink_target(entry->target_path, entry->source_path)) {
                 if (opts->verbose) {
                     log_info("Symlink já atualizado: %s", entry->target_path);
                 }
+                state_db_record(opts, STATE_LINK, entry->target_path, entry->source_path);
                 return true;
             }
         }
-        ConflictOutcome outcome = resolve_conflict(opts, entry->target_path);
+        ConflictOutcome outcome = resolve_conflict(opts, entry->target_path, entry->source_path);
         if (outcome == CONFLICT_SKIP) {
             log_warn("Pulando %s", entry->target_path);
             return true;
@@ -149,7 +165,22 @@ bool install_entry(const AppOptions *opts, const DotfileEntry *entry) {
         return false;
     }
 
-    return create_symlink(entry, opts->dry_run);
+    if (!create_entry_symlink(entry, opts->dry_run)) {
+        return false;
+    }
+    state_db_record(opts, STATE_LINK, entry->target_path, entry->source_path);
+    return true;
+}
+
+bool install_entry(const AppOptions *opts, const DotfileEntry *entry) {
+    if (!opts || !entry) {
+        return false;
+    }
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_INSTALL);
+    bool ok = install_link(opts, entry);
+    profile_end(&span);
+    return ok;
 }
 
 bool uninstall_entry(const AppOptions *opts, const DotfileEntry *entry) {
@@ -162,7 +193,7 @@ bool uninstall_entry(const AppOptions *opts, const DotfileEntry *entry) {
         if (opts->verbose) {
             log_info("Destino inexistente: %s", entry->target_path);
         }
-        return true;
+        return !opts->restore_backups || backup_catalog_restore(opts, entry->target_path);
     }
     char target_check[PATH_MAX];
     if (!read_symlink_target(entry->target_path, target_check, sizeof(target_check))) {
@@ -173,15 +204,20 @@ bool uninstall_entry(const AppOptions *opts, const DotfileEntry *entry) {
         log_warn("Symlink %s aponta para outro destino, pulando", entry->target_path);
         return true;
     }
-    return remove_symlink(entry, opts->dry_run);
+    if (!remove_entry_symlink(entry, opts->dry_run)) {
+        return false;
+    }
+    state_db_forget(opts, entry->target_path);
+    return !opts->restore_backups || backup_catalog_restore(opts, entry->target_path);
 #else
     StatBuffer st;
+    fs_op(PROFILE_FS_LSTAT);
     if (LSTAT(entry->target_path, &st) != 0) {
         if (errno == ENOENT) {
             if (opts->verbose) {
                 log_info("Destino inexistente: %s", entry->target_path);
             }
-            return true;
+            return !opts->restore_backups || backup_catalog_restore(opts, entry->target_path);
         }
         log_error("Erro ao ler '%s': %s", entry->target_path, strerror(errno));
         return false;
@@ -194,50 +230,49 @@ bool uninstall_entry(const AppOptions *opts, const DotfileEntry *entry) {
         log_warn("Symlink %s aponta para outro target, pulando", entry->target_path);
         return true;
     }
-    return remove_symlink(entry, opts->dry_run);
+    if (!remove_entry_symlink(entry, opts->dry_run)) {
+        return false;
+    }
+    state_db_forget(opts, entry->target_path);
+    return !opts->restore_backups || backup_catalog_restore(opts, entry->target_path);
 #endif
 }
 
-bool status_entry(const AppOptions *opts, const DotfileEntry *entry) {
-    if (!opts || !entry) {
-        return false;
-    }
+EntryStatus inspect_entry_status(const DotfileEntry *entry, char *actual, size_t len) {
+    actual[0] = '\0';
 #ifdef _WIN32
-    char target_buf[PATH_MAX];
-    if (!read_symlink_target(entry->target_path, target_buf, sizeof(target_buf))) {
-        DWORD attrs = GetFileAttributesA(entry->target_path);
-        if (attrs == INVALID_FILE_ATTRIBUTES) {
-            log_warn("[MISSING] %s", entry->target_path);
-            return true;
-        }
-        log_warn("[CONFLICT] %s existe mas não é symlink", entry->target_path);
-        return true;
-    }
-    if (!is_same_symlink_target(entry->target_path, entry->source_path)) {
-        log_warn("[DIVERGENT] %s aponta para %s", entry->target_path, target_buf);
-        return true;
+    if (!read_symlink_target(entry->target_path, actual, len)) {
+        actual[0] = '\0';
+        return GetFileAttributesA(entry->target_path) == INVALID_FILE_ATTRIBUTES ? STATUS_MISSING : STATUS_CONFLICT;
     }
-    log_info("[OK] %s", entry->target_path);
-    return true;
 #else
     StatBuffer st;
+    fs_op(PROFILE_FS_LSTAT);
     if (LSTAT(entry->target_path, &st) != 0) {
         if (errno == ENOENT) {
-        log_warn("[MISSING] %s", entry->target_path);
-        return true;
-    }
+            return STATUS_MISSING;
+        }
         log_error("Erro ao checar '%s': %s", entry->target_path, strerror(errno));
-        return false;
+        return STATUS_ERROR;
     }
     if (!S_ISLNK(st.st_mode)) {
-        log_warn("[CONFLICT] %s existe mas não é symlink", entry->target_path);
-        return true;
+        return STATUS_CONFLICT;
     }
-    if (!is_same_symlink_target(entry->target_path, entry->source_path)) {
-        log_warn("[DIVERGENT] %s aponta para outro destino", entry->target_path);
-        return true;
+    if (!read_symlink_target(entry->target_path, actual, len)) {
+        log_error("Erro ao ler symlink '%s': %s", entry->target_path, strerror(errno));
+        actual[0] = '\0';
+        return STATUS_ERROR;
     }
-    log_info("[OK] %s", entry->target_path);
-    return true;
 #endif
+    return is_same_symlink_target(entry->target_path, entry->source_path) ? STATUS_OK : STATUS_DIVERGENT;
+}
+
+bool status_entry(const AppOptions *opts, const DotfileEntry *entry) {
+    if (!opts || !entry) {
+        return false;
+    }
+    char actual[PATH_MAX];
+    EntryStatus state = inspect_entry_status(entry, actual, sizeof(actual));
+    status_log_result(entry, state, actual);
+    return state != STATUS_ERROR;
 }
@@ -0,0 +1,236 @@
+#define _GNU_SOURCE
+
+#include "target_lock.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "utils.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Locks OFD pertencem ao descritor aberto, não ao processo: não somem quando outro fd do arquivo fecha. */
+#ifdef F_OFD_SETLK
+#define LOCK_SET F_OFD_SETLK
+#define LOCK_WAIT F_OFD_SETLKW
+#else
+#define LOCK_SET F_SETLK
+#define LOCK_WAIT F_SETLKW
+#endif
+#endif
+
+typedef struct {
+    bool enabled;
+    bool failed;
+    int fd;
+    char path[PATH_MAX];
+} LockTable;
+
+static LockTable table = {false, false, -1, ""};
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+/* O fcntl não exclui threads do mesmo processo (mesmo descritor): cada slot tem também um mutex. */
+static pthread_mutex_t slot_locks[TARGET_LOCK_SLOTS];
+static pthread_once_t slots_once = PTHREAD_ONCE_INIT;
+/* Lock de estado: fd próprio, aberto só enquanto os arquivos compartilhados do state_dir são regravados. */
+static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int state_fd = -1;
+static atomic_size_t contended;
+static atomic_uint_least64_t waited_ns;
+
+static void init_slots(void) {
+    for (size_t i = 0; i < TARGET_LOCK_SLOTS; ++i) {
+        pthread_mutex_init(&slot_locks[i], NULL);
+    }
+}
+
+/* gc só altera destinos com --delete. */
+static bool mutating_command(const AppOptions *opts) {
+    CommandType command = opts->command;
+    return command == CMD_INSTALL || command == CMD_UNINSTALL || command == CMD_COLLECT ||
+           command == CMD_RECONCILE || command == CMD_APPLY || (command == CMD_GC && opts->gc_delete);
+}
+
+void target_lock_begin(const AppOptions *opts) {
+    pthread_once(&slots_once, init_slots);
+    pthread_mutex_lock(&table_lock);
+#ifndef _WIN32
+    if (table.fd >= 0) {
+        close(table.fd);
+    }
+#endif
+    table.fd = -1;
+    table.failed = false;
+    table.enabled = mutating_command(opts) && !opts->dry_run &&
+                    join_paths(opts->repo_path, TARGET_LOCK_FILE, table.path, sizeof(table.path));
+    pthread_mutex_unlock(&table_lock);
+    atomic_store(&contended, 0);
+    atomic_store(&waited_ns, 0);
+}
+
+void target_lock_end(const AppOptions *opts) {
+    pthread_mutex_lock(&table_lock);
+#ifndef _WIN32
+    if (table.fd >= 0) {
+        close(table.fd);
+    }
+#endif
+    table.fd = -1;
+    table.enabled = false;
+    pthread_mutex_unlock(&table_lock);
+    size_t waits = atomic_load(&contended);
+    if (opts->verbose && waits > 0) {
+        log_info("Locks por destino: %zu esperas, %.1f ms no total", waits,
+                 (double)atomic_load(&waited_ns) / 1e6);
+    }
+}
+
+/* Aberto na primeira entrada. Sem o arquivo (repositório ausente, só leitura), segue sem locks. */
+static int lock_descriptor(void) {
+    pthread_mutex_lock(&table_lock);
+    int fd = -1;
+#ifndef _WIN32
+    if (table.enabled && table.fd < 0 && !table.failed) {
+        table.fd = open(table.path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (table.fd < 0) {
+            table.failed = true;
+            log_warn("Sem locks por destino: não foi possível abrir '%s': %s", table.path, strerror(errno));
+        }
+    }
+    fd = table.enabled ? table.fd : -1;
+#endif
+    pthread_mutex_unlock(&table_lock);
+    return fd;
+}
+
+static size_t slot_for(const char *target, char *parent, size_t len) {
+    const char *slash = strrchr(target, '/');
+    size_t dir_len = slash && slash != target ? (size_t)(slash - target) : 1;
+    if (dir_len >= len) {
+        dir_len = len - 1;
+    }
+    memcpy(parent, target, dir_len);
+    parent[dir_len] = '\0';
+    return (size_t)(hash_fnv1a64(parent, dir_len, HASH_FNV1A64_SEED) % TARGET_LOCK_SLOTS);
+}
+
+void target_lock_acquire(const AppOptions *opts, const char *target, TargetLock *lock) {
+    lock->held = false;
+    if (opts->dry_run || !mutating_command(opts)) {
+        return;
+    }
+    int fd = lock_descriptor();
+    if (fd < 0) {
+        return;
+    }
+#ifndef _WIN32
+    char parent[PATH_MAX];
+    size_t slot = slot_for(target, parent, sizeof(parent));
+    pthread_mutex_lock(&slot_locks[slot]);
+    struct flock range;
+    memset(&range, 0, sizeof(range));
+    range.l_type = F_WRLCK;
+    range.l_whence = SEEK_SET;
+    range.l_start = (off_t)slot;
+    range.l_len = 1;
+    if (fcntl(fd, LOCK_SET, &range) != 0) {
+        if (errno != EAGAIN && errno != EACCES) {
+            pthread_mutex_unlock(&slot_locks[slot]);
+            return;
+        }
+        if (opts->verbose) {
+            log_info("Aguardando outra execução do dotmgr em %s", parent);
+        }
+        uint64_t start = monotonic_ns();
+        int rc;
+        while ((rc = fcntl(fd, LOCK_WAIT, &range)) != 0 && errno == EINTR) {
+        }
+        uint64_t waited = monotonic_ns() - start;
+        atomic_fetch_add(&contended, 1);
+        atomic_fetch_add(&waited_ns, waited);
+        if (rc != 0) {
+            log_warn("Lock de %s indisponível: %s", parent, strerror(errno));
+            pthread_mutex_unlock(&slot_locks[slot]);
+            return;
+        }
+        if (opts->verbose) {
+            log_info("Lock de %s obtido após %.1f ms", parent, (double)waited / 1e6);
+        }
+    }
+    lock->slot = slot;
+    lock->held = true;
+#else
+    (void)target;
+#endif
+}
+
+void target_lock_release(TargetLock *lock) {
+    if (!lock->held) {
+        return;
+    }
+#ifndef _WIN32
+    int fd = lock_descriptor();
+    if (fd >= 0) {
+        struct flock range;
+        memset(&range, 0, sizeof(range));
+        range.l_type = F_UNLCK;
+        range.l_whence = SEEK_SET;
+        range.l_start = (off_t)lock->slot;
+        range.l_len = 1;
+        fcntl(fd, LOCK_SET, &range);
+    }
+    pthread_mutex_unlock(&slot_locks[lock->slot]);
+#endif
+    lock->held = false;
+}
+
+/* Pego depois de target_lock_end, sem nenhum lock de destino: sem OFD, fechar este fd soltaria também
+ * os locks do processo no mesmo arquivo. */
+void target_lock_state_begin(const AppOptions *opts) {
+    pthread_mutex_lock(&state_mutex);
+    state_fd = -1;
+#ifndef _WIN32
+    char path[PATH_MAX];
+    if (opts->dry_run || !join_paths(opts->repo_path, TARGET_LOCK_FILE, path, sizeof(path))) {
+        return;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            log_warn("Sem lock de estado: não foi possível abrir '%s': %s", path, strerror(errno));
+        }
+        return;
+    }
+    struct flock range;
+    memset(&range, 0, sizeof(range));
+    range.l_type = F_WRLCK;
+    range.l_whence = SEEK_SET;
+    range.l_start = (off_t)TARGET_LOCK_SLOTS;
+    range.l_len = 1;
+    int rc;
+    while ((rc = fcntl(fd, LOCK_WAIT, &range)) != 0 && errno == EINTR) {
+    }
+    if (rc != 0) {
+        log_warn("Lock de estado indisponível: %s", strerror(errno));
+        close(fd);
+        return;
+    }
+    state_fd = fd;
+#else
+    (void)opts;
+#endif
+}
+
+void target_lock_state_end(void) {
+#ifndef _WIN32
+    if (state_fd >= 0) {
+        close(state_fd);
+    }
+#endif
+    state_fd = -1;
+    pthread_mutex_unlock(&state_mutex);
+}
@@ -0,0 +1,383 @@
+#define _DEFAULT_SOURCE
+
+#include "template_render.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "backup_catalog.h"
+#include "conflict_manager.h"
+#include "fingerprint_cache.h"
+#include "io_sched.h"
+#include "path_expand.h"
+#include "state_db.h"
+#include "status_report.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define RENDER_CACHE "render"
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} RenderBuffer;
+
+typedef enum {
+    TARGET_ABSENT,
+    TARGET_OWNED,
+    TARGET_MODIFIED,
+    TARGET_FOREIGN
+} TargetState;
+
+static pthread_mutex_t vars_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool buffer_append(RenderBuffer *buffer, const char *data, size_t len) {
+    if (!buffer) {
+        return true;
+    }
+    if (buffer->len + len + 1 > buffer->capacity) {
+        size_t next = buffer->capacity ? buffer->capacity : 1024;
+        while (next < buffer->len + len + 1) {
+            next *= 2;
+        }
+        char *tmp = realloc(buffer->data, next);
+        if (!tmp) {
+            return false;
+        }
+        buffer->data = tmp;
+        buffer->capacity = next;
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+    buffer->data[buffer->len] = '\0';
+    return true;
+}
+
+static bool placeholder_name(const char *start, const char *end, char *name, size_t len) {
+    while (start < end && isspace((unsigned char)*start)) {
+        ++start;
+    }
+    while (end > start && isspace((unsigned char)end[-1])) {
+        --end;
+    }
+    if (start == end || (size_t)(end - start) >= len) {
+        return false;
+    }
+    for (const char *c = start; c < end; ++c) {
+        if (!isalnum((unsigned char)*c) && *c != '_' && *c != '.' && *c != '-') {
+            return false;
+        }
+    }
+    memcpy(name, start, (size_t)(end - start));
+    name[end - start] = '\0';
+    return true;
+}
+
+/* Percorre o template calculando o hash das entradas (bytes + variáveis usadas);
+   com output != NULL também gera o conteúdo renderizado. */
+static bool process_template(const char *tpl, size_t len, struct PathVars *vars, const char *source,
+                             uint64_t *input_hash, RenderBuffer *output) {
+    uint64_t hash = hash_fnv1a64(tpl, len, HASH_FNV1A64_SEED);
+    const char *cursor = tpl;
+    const char *end = tpl + len;
+    bool ok = true;
+    pthread_mutex_lock(&vars_lock);
+    while (ok && cursor < end) {
+        const char *open = NULL;
+        for (const char *p = cursor; p + 1 < end; ++p) {
+            if (p[0] == '{' && p[1] == '{') {
+                open = p;
+                break;
+            }
+        }
+        const char *close = NULL;
+        if (open) {
+            for (const char *p = open + 2; p + 1 < end && *p != '\n'; ++p) {
+                if (p[0] == '}' && p[1] == '}') {
+                    close = p;
+                    break;
+                }
+            }
+        }
+        char name[128];
+        if (!open || !close || !placeholder_name(open + 2, close, name, sizeof(name))) {
+            const char *stop = open ? open + 2 : end;
+            ok = buffer_append(output, cursor, (size_t)(stop - cursor));
+            cursor = stop;
+            continue;
+        }
+        bool is_env = strncmp(name, "env.", 4) == 0;
+        const char *value = path_vars_lookup(vars, is_env ? name + 4 : name, is_env);
+        if (!value) {
+            log_error("Variável '{{%s}}' não definida no template %s", name, source);
+            ok = false;
+            break;
+        }
+        hash = hash_fnv1a64(name, strlen(name) + 1, hash);
+        hash = hash_fnv1a64(value, strlen(value) + 1, hash);
+        ok = buffer_append(output, cursor, (size_t)(open - cursor)) &&
+            buffer_append(output, value, strlen(value));
+        cursor = close + 2;
+    }
+    pthread_mutex_unlock(&vars_lock);
+    if (ok) {
+        *input_hash = hash;
+    }
+    return ok;
+}
+
+static int template_mode(const char *path) {
+#ifndef _WIN32
+    struct stat st;
+    fs_op(PROFILE_FS_STAT);
+    if (stat(path, &st) == 0) {
+        return (int)(st.st_mode & 0777);
+    }
+#else
+    (void)path;
+#endif
+    return 0644;
+}
+
+static bool load_template(const DotfileEntry *entry, const DotfileConfig *config, char **data, size_t *len,
+                          uint64_t *input_hash) {
+    if (!read_file_contents(entry->source_path, data, len)) {
+        log_error("Não foi possível ler template '%s': %s", entry->source_path, strerror(errno));
+        return false;
+    }
+    if (!process_template(*data, *len, config->vars, entry->source_path, input_hash, NULL)) {
+        free(*data);
+        return false;
+    }
+    return true;
+}
+
+static bool target_occupied(const char *target) {
+#ifndef _WIN32
+    struct stat st;
+    fs_op(PROFILE_FS_LSTAT);
+    return lstat(target, &st) == 0;
+#else
+    return path_exists(target);
+#endif
+}
+
+static TargetState inspect_target(const AppOptions *opts, const char *target, FileFingerprint *cached,
+                                  bool *has_cache) {
+    *has_cache = fingerprint_cache_get(opts, RENDER_CACHE, target, cached);
+    FileFingerprint current;
+    if (!fingerprint_stat(target, &current)) {
+        return target_occupied(target) ? TARGET_FOREIGN : TARGET_ABSENT;
+    }
+    if (!*has_cache) {
+        return TARGET_FOREIGN;
+    }
+    return fingerprint_same_stat(&current, cached) ? TARGET_OWNED : TARGET_MODIFIED;
+}
+
+static bool same_contents(const char *path, const RenderBuffer *rendered) {
+    FileFingerprint current;
+    char *data = NULL;
+    size_t len = 0;
+    if (!fingerprint_stat(path, &current) || current.size != (long long)rendered->len ||
+        !read_file_contents(path, &data, &len)) {
+        return false;
+    }
+    bool same = len == rendered->len && memcmp(data, rendered->data, len) == 0;
+    free(data);
+    return same;
+}
+
+static void remember_render(const AppOptions *opts, const DotfileEntry *entry, uint64_t input_hash,
+                            const RenderBuffer *rendered) {
+    FileFingerprint fp;
+    if (opts->dry_run || !fingerprint_stat(entry->target_path, &fp)) {
+        return;
+    }
+    fp.input_hash = input_hash;
+    fp.content_hash = hash_fnv1a64(rendered->data, rendered->len, HASH_FNV1A64_SEED);
+    fingerprint_cache_put(opts, RENDER_CACHE, entry->target_path, &fp);
+    state_db_record(opts, STATE_RENDER, entry->target_path, entry->source_path);
+}
+
+bool render_install_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry) {
+    if (!opts || !config || !entry) {
+        return false;
+    }
+    char *tpl = NULL;
+    size_t tpl_len = 0;
+    uint64_t input_hash = 0;
+    if (!load_template(entry, config, &tpl, &tpl_len, &input_hash)) {
+        return false;
+    }
+
+    FileFingerprint cached;
+    bool has_cache = false;
+    TargetState state = inspect_target(opts, entry->target_path, &cached, &has_cache);
+    if (state == TARGET_OWNED && cached.input_hash == input_hash) {
+        if (opts->verbose) {
+            log_info("Template atualizado: %s", entry->target_path);
+        }
+        free(tpl);
+        return true;
+    }
+
+    RenderBuffer rendered = {NULL, 0, 0};
+    if (!buffer_append(&rendered, "", 0) ||
+        !process_template(tpl, tpl_len, config->vars, entry->source_path, &input_hash, &rendered)) {
+        free(tpl);
+        free(rendered.data);
+        return false;
+    }
+    free(tpl);
+
+    bool ok = true;
+    if (state == TARGET_FOREIGN || state == TARGET_MODIFIED) {
+        if (state == TARGET_FOREIGN && same_contents(entry->target_path, &rendered)) {
+            if (opts->verbose) {
+                log_info("Conteúdo já corresponde ao template: %s", entry->target_path);
+            }
+            remember_render(opts, entry, input_hash, &rendered);
+            free(rendered.data);
+            return true;
+        }
+        if (state == TARGET_MODIFIED) {
+            log_warn("%s foi modificado desde a última renderização", entry->target_path);
+        }
+        ConflictOutcome outcome = resolve_conflict(opts, entry->target_path, NULL);
+        if (outcome == CONFLICT_SKIP) {
+            log_warn("Pulando %s", entry->target_path);
+            free(rendered.data);
+            return true;
+        }
+        if (outcome == CONFLICT_ERROR) {
+            free(rendered.data);
+            return false;
+        }
+    }
+
+    if (opts->dry_run) {
+        log_info("[dry-run] render %s -> %s", entry->source_path, entry->target_path);
+    } else if (!ensure_parent_dirs(entry->target_path, false) ||
+               !write_file_atomic(entry->target_path, rendered.data, rendered.len, template_mode(entry->source_path))) {
+        ok = false;
+    } else {
+        log_info("Template renderizado: %s", entry->target_path);
+        remember_render(opts, entry, input_hash, &rendered);
+    }
+    free(rendered.data);
+    return ok;
+}
+
+/* Mesmo critério do render_install_entry: destino alheio ou modificado que ainda não corresponde ao template.
+ * No collect um destino modificado só gera aviso, então não é conflito. */
+bool render_entry_conflicts(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry) {
+    FileFingerprint cached;
+    bool has_cache = false;
+    TargetState state = inspect_target(opts, entry->target_path, &cached, &has_cache);
+    if (state == TARGET_MODIFIED) {
+        return opts->command != CMD_COLLECT;
+    }
+    if (state != TARGET_FOREIGN) {
+        return false;
+    }
+    char *tpl = NULL;
+    size_t tpl_len = 0;
+    uint64_t input_hash = 0;
+    if (!load_template(entry, config, &tpl, &tpl_len, &input_hash)) {
+        return false;
+    }
+    RenderBuffer rendered = {NULL, 0, 0};
+    bool matches = buffer_append(&rendered, "", 0) &&
+                   process_template(tpl, tpl_len, config->vars, entry->source_path, &input_hash, &rendered) &&
+                   same_contents(entry->target_path, &rendered);
+    free(tpl);
+    free(rendered.data);
+    return !matches && conflict_needs_decision(entry->target_path, NULL);
+}
+
+EntryStatus render_inspect_status(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry) {
+    FileFingerprint cached;
+    bool has_cache = false;
+    switch (inspect_target(opts, entry->target_path, &cached, &has_cache)) {
+        case TARGET_ABSENT:
+            return STATUS_MISSING;
+        case TARGET_FOREIGN:
+            return STATUS_CONFLICT;
+        case TARGET_MODIFIED:
+            return STATUS_DIVERGENT;
+        case TARGET_OWNED:
+            break;
+    }
+    char *tpl = NULL;
+    size_t tpl_len = 0;
+    uint64_t input_hash = 0;
+    if (!load_template(entry, config, &tpl, &tpl_len, &input_hash)) {
+        return STATUS_ERROR;
+    }
+    free(tpl);
+    return input_hash != cached.input_hash ? STATUS_STALE : STATUS_OK;
+}
+
+bool render_status_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry) {
+    if (!opts || !config || !entry) {
+        return false;
+    }
+    EntryStatus state = render_inspect_status(opts, config, entry);
+    status_log_result(entry, state, "");
+    return state != STATUS_ERROR;
+}
+
+bool render_uninstall_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry) {
+    if (!opts || !config || !entry) {
+        return false;
+    }
+    FileFingerprint cached;
+    bool has_cache = false;
+    TargetState state = inspect_target(opts, entry->target_path, &cached, &has_cache);
+    if (state == TARGET_FOREIGN) {
+        log_warn("Destino %s não foi gerado pelo dotmgr, pulando", entry->target_path);
+        return true;
+    }
+    if (state == TARGET_MODIFIED) {
+        log_warn("%s foi modificado desde a última renderização, pulando", entry->target_path);
+        return true;
+    }
+    if (state == TARGET_OWNED) {
+        if (opts->dry_run) {
+            log_info("[dry-run] remover %s", entry->target_path);
+        } else if (remove(entry->target_path) != 0) {
+            log_error("Falha ao remover '%s': %s", entry->target_path, strerror(errno));
+            return false;
+        } else {
+            fingerprint_cache_remove(opts, RENDER_CACHE, entry->target_path);
+            state_db_forget(opts, entry->target_path);
+        }
+    } else if (opts->verbose) {
+        log_info("Destino inexistente: %s", entry->target_path);
+    }
+    return !opts->restore_backups || backup_catalog_restore(opts, entry->target_path);
+}
+
+bool render_collect_entry(const AppOptions *opts, const DotfileConfig *config, const DotfileEntry *entry) {
+    if (!opts || !config || !entry) {
+        return false;
+    }
+    FileFingerprint cached;
+    bool has_cache = false;
+    if (inspect_target(opts, entry->target_path, &cached, &has_cache) == TARGET_MODIFIED) {
+        log_warn("Alterações locais em %s não são coletadas; porte-as para o template %s",
+                 entry->target_path, entry->source_path);
+        return true;
+    }
+    return render_install_entry(opts, config, entry);
+}
@@ -0,0 +1,107 @@
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "bufwriter.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <process.h>
+#define getpid _getpid
+#endif
+
+static BufWriter writer;
+static bool tracing;
+static uint64_t origin_ns;
+static long process_id;
+static size_t event_count;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int next_tid = 1;
+static _Thread_local int thread_tid;
+
+static void write_separator(void) {
+    bufwriter_puts(&writer, event_count++ ? ",\n" : "\n");
+}
+
+/* Chamado com trace_lock adquirido. */
+static int current_tid(void) {
+    if (thread_tid) {
+        return thread_tid;
+    }
+    thread_tid = atomic_fetch_add(&next_tid, 1);
+    write_separator();
+    bufwriter_printf(&writer,
+                     "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%d,\"args\":{\"name\":",
+                     process_id, thread_tid);
+    char name[32];
+    if (thread_tid == 1) {
+        snprintf(name, sizeof(name), "main");
+    } else {
+        snprintf(name, sizeof(name), "worker-%d", thread_tid - 1);
+    }
+    bufwriter_json_string(&writer, name);
+    bufwriter_puts(&writer, "}}");
+    return thread_tid;
+}
+
+bool trace_open(const char *path) {
+    if (!bufwriter_open(&writer, path, BUFWRITER_DEFAULT_CAPACITY)) {
+        return false;
+    }
+    origin_ns = monotonic_ns();
+    process_id = (long)getpid();
+    event_count = 0;
+    bufwriter_puts(&writer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    tracing = true;
+    return true;
+}
+
+bool trace_enabled(void) {
+    return tracing;
+}
+
+void trace_complete(const char *name, const char *category, uint64_t start_ns, uint64_t duration_ns,
+                    const char *detail) {
+    if (!tracing) {
+        return;
+    }
+    uint64_t offset = start_ns > origin_ns ? start_ns - origin_ns : 0;
+    pthread_mutex_lock(&trace_lock);
+    if (!tracing) {
+        pthread_mutex_unlock(&trace_lock);
+        return;
+    }
+    int tid = current_tid();
+    write_separator();
+    bufwriter_puts(&writer, "{\"name\":");
+    bufwriter_json_string(&writer, name);
+    bufwriter_printf(&writer, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu.%03u,\"dur\":%llu.%03u,\"pid\":%ld,\"tid\":%d",
+                     category, (unsigned long long)(offset / 1000), (unsigned)(offset % 1000),
+                     (unsigned long long)(duration_ns / 1000), (unsigned)(duration_ns % 1000), process_id, tid);
+    if (detail) {
+        bufwriter_puts(&writer, ",\"args\":{\"detail\":");
+        bufwriter_json_string(&writer, detail);
+        bufwriter_puts(&writer, "}");
+    }
+    bufwriter_puts(&writer, "}");
+    pthread_mutex_unlock(&trace_lock);
+}
+
+bool trace_close(void) {
+    if (!tracing) {
+        return true;
+    }
+    pthread_mutex_lock(&trace_lock);
+    tracing = false;
+    bufwriter_puts(&writer, "\n]}\n");
+    bool ok = bufwriter_close(&writer);
+    pthread_mutex_unlock(&trace_lock);
+    if (!ok) {
+        log_error("Falha ao gravar arquivo de trace");
+    }
+    return ok;
+}
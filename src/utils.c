@@ -1,10 +1,17 @@
+#define _DEFAULT_SOURCE
+
 #include "utils.h"
 
 #include <errno.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#include "io_sched.h"
+#include "profile.h"
 
 #ifdef _WIN32
 #include <direct.h>
@@ -50,7 +57,25 @@ typedef struct {
 #define PATH_SEP '/'
 #endif
 
-static void vlog_with_color(const char *color, const char *fmt, va_list args) {
+static LogSink log_sink;
+static void *log_sink_user;
+
+void log_set_sink(LogSink sink, void *user) {
+    log_sink = sink;
+    log_sink_user = user;
+}
+
+static void vlog_with_color(LogLevel level, const char *color, const char *fmt, va_list args) {
+    LogSink sink = log_sink;
+    if (sink) {
+        char message[2 * PATH_MAX];
+        vsnprintf(message, sizeof(message), fmt, args);
+        sink(level, message, log_sink_user);
+        return;
+    }
+#ifndef _WIN32
+    flockfile(stderr);
+#endif
     if (color) {
         fprintf(stderr, "%s", color);
     }
@@ -59,26 +84,29 @@ static void vlog_with_color(const char *color, const char *fmt, va_list args) {
         fprintf(stderr, "%s", LOG_COLOR_RESET);
     }
     fprintf(stderr, "\n");
+#ifndef _WIN32
+    funlockfile(stderr);
+#endif
 }
 
 void log_info(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    vlog_with_color(LOG_COLOR_INFO, fmt, args);
+    vlog_with_color(LOG_LEVEL_INFO, LOG_COLOR_INFO, fmt, args);
     va_end(args);
 }
 
 void log_warn(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    vlog_with_color(LOG_COLOR_WARN, fmt, args);
+    vlog_with_color(LOG_LEVEL_WARN, LOG_COLOR_WARN, fmt, args);
     va_end(args);
 }
 
 void log_error(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    vlog_with_color(LOG_COLOR_ERROR, fmt, args);
+    vlog_with_color(LOG_LEVEL_ERROR, LOG_COLOR_ERROR, fmt, args);
     va_end(args);
 }
 
@@ -143,10 +171,12 @@ bool path_exists(const char *path) {
     if (!path) {
         return false;
     }
+    fs_op(PROFILE_FS_ACCESS);
     return ACCESS(path, 0) == 0;
 }
 
 bool read_symlink_target(const char *link_path, char *buffer, size_t len) {
+    fs_op(PROFILE_FS_READLINK);
 #ifndef _WIN32
     ssize_t read_len = readlink(link_path, buffer, len - 1);
     if (read_len == -1) {
@@ -342,10 +372,11 @@ bool is_same_symlink_target(const char *link_path, const char *target) {
 #endif
 }
 
-static bool create_dir_if_missing(const char *path) {
+bool create_dir_if_missing(const char *path) {
     if (path_exists(path)) {
         return true;
     }
+    fs_op(PROFILE_FS_MKDIR);
     if (MKDIR(path) == 0) {
         return true;
     }
@@ -356,10 +387,7 @@ static bool create_dir_if_missing(const char *path) {
     return false;
 }
 
-bool ensure_parent_dirs(const char *path, bool dry_run) {
-    if (!path) {
-        return false;
-    }
+static bool create_parent_dirs(const char *path, bool dry_run) {
     char buffer[PATH_MAX];
     if (strlen(path) >= sizeof(buffer)) {
         return false;
@@ -382,20 +410,249 @@ bool ensure_parent_dirs(const char *path, bool dry_run) {
     return true;
 }
 
-bool normalize_path(const char *path, char *output, size_t len) {
-    if (!path || !output) {
+bool ensure_parent_dirs(const char *path, bool dry_run) {
+    if (!path) {
         return false;
     }
-#ifdef _WIN32
-    if (_fullpath(output, path, len) == NULL) {
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_MKDIR);
+    bool ok = create_parent_dirs(path, dry_run);
+    profile_end_detail(&span, path);
+    return ok;
+}
+
+bool make_dirs(const char *path) {
+    if (!path || !*path) {
+        return false;
+    }
+    if (path_exists(path)) {
+        return true;
+    }
+    return ensure_parent_dirs(path, false) && create_dir_if_missing(path);
+}
+
+bool read_file_contents(const char *path, char **data, size_t *len) {
+    if (!path || !data || !len) {
         return false;
     }
+    fs_op(PROFILE_FS_OPEN);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return false;
+    }
+    size_t capacity = 4096;
+    size_t used = 0;
+    char *buffer = malloc(capacity + 1);
+    while (buffer) {
+        size_t read_bytes = fread(buffer + used, 1, capacity - used, fp);
+        used += read_bytes;
+        if (used < capacity) {
+            break;
+        }
+        capacity *= 2;
+        char *tmp = realloc(buffer, capacity + 1);
+        if (!tmp) {
+            free(buffer);
+            buffer = NULL;
+            break;
+        }
+        buffer = tmp;
+    }
+    bool ok = buffer && !ferror(fp);
+    fclose(fp);
+    if (!ok) {
+        free(buffer);
+        return false;
+    }
+    buffer[used] = '\0';
+    *data = buffer;
+    *len = used;
     return true;
+}
+
+bool write_file_atomic(const char *path, const void *data, size_t len, int mode) {
+    if (!path || (!data && len > 0)) {
+        return false;
+    }
+    char tmp_path[PATH_MAX + 32];
+    FILE *fp = open_sibling_temp(path, tmp_path, sizeof(tmp_path));
+    if (!fp) {
+        log_error("Não foi possível criar temporário para '%s': %s", path, strerror(errno));
+        return false;
+    }
+    bool ok = fwrite(data, 1, len, fp) == len;
+    ok = fclose(fp) == 0 && ok;
+#ifndef _WIN32
+    if (ok && mode > 0) {
+        chmod(tmp_path, (mode_t)mode);
+    }
+#else
+    (void)mode;
+    remove(path);
+#endif
+    fs_op(PROFILE_FS_RENAME);
+    if (ok && rename(tmp_path, path) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        log_error("Falha ao gravar '%s': %s", path, strerror(errno));
+        remove(tmp_path);
+    }
+    return ok;
+}
+
+/* Temporário de nome único ao lado de path (mkstemp, 0644; no Windows, pid mais um contador e "x"), para
+ * gravar por inteiro e renomear por cima: processos e threads concorrentes nunca escrevem no mesmo. */
+FILE *open_sibling_temp(const char *path, char *tmp_path, size_t len) {
+#ifdef _WIN32
+    static atomic_uint temp_counter;
+    unsigned serial = atomic_fetch_add(&temp_counter, 1);
+    if (snprintf(tmp_path, len, "%s.dotmgr-tmp.%lu.%u", path, (unsigned long)GetCurrentProcessId(), serial) >=
+        (int)len) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    fs_op(PROFILE_FS_OPEN);
+    return fopen(tmp_path, "wbx");
 #else
-    if (!realpath(path, output)) {
+    if (snprintf(tmp_path, len, "%s.XXXXXX", path) >= (int)len) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    fs_op(PROFILE_FS_OPEN);
+    int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        return NULL;
+    }
+    fchmod(fd, 0644);
+    FILE *fp = fdopen(fd, "wb");
+    if (!fp) {
+        close(fd);
+        remove(tmp_path);
+    }
+    return fp;
+#endif
+}
+
+bool get_state_directory(char *output, size_t len) {
+    if (!output || len == 0) {
         return false;
     }
+#ifdef _WIN32
+    const char *base = getenv("LOCALAPPDATA");
+    if (base) {
+        return join_paths(base, "dotmgr", output, len);
+    }
+#else
+    const char *base = getenv("XDG_STATE_HOME");
+    if (base && is_absolute_path(base)) {
+        return join_paths(base, "dotmgr", output, len);
+    }
+#endif
+    const char *home = getenv("HOME");
+#ifdef _WIN32
+    if (!home) {
+        home = getenv("USERPROFILE");
+    }
+#endif
+    if (!home) {
+        return false;
+    }
+    return snprintf(output, len, "%s%c.local%cstate%cdotmgr", home, PATH_SEP, PATH_SEP, PATH_SEP) < (int)len;
+}
+
+bool normalize_path(const char *path, char *output, size_t len) {
+    if (!path || !output) {
+        return false;
+    }
+    ProfileSpan span;
+    profile_begin(&span, PROFILE_NORMALIZE);
+    fs_op(PROFILE_FS_REALPATH);
+#ifdef _WIN32
+    bool ok = _fullpath(output, path, len) != NULL;
+#else
+    bool ok = realpath(path, output) != NULL;
     (void)len;
-    return true;
+#endif
+    profile_end(&span);
+    return ok;
+}
+
+uint64_t hash_fnv1a64(const void *data, size_t len, uint64_t seed) {
+    const unsigned char *bytes = data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool normalize_link_path(const char *path, char *output, size_t len) {
+    if (!path || !output) {
+        return false;
+    }
+    char buffer[PATH_MAX];
+    if (snprintf(buffer, sizeof(buffer), "%s", path) >= (int)sizeof(buffer)) {
+        return false;
+    }
+    size_t end = strlen(buffer);
+    while (end > 1 && (buffer[end - 1] == '/' || buffer[end - 1] == '\\')) {
+        buffer[--end] = '\0';
+    }
+    char *sep = strrchr(buffer, '/');
+#ifdef _WIN32
+    char *back = strrchr(buffer, '\\');
+    if (back && (!sep || back > sep)) {
+        sep = back;
+    }
+#endif
+    if (!sep || sep == buffer || sep[1] == '\0') {
+        return normalize_path(buffer, output, len);
+    }
+    *sep = '\0';
+    char parent[PATH_MAX];
+    if (!normalize_path(buffer, parent, sizeof(parent))) {
+        return snprintf(output, len, "%s%c%s", buffer, PATH_SEP, sep + 1) < (int)len;
+    }
+    return join_paths(parent, sep + 1, output, len);
+}
+
+int default_job_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    long count = (long)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (count < 1) {
+        return 1;
+    }
+    return count > 8 ? 8 : (int)count;
+}
+
+#ifndef _WIN32
+/* st_mtim é do POSIX 2008 (Linux, BSDs); o macOS só expõe st_mtimespec. */
+long long stat_mtime_ns(const struct stat *st) {
+#ifdef __APPLE__
+    return (long long)st->st_mtimespec.tv_sec * 1000000000LL + (long long)st->st_mtimespec.tv_nsec;
+#else
+    return (long long)st->st_mtim.tv_sec * 1000000000LL + (long long)st->st_mtim.tv_nsec;
+#endif
+}
+#endif
+
+uint64_t monotonic_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 #endif
 }
@@ -0,0 +1,97 @@
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "checkpoint.h"
+#include "utils.h"
+
+#ifndef _WIN32
+static AppOptions opts;
+
+static void test_round_trip(void) {
+    opts.resume = false;
+    assert(checkpoint_begin(&opts));
+    assert(checkpoint_active());
+    assert(!checkpoint_done("/t/a"));
+    checkpoint_mark_done("/t/a");
+    checkpoint_save_partial("/r/big", 100, 1000, 42);
+    checkpoint_end(false);
+
+    opts.resume = true;
+    assert(checkpoint_begin(&opts));
+    assert(checkpoint_done("/t/a"));
+    assert(!checkpoint_done("/t/b"));
+    long long offset = -1;
+    assert(checkpoint_partial("/r/big", 1000, 42, &offset));
+    assert(offset == 100);
+    /* A fonte mudou desde a cópia parcial: recomeça do zero. */
+    assert(!checkpoint_partial("/r/big", 2000, 42, &offset));
+    assert(!checkpoint_partial("/r/big", 1000, 43, &offset));
+    assert(!checkpoint_partial("/r/other", 1000, 42, &offset));
+    checkpoint_end(true);
+
+    /* Execução completa apaga o checkpoint: nada a retomar. */
+    assert(checkpoint_begin(&opts));
+    assert(!checkpoint_done("/t/a"));
+    checkpoint_end(true);
+}
+
+/* Sem --resume, um checkpoint anterior é ignorado e substituído. */
+static void test_without_resume(void) {
+    opts.resume = false;
+    assert(checkpoint_begin(&opts));
+    checkpoint_mark_done("/t/a");
+    checkpoint_end(false);
+
+    assert(checkpoint_begin(&opts));
+    assert(!checkpoint_done("/t/a"));
+    checkpoint_end(true);
+}
+
+/* Cada config tem seu próprio arquivo. */
+static void test_keyed_per_config(void) {
+    opts.resume = false;
+    assert(checkpoint_begin(&opts));
+    checkpoint_mark_done("/t/a");
+    checkpoint_end(false);
+
+    snprintf(opts.config_path, sizeof(opts.config_path), "/outra/dotfiles.conf");
+    opts.resume = true;
+    assert(checkpoint_begin(&opts));
+    assert(!checkpoint_done("/t/a"));
+    checkpoint_end(true);
+
+    snprintf(opts.config_path, sizeof(opts.config_path), "/repo/dotfiles.conf");
+    assert(checkpoint_begin(&opts));
+    assert(checkpoint_done("/t/a"));
+    checkpoint_end(true);
+}
+
+int main(void) {
+    char base[] = "/tmp/dotmgr-checkpoint-XXXXXX";
+    assert(mkdtemp(base) != NULL);
+    memset(&opts, 0, sizeof(opts));
+    opts.command = CMD_INSTALL;
+    snprintf(opts.state_dir, sizeof(opts.state_dir), "%s", base);
+    snprintf(opts.config_path, sizeof(opts.config_path), "/repo/dotfiles.conf");
+    snprintf(opts.repo_path, sizeof(opts.repo_path), "/repo");
+
+    test_round_trip();
+    test_without_resume();
+    test_keyed_per_config();
+
+    char command[PATH_MAX + 16];
+    snprintf(command, sizeof(command), "rm -rf '%s'", base);
+    assert(system(command) == 0);
+    printf("All checkpoint tests passed.\n");
+    return 0;
+}
+#else
+int main(void) {
+    printf("checkpoint tests skipped on Windows.\n");
+    return 0;
+}
+#endif
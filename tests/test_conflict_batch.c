@@ -0,0 +1,38 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "conflict_batch.h"
+
+static void test_directory_patterns(void) {
+    assert(conflict_pattern_matches("/h/.config/", "/h/.config"));
+    assert(conflict_pattern_matches("/h/.config/", "/h/.config/nvim/init.lua"));
+    assert(!conflict_pattern_matches("/h/.config/", "/h/.configs"));
+    assert(!conflict_pattern_matches("/h/.config/", "/h/.conf"));
+}
+
+static void test_name_globs(void) {
+    assert(conflict_pattern_matches("*.conf", "/h/.config/app.conf"));
+    assert(conflict_pattern_matches("*.conf", "app.conf"));
+    assert(!conflict_pattern_matches("*.conf", "/h/app.conf.bak"));
+    assert(!conflict_pattern_matches("*.conf", "/h/app.conf/init"));
+    assert(conflict_pattern_matches(".bash?c", "/h/.bashrc"));
+    assert(!conflict_pattern_matches(".bash?c", "/h/.bash_rc"));
+    assert(conflict_pattern_matches("*", "/h/anything"));
+}
+
+static void test_path_globs(void) {
+    assert(conflict_pattern_matches("/h/.local/*", "/h/.local/bin"));
+    assert(conflict_pattern_matches("/h/.local/*", "/h/.local/share/app"));
+    assert(!conflict_pattern_matches("/h/.local/*", "/h/.localrc"));
+    assert(conflict_pattern_matches("/h/.?imrc", "/h/.vimrc"));
+    assert(!conflict_pattern_matches("/h/.?imrc", "/x/h/.vimrc"));
+    assert(conflict_pattern_matches("/h/**.toml", "/h/a/b.toml"));
+}
+
+int main(void) {
+    test_directory_patterns();
+    test_name_globs();
+    test_path_globs();
+    printf("All conflict_batch tests passed.\n");
+    return 0;
+}
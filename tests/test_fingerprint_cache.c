@@ -0,0 +1,80 @@
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fingerprint_cache.h"
+#include "utils.h"
+
+#ifndef _WIN32
+static AppOptions opts;
+
+static FileFingerprint fingerprint(uint64_t hash) {
+    FileFingerprint fp;
+    memset(&fp, 0, sizeof(fp));
+    fp.input_hash = hash;
+    fp.content_hash = hash;
+    fp.size = (long long)hash;
+    return fp;
+}
+
+static bool has(const char *key, uint64_t hash) {
+    FileFingerprint fp;
+    return fingerprint_cache_get(&opts, "test", key, &fp) && fp.input_hash == hash;
+}
+
+static void append_cache(const char *line) {
+    char path[PATH_MAX];
+    assert(join_paths(opts.state_dir, "test-cache.tsv", path, sizeof(path)));
+    FILE *fp = fopen(path, "a");
+    assert(fp != NULL);
+    fputs(line, fp);
+    fclose(fp);
+}
+
+/* O que outra execução gravou depois do carregamento sobrevive; só as chaves alteradas aqui a sobrescrevem. */
+static void test_flush_merges_disk(void) {
+    FileFingerprint a = fingerprint(1);
+    FileFingerprint b = fingerprint(2);
+    assert(fingerprint_cache_put(&opts, "test", "a", &a));
+    assert(fingerprint_cache_put(&opts, "test", "b", &b));
+    assert(fingerprint_cache_flush(&opts));
+
+    assert(has("a", 1) && has("b", 2));
+    append_cache("c\t0000000000000003\t0000000000000003\t3\t0\t0\n");
+    append_cache("b\t0000000000000009\t0000000000000009\t9\t0\t0\n");
+    FileFingerprint changed = fingerprint(5);
+    assert(fingerprint_cache_put(&opts, "test", "a", &changed));
+    assert(fingerprint_cache_flush(&opts));
+
+    assert(has("a", 5) && has("b", 9) && has("c", 3));
+    fingerprint_cache_remove(&opts, "test", "c");
+    assert(fingerprint_cache_flush(&opts));
+    assert(has("a", 5) && has("b", 9));
+    FileFingerprint fp;
+    assert(!fingerprint_cache_get(&opts, "test", "c", &fp));
+    assert(fingerprint_cache_flush(&opts));
+}
+
+int main(void) {
+    char base[] = "/tmp/dotmgr-cache-XXXXXX";
+    assert(mkdtemp(base) != NULL);
+    memset(&opts, 0, sizeof(opts));
+    snprintf(opts.state_dir, sizeof(opts.state_dir), "%s", base);
+
+    test_flush_merges_disk();
+
+    char command[PATH_MAX + 16];
+    snprintf(command, sizeof(command), "rm -rf '%s'", base);
+    assert(system(command) == 0);
+    printf("All fingerprint_cache tests passed.\n");
+    return 0;
+}
+#else
+int main(void) {
+    printf("fingerprint_cache tests skipped on Windows.\n");
+    return 0;
+}
+#endif
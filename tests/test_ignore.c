@@ -0,0 +1,76 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "ignore.h"
+
+static IgnoreRules *compile(const char **lines, size_t count) {
+    IgnoreRules *rules = ignore_create();
+    assert(rules != NULL);
+    for (size_t i = 0; i < count; ++i) {
+        assert(ignore_add(rules, lines[i]));
+    }
+    return rules;
+}
+
+static void test_names_and_suffixes(void) {
+    const char *lines[] = {"# comentário", "", "node_modules", "*.swp", "*.tar.gz", "lazy-lock.json\n"};
+    IgnoreRules *rules = compile(lines, sizeof(lines) / sizeof(lines[0]));
+    assert(ignore_count(rules) == 4);
+    assert(ignore_match(rules, "node_modules", true));
+    assert(ignore_match(rules, "pack/node_modules", true));
+    assert(ignore_match(rules, "lua/.init.lua.swp", false));
+    assert(ignore_match(rules, ".swp", false));
+    assert(ignore_match(rules, "dist/a.tar.gz", false));
+    assert(!ignore_match(rules, "dist/a.gz", false));
+    assert(ignore_match(rules, "lazy-lock.json", false));
+    assert(!ignore_match(rules, "init.lua", false));
+    assert(!ignore_match(rules, "node_modules_x", true));
+    ignore_free(rules);
+}
+
+static void test_anchored_and_directories(void) {
+    const char *lines[] = {"/plugin/packer_compiled.lua", "cache/", "doc/*.txt", "spell/**/*.spl"};
+    IgnoreRules *rules = compile(lines, sizeof(lines) / sizeof(lines[0]));
+    assert(ignore_match(rules, "plugin/packer_compiled.lua", false));
+    assert(!ignore_match(rules, "lua/plugin/packer_compiled.lua", false));
+    assert(ignore_match(rules, "cache", true));
+    assert(ignore_match(rules, "a/b/cache", true));
+    assert(!ignore_match(rules, "cache", false));
+    assert(ignore_match(rules, "doc/help.txt", false));
+    assert(!ignore_match(rules, "doc/sub/help.txt", false));
+    assert(ignore_match(rules, "spell/en.spl", false));
+    assert(ignore_match(rules, "spell/a/b/pt.spl", false));
+    ignore_free(rules);
+}
+
+static void test_negation_and_globs(void) {
+    const char *lines[] = {"*.log", "!keep.log", "sess?on-[0-9]*", "**/tmp", "build/**", "\\#notes"};
+    IgnoreRules *rules = compile(lines, sizeof(lines) / sizeof(lines[0]));
+    assert(ignore_match(rules, "x/debug.log", false));
+    assert(!ignore_match(rules, "x/keep.log", false));
+    assert(ignore_match(rules, "session-1", false));
+    assert(!ignore_match(rules, "session-a", false));
+    assert(ignore_match(rules, "tmp", true));
+    assert(ignore_match(rules, "a/b/tmp", false));
+    assert(ignore_match(rules, "build/out/bin", false));
+    assert(!ignore_match(rules, "build", true));
+    assert(ignore_match(rules, "#notes", false));
+    ignore_free(rules);
+}
+
+static void test_last_rule_wins(void) {
+    const char *lines[] = {"!*.lua", "*.lua", "init.lua", "!init.lua"};
+    IgnoreRules *rules = compile(lines, sizeof(lines) / sizeof(lines[0]));
+    assert(ignore_match(rules, "plugins.lua", false));
+    assert(!ignore_match(rules, "init.lua", false));
+    ignore_free(rules);
+}
+
+int main(void) {
+    test_names_and_suffixes();
+    test_anchored_and_directories();
+    test_negation_and_globs();
+    test_last_rule_wins();
+    printf("All ignore tests passed.\n");
+    return 0;
+}
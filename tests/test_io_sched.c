@@ -0,0 +1,58 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "io_sched.h"
+
+#define MS 1000000ULL
+
+static IoTokenBucket empty_bucket(void) {
+    IoTokenBucket bucket;
+    memset(&bucket, 0, sizeof(bucket));
+    return bucket;
+}
+
+/* 100 tokens/s: o burst é de 25 tokens e a primeira cobrança já começa com ele. */
+static void test_first_charge_fills_burst(void) {
+    IoTokenBucket bucket = empty_bucket();
+    assert(io_bucket_charge(&bucket, 100.0, 25.0, 1000 * MS) == 0);
+    assert(bucket.tokens == 0.0);
+    assert(bucket.last_ns == 1000 * MS);
+    /* Sem tempo decorrido, cada token a mais custa 10 ms. */
+    assert(io_bucket_charge(&bucket, 100.0, 1.0, 1000 * MS) == 10 * MS);
+    assert(io_bucket_charge(&bucket, 100.0, 1.0, 1000 * MS) == 20 * MS);
+}
+
+static void test_refill(void) {
+    IoTokenBucket bucket = empty_bucket();
+    assert(io_bucket_charge(&bucket, 100.0, 25.0, 1000 * MS) == 0);
+    /* 100 ms repõem 10 tokens. */
+    assert(io_bucket_charge(&bucket, 100.0, 10.0, 1100 * MS) == 0);
+    assert(bucket.tokens == 0.0);
+    assert(io_bucket_charge(&bucket, 100.0, 15.0, 1200 * MS) == 50 * MS);
+}
+
+/* Uma pausa longa não acumula mais que o burst. */
+static void test_refill_capped_at_burst(void) {
+    IoTokenBucket bucket = empty_bucket();
+    assert(io_bucket_charge(&bucket, 100.0, 1.0, 1000 * MS) == 0);
+    assert(io_bucket_charge(&bucket, 100.0, 0.0, 61000 * MS) == 0);
+    assert(bucket.tokens == 25.0);
+    assert(io_bucket_charge(&bucket, 100.0, 35.0, 61000 * MS) == 100 * MS);
+}
+
+/* O saldo negativo é uma fila: a espera de quem chega depois conta a dívida de quem veio antes. */
+static void test_debt_accumulates(void) {
+    IoTokenBucket bucket = empty_bucket();
+    assert(io_bucket_charge(&bucket, 1000.0, 250.0 + 500.0, 1000 * MS) == 500 * MS);
+    assert(io_bucket_charge(&bucket, 1000.0, 100.0, 1200 * MS) == 400 * MS);
+}
+
+int main(void) {
+    test_first_charge_fills_burst();
+    test_refill();
+    test_refill_capped_at_burst();
+    test_debt_accumulates();
+    printf("All io_sched tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "link_gc.h"
+
+static void check_clean(const char *path, const char *expected) {
+    char buffer[PATH_MAX];
+    assert(gc_clean_path(path, buffer, sizeof(buffer)));
+    assert(strcmp(buffer, expected) == 0);
+}
+
+static void test_clean_path(void) {
+    check_clean("/h/./a", "/h/a");
+    check_clean("/h//a///b/", "/h/a/b");
+    check_clean("/h/a/../b", "/h/b");
+    check_clean("/h/a/b/../../c", "/h/c");
+    check_clean("/..", "/");
+    check_clean("/h/../../..", "/");
+    check_clean("/", "/");
+    check_clean("//", "/");
+    check_clean("/h/...", "/h/...");
+    check_clean("/h/.a/..b", "/h/.a/..b");
+}
+
+static void test_clean_path_overflow(void) {
+    char small[6];
+    assert(gc_clean_path("/abcd", small, sizeof(small)));
+    assert(strcmp(small, "/abcd") == 0);
+    assert(!gc_clean_path("/abcde", small, sizeof(small)));
+    assert(gc_clean_path("/abcdefgh/..", small, sizeof(small)) == false);
+    char tiny[1];
+    assert(!gc_clean_path("/", tiny, sizeof(tiny)));
+}
+
+static void test_skip_matches(void) {
+    assert(gc_skip_matches("node_modules", "src/app/node_modules", "node_modules"));
+    assert(!gc_skip_matches("node_modules", "src/node_modules_old", "node_modules_old"));
+    assert(gc_skip_matches(".cache/go", ".cache/go", "go"));
+    assert(!gc_skip_matches(".cache/go", "src/.cache/go", "go"));
+    assert(!gc_skip_matches(".cache/go", "go", "go"));
+}
+
+int main(void) {
+    test_clean_path();
+    test_clean_path_overflow();
+    test_skip_matches();
+    printf("All link_gc tests passed.\n");
+    return 0;
+}
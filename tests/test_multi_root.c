@@ -0,0 +1,71 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "multi_root.h"
+
+static RootSpec root(const char *path, RootKind kind) {
+    RootSpec spec;
+    memset(&spec, 0, sizeof(spec));
+    snprintf(spec.path, sizeof(spec.path), "%s", path);
+    spec.kind = kind;
+    return spec;
+}
+
+static void test_prefix_root(void) {
+    char buffer[PATH_MAX];
+    bool outside = true;
+    RootSpec image = root("/mnt/image", ROOT_PREFIX);
+    assert(root_rebase_target(&image, "/home/u", "/home/u", "/home/u/.bashrc", buffer, sizeof(buffer), &outside));
+    assert(!outside);
+    assert(strcmp(buffer, "/mnt/image/home/u/.bashrc") == 0);
+    assert(root_rebase_target(&image, "/home/u", "/home/u", "/etc/hosts", buffer, sizeof(buffer), &outside));
+    assert(strcmp(buffer, "/mnt/image/etc/hosts") == 0);
+
+    RootSpec slash = root("/", ROOT_PREFIX);
+    assert(root_rebase_target(&slash, "/home/u", "/home/u", "/etc/hosts", buffer, sizeof(buffer), &outside));
+    assert(strcmp(buffer, "/etc/hosts") == 0);
+}
+
+static void test_home_root(void) {
+    char buffer[PATH_MAX];
+    bool outside = true;
+    RootSpec other = root("/home/v", ROOT_HOME);
+    assert(root_rebase_target(&other, "/home/u", "/home/u", "/home/u/.config/git", buffer, sizeof(buffer), &outside));
+    assert(!outside);
+    assert(strcmp(buffer, "/home/v/.config/git") == 0);
+    assert(root_rebase_target(&other, "/home/u", "/home/u", "/home/u", buffer, sizeof(buffer), &outside));
+    assert(strcmp(buffer, "/home/v") == 0);
+    /* As duas grafias do HOME valem. */
+    assert(root_rebase_target(&other, "/home/u/", "/home/u", "/home/u/.vimrc", buffer, sizeof(buffer), &outside));
+    assert(strcmp(buffer, "/home/v/.vimrc") == 0);
+    assert(root_rebase_target(&other, "/home/u", "/data/u", "/home/u/.vimrc", buffer, sizeof(buffer), &outside));
+    assert(strcmp(buffer, "/home/v/.vimrc") == 0);
+}
+
+static void test_outside_home(void) {
+    char buffer[PATH_MAX];
+    bool outside = false;
+    RootSpec other = root("/home/v", ROOT_HOME);
+    assert(root_rebase_target(&other, "/home/u", "/home/u", "/etc/hosts", buffer, sizeof(buffer), &outside));
+    assert(outside);
+    outside = false;
+    assert(root_rebase_target(&other, "/home/u", "/home/u", "/home/user/.bashrc", buffer, sizeof(buffer), &outside));
+    assert(outside);
+}
+
+static void test_overflow(void) {
+    char small[16];
+    bool outside = false;
+    RootSpec other = root("/home/v", ROOT_HOME);
+    assert(!root_rebase_target(&other, "/home/u", "/home/u", "/home/u/.config/long", small, sizeof(small), &outside));
+}
+
+int main(void) {
+    test_prefix_root();
+    test_home_root();
+    test_outside_home();
+    test_overflow();
+    printf("All multi_root tests passed.\n");
+    return 0;
+}
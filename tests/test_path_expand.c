@@ -0,0 +1,77 @@
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "path_expand.h"
+
+static void render(PathVars *vars, const char *raw, char *buffer, size_t len) {
+    PathTemplate tpl;
+    assert(path_template_compile(raw, &tpl));
+    assert(path_template_render(&tpl, vars, buffer, len));
+    path_template_free(&tpl);
+}
+
+static void test_env_and_defaults(void) {
+    char buffer[PATH_MAX];
+    PathVars vars;
+    path_vars_init(&vars, NULL);
+#ifdef _WIN32
+    _putenv("HOME=C:/dotmgr-test");
+    _putenv("XDG_CONFIG_HOME=");
+#else
+    setenv("HOME", "/dotmgr-test", 1);
+    unsetenv("XDG_CONFIG_HOME");
+#endif
+    render(&vars, "${XDG_CONFIG_HOME:-~/.config}/nvim", buffer, sizeof(buffer));
+    assert(strstr(buffer, "dotmgr-test") == buffer + strlen(buffer) - strlen("dotmgr-test/.config/nvim"));
+
+    render(&vars, "$HOME/.vimrc", buffer, sizeof(buffer));
+    assert(strcmp(buffer + strlen(buffer) - strlen("/.vimrc"), "/.vimrc") == 0);
+
+    render(&vars, "price$$5", buffer, sizeof(buffer));
+    assert(strcmp(buffer, "price$5") == 0);
+    path_vars_free(&vars);
+}
+
+static void test_machine_and_memo(void) {
+    char buffer[PATH_MAX];
+    AppOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    snprintf(opts.machine_name, sizeof(opts.machine_name), "work");
+    PathVars vars;
+    path_vars_init(&vars, &opts);
+    render(&vars, "bash/{{ machine }}.bashrc", buffer, sizeof(buffer));
+    assert(strcmp(buffer, "bash/work.bashrc") == 0);
+
+#ifndef _WIN32
+    setenv("DOTMGR_TEST_VAR", "a", 1);
+    render(&vars, "$DOTMGR_TEST_VAR", buffer, sizeof(buffer));
+    assert(strcmp(buffer, "a") == 0);
+    uint64_t before = path_vars_fingerprint(&vars);
+    assert(!path_vars_stale(&vars));
+
+    setenv("DOTMGR_TEST_VAR", "b", 1);
+    render(&vars, "$DOTMGR_TEST_VAR", buffer, sizeof(buffer));
+    assert(strcmp(buffer, "a") == 0);
+    assert(path_vars_stale(&vars));
+    assert(path_vars_fingerprint(&vars) == before);
+#endif
+    path_vars_free(&vars);
+}
+
+static void test_invalid(void) {
+    PathTemplate tpl;
+    assert(!path_template_compile("${UNTERMINATED", &tpl));
+    assert(!path_template_compile("{{}}", &tpl));
+}
+
+int main(void) {
+    test_env_and_defaults();
+    test_machine_and_memo();
+    test_invalid();
+    printf("All path_expand tests passed.\n");
+    return 0;
+}
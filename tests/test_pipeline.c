@@ -0,0 +1,76 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pipeline.h"
+#include "utils.h"
+
+static size_t warnings;
+
+static void count_warnings(LogLevel level, const char *message, void *user) {
+    (void)message;
+    (void)user;
+    if (level == LOG_LEVEL_WARN) {
+        ++warnings;
+    }
+}
+
+static PipelineTargetIndex index_new(void) {
+    PipelineTargetIndex index;
+    memset(&index, 0, sizeof(index));
+    assert(strmap_init(&index.targets, 16));
+    assert(strmap_init(&index.parents, 16));
+    return index;
+}
+
+static void index_free(PipelineTargetIndex *index) {
+    strmap_free(&index->targets);
+    strmap_free(&index->parents);
+}
+
+static void test_distinct_targets(void) {
+    PipelineTargetIndex index = index_new();
+    assert(pipeline_check_target(&index, "/h/.bashrc", 1) == 0);
+    assert(pipeline_check_target(&index, "/h/.config/nvim", 2) == 0);
+    assert(pipeline_check_target(&index, "/h/.config/git", 3) == 0);
+    assert(pipeline_check_target(&index, "/h/.configs", 4) == 0);
+    assert(warnings == 0);
+    index_free(&index);
+}
+
+static void test_repeated(void) {
+    PipelineTargetIndex index = index_new();
+    assert(pipeline_check_target(&index, "/h/.bashrc", 1) == 0);
+    assert(pipeline_check_target(&index, "/h/.bashrc", 2) == PIPELINE_TARGET_REPEATED);
+    index_free(&index);
+}
+
+static void test_contains(void) {
+    PipelineTargetIndex index = index_new();
+    assert(pipeline_check_target(&index, "/h/.config/nvim/init.lua", 1) == 0);
+    assert(pipeline_check_target(&index, "/h/.config", 2) == PIPELINE_TARGET_CONTAINS);
+    index_free(&index);
+}
+
+static void test_nested(void) {
+    PipelineTargetIndex index = index_new();
+    assert(pipeline_check_target(&index, "/h/.config", 1) == 0);
+    assert(pipeline_check_target(&index, "/h/.config/nvim/init.lua", 2) == PIPELINE_TARGET_NESTED);
+    /* Dentro de um destino e contendo outro: os dois avisos. */
+    assert(pipeline_check_target(&index, "/h/.config/nvim", 3) == (PIPELINE_TARGET_CONTAINS | PIPELINE_TARGET_NESTED));
+    /* Com dois ancestrais configurados, um só aviso de aninhamento. */
+    size_t before = warnings;
+    assert(pipeline_check_target(&index, "/h/.config/nvim/lua/plugins.lua", 4) == PIPELINE_TARGET_NESTED);
+    assert(warnings == before + 1);
+    index_free(&index);
+}
+
+int main(void) {
+    log_set_sink(count_warnings, NULL);
+    test_distinct_targets();
+    test_repeated();
+    test_contains();
+    test_nested();
+    printf("All pipeline tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plan.h"
+
+static const char *sample_plan =
+    "# dotmgr plan v1\n"
+    "0\tmkdir\t-\td\tabsent\t/home/u/.config\t-\n"
+    "1\tbackup\t0\t-\tfile:42:1700000000\t/home/u/.config/app.conf\t/home/u/.config/app.conf.bak\n"
+    "2\tsymlink\t0,1\t-\tabsent\t/home/u/.config/app.conf\t/repo/app.conf\n"
+    "3\tunlink\t-\t-\tlink:/repo/old\t/home/u/.old\t-\n"
+    "4\tcopy\t-\td\tany\t/home/u/.vim\t/repo/vim\n";
+
+static FILE *file_with(const char *contents) {
+    FILE *fp = tmpfile();
+    assert(fp != NULL);
+    assert(fputs(contents, fp) >= 0);
+    rewind(fp);
+    return fp;
+}
+
+static char *read_back(FILE *fp) {
+    long size = ftell(fp);
+    assert(size >= 0);
+    char *data = calloc((size_t)size + 1, 1);
+    assert(data != NULL);
+    rewind(fp);
+    assert(fread(data, 1, (size_t)size, fp) == (size_t)size);
+    return data;
+}
+
+static void test_round_trip(void) {
+    FILE *in = file_with(sample_plan);
+    Plan plan;
+    assert(plan_read(in, &plan));
+    fclose(in);
+
+    assert(plan.count == 5);
+    assert(plan.ops[0].type == PLAN_OP_MKDIR && plan.ops[0].is_directory);
+    assert(plan.ops[0].expect.kind == PLAN_EXPECT_ABSENT);
+    assert(plan.ops[1].type == PLAN_OP_BACKUP);
+    assert(plan.ops[1].expect.kind == PLAN_EXPECT_FILE);
+    assert(plan.ops[1].expect.size == 42 && plan.ops[1].expect.mtime == 1700000000);
+    assert(strcmp(plan.ops[1].arg, "/home/u/.config/app.conf.bak") == 0);
+    assert(plan.ops[2].dep_count == 2 && plan.ops[2].deps[0] == 0 && plan.ops[2].deps[1] == 1);
+    assert(plan.ops[3].expect.kind == PLAN_EXPECT_LINK);
+    assert(strcmp(plan.ops[3].expect.link_target, "/repo/old") == 0);
+    assert(plan.ops[3].arg == NULL);
+    assert(plan.ops[4].type == PLAN_OP_COPY && plan.ops[4].expect.kind == PLAN_EXPECT_ANY);
+
+    FILE *out = tmpfile();
+    assert(out != NULL);
+    assert(plan_write(&plan, out));
+    char *written = read_back(out);
+    fclose(out);
+    assert(strcmp(written, sample_plan) == 0);
+    free(written);
+    plan_free(&plan);
+}
+
+static void test_rejects_invalid(void) {
+    const char *invalid[] = {
+        "",
+        "0\tmkdir\t-\td\tabsent\t/a\t-\n",
+        "# dotmgr plan v1\n1\tmkdir\t-\td\tabsent\t/a\t-\n",
+        "# dotmgr plan v1\n0\trename\t-\t-\tany\t/a\t-\n",
+        "# dotmgr plan v1\n0\tmkdir\t0\td\tabsent\t/a\t-\n",
+        "# dotmgr plan v1\n0\tmkdir\t-\td\tfile:x\t/a\t-\n",
+        "# dotmgr plan v1\n0\tmkdir\t-\td\tabsent\t/a\n",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        FILE *in = file_with(invalid[i]);
+        Plan plan;
+        assert(!plan_read(in, &plan));
+        fclose(in);
+    }
+}
+
+static void test_rejects_unserializable_paths(void) {
+    FILE *in = file_with("# dotmgr plan v1\n0\tmkdir\t-\td\tabsent\t/a\t-\n");
+    Plan plan;
+    assert(plan_read(in, &plan));
+    fclose(in);
+    char *bad = malloc(8);
+    assert(bad != NULL);
+    strcpy(bad, "/a\nb");
+    free(plan.ops[0].path);
+    plan.ops[0].path = bad;
+    FILE *out = tmpfile();
+    assert(out != NULL);
+    assert(!plan_write(&plan, out));
+    fclose(out);
+    plan_free(&plan);
+}
+
+int main(void) {
+    test_round_trip();
+    test_rejects_invalid();
+    test_rejects_unserializable_paths();
+    printf("All plan tests passed.\n");
+    return 0;
+}
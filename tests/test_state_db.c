@@ -0,0 +1,229 @@
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "state_db.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+
+static AppOptions opts;
+static char state_dir[PATH_MAX];
+static char files_dir[PATH_MAX];
+static bool alternate;
+
+/* state_db mantém o banco carregado por diretório: alternar a grafia do mesmo diretório força reler o disco. */
+static const AppOptions *reopen(void) {
+    alternate = !alternate;
+    snprintf(opts.state_dir, sizeof(opts.state_dir), alternate ? "%s/." : "%s", state_dir);
+    return &opts;
+}
+
+static void file_path(const char *name, char *out) {
+    assert(join_paths(files_dir, name, out, PATH_MAX));
+}
+
+static void touch(const char *name) {
+    char path[PATH_MAX];
+    file_path(name, path);
+    FILE *fp = fopen(path, "w");
+    assert(fp != NULL);
+    fputs(name, fp);
+    fclose(fp);
+}
+
+static void record(StateKind kind, const char *name, const char *source) {
+    char path[PATH_MAX];
+    file_path(name, path);
+    assert(state_db_record(&opts, kind, path, source));
+}
+
+static bool lookup(const char *name, StateRecord *found) {
+    char path[PATH_MAX];
+    char buffer[3 * PATH_MAX];
+    static char source[PATH_MAX];
+    file_path(name, path);
+    if (!state_db_lookup(&opts, path, found, buffer, sizeof(buffer))) {
+        return false;
+    }
+    snprintf(source, sizeof(source), "%s", found->source);
+    found->source = source;
+    found->target = NULL;
+    found->scope = NULL;
+    return true;
+}
+
+static bool count_visit(const StateRecord *record, void *user) {
+    (void)record;
+    ++*(size_t *)user;
+    return true;
+}
+
+static size_t live_count(void) {
+    size_t count = 0;
+    assert(state_db_each(&opts, count_visit, &count));
+    return count;
+}
+
+static size_t log_lines(void) {
+    char path[PATH_MAX];
+    assert(join_paths(state_dir, "state.log", path, sizeof(path)));
+    FILE *fp = fopen(path, "r");
+    assert(fp != NULL);
+    size_t lines = 0;
+    int c;
+    while ((c = fgetc(fp)) != EOF) {
+        lines += c == '\n';
+    }
+    fclose(fp);
+    return lines;
+}
+
+static void append_log(const char *line) {
+    char path[PATH_MAX];
+    assert(join_paths(state_dir, "state.log", path, sizeof(path)));
+    FILE *fp = fopen(path, "a");
+    assert(fp != NULL);
+    fputs(line, fp);
+    fclose(fp);
+}
+
+static void test_round_trip(void) {
+    touch("a");
+    touch("b");
+    touch("c");
+    reopen();
+    record(STATE_LINK, "a", "src-a");
+    record(STATE_COPY, "b", "src-b");
+    record(STATE_RENDER, "c", "src-c");
+    char path[PATH_MAX];
+    file_path("c", path);
+    state_db_forget(&opts, path);
+    assert(state_db_flush(&opts));
+
+    char index[PATH_MAX];
+    assert(join_paths(state_dir, "state.idx", index, sizeof(index)));
+    assert(path_exists(index));
+
+    reopen();
+    StateRecord found;
+    assert(lookup("a", &found) && found.kind == STATE_LINK && strcmp(found.source, "src-a") == 0);
+    assert(lookup("b", &found) && found.kind == STATE_COPY && strcmp(found.source, "src-b") == 0);
+    assert(!lookup("c", &found));
+    assert(live_count() == 2);
+}
+
+static void test_tail_after_snapshot(void) {
+    touch("d");
+    reopen();
+    record(STATE_HARDLINK, "d", "src-d");
+    assert(state_db_flush(&opts));
+
+    reopen();
+    StateRecord found;
+    assert(lookup("d", &found) && found.kind == STATE_HARDLINK);
+    assert(lookup("a", &found) && found.kind == STATE_LINK);
+    assert(live_count() == 3);
+}
+
+/* Linhas que outra execução acrescentou depois deste carregamento sobrevivem ao snapshot desta. */
+static void test_foreign_lines_survive_snapshot(void) {
+    reopen();
+    StateRecord found;
+    assert(lookup("a", &found));
+
+    char path[PATH_MAX];
+    char line[2 * PATH_MAX + 64];
+    file_path("e", path);
+    snprintf(line, sizeof(line), "+\tlink\t1\t2\t3\t\t%s\tsrc-e\n", path);
+    append_log(line);
+    file_path("b", path);
+    snprintf(line, sizeof(line), "-\t%s\n", path);
+    append_log(line);
+    file_path("a", path);
+    snprintf(line, sizeof(line), "-\t%s\n", path);
+    append_log(line);
+
+    record(STATE_LINK, "a", "src-a2");
+    for (int i = 0; i < 70; ++i) {
+        char name[16];
+        snprintf(name, sizeof(name), "bulk%d", i);
+        touch(name);
+        record(STATE_COPY, name, "bulk");
+    }
+    assert(state_db_flush(&opts));
+
+    reopen();
+    assert(lookup("e", &found) && strcmp(found.source, "src-e") == 0);
+    assert(!lookup("b", &found));
+    assert(lookup("a", &found) && strcmp(found.source, "src-a2") == 0);
+    assert(live_count() == 3 + 70);
+}
+
+static void test_bad_index_falls_back_to_log(void) {
+    char index[PATH_MAX];
+    assert(join_paths(state_dir, "state.idx", index, sizeof(index)));
+    char *data = NULL;
+    size_t len = 0;
+    assert(read_file_contents(index, &data, &len) && len > 32);
+
+    assert(truncate(index, (off_t)(len / 2)) == 0);
+    reopen();
+    StateRecord found;
+    assert(lookup("e", &found) && lookup("a", &found) && !lookup("b", &found));
+    assert(live_count() == 73);
+
+    uint64_t stale = UINT64_MAX;
+    memcpy(data + 16, &stale, sizeof(stale));
+    assert(write_file_atomic(index, data, len, 0644));
+    free(data);
+    reopen();
+    assert(lookup("e", &found) && lookup("d", &found) && !lookup("b", &found));
+    assert(live_count() == 73);
+}
+
+static void test_compaction(void) {
+    touch("churn");
+    for (int i = 0; i < 400; ++i) {
+        record(STATE_COPY, "churn", i % 2 ? "odd" : "even");
+        assert(state_db_flush(&opts));
+    }
+    reopen();
+    assert(live_count() == 74);
+    assert(log_lines() < 400);
+    StateRecord found;
+    assert(lookup("churn", &found) && strcmp(found.source, "odd") == 0);
+}
+
+int main(void) {
+    char base[] = "/tmp/dotmgr-state-XXXXXX";
+    assert(mkdtemp(base) != NULL);
+    assert(join_paths(base, "state", state_dir, sizeof(state_dir)));
+    assert(join_paths(base, "files", files_dir, sizeof(files_dir)));
+    assert(make_dirs(files_dir));
+    memset(&opts, 0, sizeof(opts));
+    opts.command = CMD_INSTALL;
+
+    test_round_trip();
+    test_tail_after_snapshot();
+    test_foreign_lines_survive_snapshot();
+    test_bad_index_falls_back_to_log();
+    test_compaction();
+
+    char command[PATH_MAX + 16];
+    snprintf(command, sizeof(command), "rm -rf '%s'", base);
+    assert(system(command) == 0);
+    printf("All state_db tests passed.\n");
+    return 0;
+}
+#else
+int main(void) {
+    printf("state_db tests skipped on Windows.\n");
+    return 0;
+}
+#endif
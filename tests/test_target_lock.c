@@ -0,0 +1,115 @@
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "target_lock.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static AppOptions opts;
+static atomic_bool second_held;
+
+static void sleep_ms(long ms) {
+    struct timespec delay = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&delay, NULL);
+}
+
+static void *acquire_sibling(void *arg) {
+    TargetLock lock;
+    target_lock_acquire(&opts, (const char *)arg, &lock);
+    atomic_store(&second_held, lock.held);
+    target_lock_release(&lock);
+    return NULL;
+}
+
+/* Destinos no mesmo diretório pai caem no mesmo slot: o segundo espera o primeiro soltar. */
+static void test_same_parent_serializes(void) {
+    target_lock_begin(&opts);
+    TargetLock first;
+    target_lock_acquire(&opts, "/h/.config/a.conf", &first);
+    assert(first.held);
+
+    atomic_store(&second_held, false);
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, acquire_sibling, "/h/.config/b.conf") == 0);
+    sleep_ms(100);
+    assert(!atomic_load(&second_held));
+    target_lock_release(&first);
+    assert(!first.held);
+    assert(pthread_join(thread, NULL) == 0);
+    assert(atomic_load(&second_held));
+    target_lock_end(&opts);
+}
+
+static void test_dry_run_skips(void) {
+    opts.dry_run = true;
+    target_lock_begin(&opts);
+    TargetLock lock;
+    target_lock_acquire(&opts, "/h/.bashrc", &lock);
+    assert(!lock.held);
+    target_lock_release(&lock);
+    target_lock_end(&opts);
+    opts.dry_run = false;
+}
+
+/* Tenta o byte do lock de estado num processo à parte; devolve true se conseguiu. */
+static bool state_lock_free(void) {
+    char path[PATH_MAX];
+    assert(join_paths(opts.repo_path, TARGET_LOCK_FILE, path, sizeof(path)));
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        int fd = open(path, O_RDWR);
+        struct flock range;
+        memset(&range, 0, sizeof(range));
+        range.l_type = F_WRLCK;
+        range.l_whence = SEEK_SET;
+        range.l_start = TARGET_LOCK_SLOTS;
+        range.l_len = 1;
+        _exit(fd >= 0 && fcntl(fd, F_SETLK, &range) == 0 ? 0 : 1);
+    }
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void test_state_lock(void) {
+    target_lock_state_begin(&opts);
+    assert(!state_lock_free());
+    target_lock_state_end();
+    assert(state_lock_free());
+}
+
+int main(void) {
+    char base[] = "/tmp/dotmgr-lock-XXXXXX";
+    assert(mkdtemp(base) != NULL);
+    memset(&opts, 0, sizeof(opts));
+    opts.command = CMD_INSTALL;
+    snprintf(opts.repo_path, sizeof(opts.repo_path), "%s", base);
+
+    test_same_parent_serializes();
+    test_dry_run_skips();
+    test_state_lock();
+
+    char command[PATH_MAX + 16];
+    snprintf(command, sizeof(command), "rm -rf '%s'", base);
+    assert(system(command) == 0);
+    printf("All target_lock tests passed.\n");
+    return 0;
+}
+#else
+int main(void) {
+    printf("target_lock tests skipped on Windows.\n");
+    return 0;
+}
+#endif
@@ -1,3 +1,5 @@
+#define _DEFAULT_SOURCE
+
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
@@ -6,6 +8,7 @@
 #include <stdlib.h>
 #else
 #include <stdlib.h>
+#include <sys/stat.h>
 #endif
 
 #include "utils.h"
@@ -46,10 +49,21 @@ static void test_expand_home(void) {
 #endif
 }
 
+static void test_stat_mtime(void) {
+#ifndef _WIN32
+    struct stat st;
+    assert(stat("tests/test_utils.c", &st) == 0);
+    long long mtime_ns = stat_mtime_ns(&st);
+    assert(mtime_ns / 1000000000LL == (long long)st.st_mtime);
+    assert(mtime_ns % 1000000000LL >= 0);
+#endif
+}
+
 int main(void) {
     test_join_paths();
     test_is_absolute();
     test_expand_home();
+    test_stat_mtime();
     printf("All utils tests passed.\n");
     return 0;
 }